@@ -0,0 +1,80 @@
+#!/usr/bin/env python3
+"""Compare two simavr benchmark results and flag regressions.
+
+Usage: compare.py BASELINE.json CURRENT.json [--tolerance PERCENT]
+
+Exits 1 when any tracked metric grows by more than the tolerance (default 5%)
+over the baseline, 0 otherwise. Traces or probes missing on either side are
+reported but never fail the run.
+"""
+
+from __future__ import annotations
+
+import argparse
+import json
+import sys
+from typing import Any
+
+# Per-probe cycle counts worth gating on; call counts only describe the trace.
+PROBE_METRICS = ("max_cycles", "total_cycles")
+TRACE_METRICS = ("stack_peak_bytes", "sram_peak_bytes")
+# Whole-image figures, reported once per run.
+IMAGE_METRICS = ("flash_bytes",)
+
+
+def _load(path: str) -> dict[str, Any]:
+    with open(path, encoding="utf-8") as fh:
+        data: dict[str, Any] = json.load(fh)
+    return data
+
+
+def _rows(result: dict[str, Any]) -> dict[str, int]:
+    rows: dict[str, int] = {}
+    for metric in IMAGE_METRICS:
+        if metric in result:
+            rows[metric] = int(result[metric])
+    for trace, stats in result.get("traces", {}).items():
+        for probe, values in stats.get("probes", {}).items():
+            if values.get("calls", 0) == 0:
+                continue
+            for metric in PROBE_METRICS:
+                rows[f"{trace}.{probe}.{metric}"] = int(values[metric])
+        for metric in TRACE_METRICS:
+            if metric in stats:
+                rows[f"{trace}.{metric}"] = int(stats[metric])
+    return rows
+
+
+def compare(baseline: dict[str, Any], current: dict[str, Any], tolerance: float) -> int:
+    base_rows = _rows(baseline)
+    cur_rows = _rows(current)
+    regressions = 0
+    width = max((len(k) for k in cur_rows), default=0)
+    for key in sorted(set(base_rows) | set(cur_rows)):
+        if key not in base_rows or key not in cur_rows:
+            print(f"{key:<{width}}  {'only in ' + ('current' if key in cur_rows else 'baseline')}")
+            continue
+        old, new = base_rows[key], cur_rows[key]
+        delta = (new - old) * 100.0 / old if old else (0.0 if new == 0 else float("inf"))
+        flag = ""
+        if delta > tolerance:
+            flag = "  REGRESSION"
+            regressions += 1
+        print(f"{key:<{width}}  {old:>10} -> {new:>10}  {delta:+7.1f}%{flag}")
+    if regressions:
+        print(f"{regressions} metric(s) regressed by more than {tolerance:g}%")
+        return 1
+    return 0
+
+
+def main(argv: list[str] | None = None) -> int:
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    parser.add_argument("--tolerance", type=float, default=5.0, help="allowed growth in percent")
+    args = parser.parse_args(argv)
+    return compare(_load(args.baseline), _load(args.current), args.tolerance)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
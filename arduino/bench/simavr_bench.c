@@ -0,0 +1,434 @@
+// Cycle-accurate benchmark for the nano firmware under simavr.
+//
+// Usage: simavr_bench <firmware.elf> <out.json> <trace.replay>...
+//
+// Each trace runs on a freshly reset ATmega328P at 16 MHz. Serial bytes are
+// clocked into USART0 at 115200 baud wire speed, encoder and button edges
+// drive PD2/PD3/PD4. The firmware must be built with -DLCDMON_BENCH
+// (env:nano_bench): its probes write 0x80|id / id to GPIOR0, which this
+// harness timestamps with the cycle counter.
+//
+// Trace format is the replay format of the native simulator
+// (sim/sim_main.cpp); `lcd` is accepted and ignored here, and `enc` takes an
+// optional edge spacing in microseconds (default 250).
+//
+// Reported per trace: calls / total / max cycles per probe (inclusive of any
+// nested probe or interrupt), worst loop() latency, static SRAM and the stack
+// high-water mark found by painting free RAM before reset. The image's flash
+// size (.text + .data) is reported once for the run.
+#include <ctype.h>
+#include <fcntl.h>
+#include <gelf.h>
+#include <libelf.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "avr_ioport.h"
+#include "avr_uart.h"
+#include "sim_avr.h"
+#include "sim_elf.h"
+
+#define F_CPU 16000000UL
+#define BAUD 115200UL
+#define BYTE_CYCLES ((F_CPU * 10) / BAUD)  // 8N1: 10 bits per byte
+#define RAMSTART 0x100
+#define GPIOR0_ADDR 0x3E  // data-space address of GPIOR0 (I/O 0x1E)
+#define PAINT 0xA5
+#define PROBE_COUNT 8
+#define MAX_DEPTH 16
+#define DEFAULT_EDGE_US 250
+
+static const char* const kProbeNames[PROBE_COUNT] = {
+    NULL, "loop", "processSerial", "commitFrame", "render", "encoderISR", "uartRxISR",
+    "lcdTickISR",
+};
+
+typedef struct {
+  uint32_t calls;
+  uint64_t total;
+  uint64_t max;
+} probe_stats_t;
+
+typedef struct {
+  avr_t* avr;
+  probe_stats_t probes[PROBE_COUNT];
+  uint8_t stackIds[MAX_DEPTH];
+  avr_cycle_count_t stackStart[MAX_DEPTH];
+  int depth;
+  uint32_t probeErrors;  // exits without a matching entry
+
+  uint8_t* rx;  // pending serial bytes
+  size_t rxLen;
+  size_t rxPos;
+  int rxActive;
+  uint32_t txBytes;
+} bench_t;
+
+// --- Probes ---
+
+static void onGpior0Write(avr_t* avr, avr_io_addr_t addr, uint8_t v, void* param) {
+  (void)addr;
+  bench_t* b = (bench_t*)param;
+  uint8_t id = v & 0x7F;
+  if (id == 0 || id >= PROBE_COUNT) return;
+  if (v & 0x80) {
+    if (b->depth < MAX_DEPTH) {
+      b->stackIds[b->depth] = id;
+      b->stackStart[b->depth] = avr->cycle;
+    }
+    ++b->depth;
+    return;
+  }
+  if (b->depth == 0) {
+    ++b->probeErrors;
+    return;
+  }
+  --b->depth;
+  if (b->depth >= MAX_DEPTH || b->stackIds[b->depth] != id) {
+    ++b->probeErrors;
+    return;
+  }
+  uint64_t spent = avr->cycle - b->stackStart[b->depth];
+  probe_stats_t* p = &b->probes[id];
+  ++p->calls;
+  p->total += spent;
+  if (spent > p->max) p->max = spent;
+}
+
+// --- Serial ---
+
+static void onTx(struct avr_irq_t* irq, uint32_t value, void* param) {
+  (void)irq;
+  (void)value;
+  ++((bench_t*)param)->txBytes;
+}
+
+static avr_cycle_count_t rxTick(avr_t* avr, avr_cycle_count_t when, void* param) {
+  bench_t* b = (bench_t*)param;
+  if (b->rxPos >= b->rxLen) {
+    b->rxActive = 0;
+    return 0;
+  }
+  avr_irq_t* input = avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_INPUT);
+  avr_raise_irq(input, b->rx[b->rxPos++]);
+  return when + BYTE_CYCLES;
+}
+
+static void runUntil(bench_t* b, avr_cycle_count_t target) {
+  while (b->avr->cycle < target) {
+    int state = avr_run(b->avr);
+    if (state == cpu_Done || state == cpu_Crashed) {
+      fprintf(stderr, "firmware stopped (state %d)\n", state);
+      exit(1);
+    }
+  }
+}
+
+static void sendBytes(bench_t* b, const uint8_t* data, size_t len) {
+  b->rx = realloc(b->rx, len ? len : 1);
+  memcpy(b->rx, data, len);
+  b->rxLen = len;
+  b->rxPos = 0;
+  b->rxActive = 1;
+  avr_cycle_timer_register(b->avr, 1, rxTick, b);
+  // The host writes the whole burst back to back; the next event follows it.
+  while (b->rxActive) runUntil(b, b->avr->cycle + BYTE_CYCLES);
+}
+
+// --- Pins ---
+
+static void setPin(bench_t* b, int bit, int level) {
+  avr_raise_irq(avr_io_getirq(b->avr, AVR_IOCTL_IOPORT_GETIRQ('D'), bit), level);
+}
+
+static void turnEncoder(bench_t* b, int detents, unsigned edgeUs) {
+  // (A,B) per quarter step clockwise from the rest state 11; A=PD2, B=PD3.
+  static const int kCw[4][2] = {{0, 1}, {0, 0}, {1, 0}, {1, 1}};
+  int steps = detents < 0 ? -detents : detents;
+  avr_cycle_count_t edgeCycles = (avr_cycle_count_t)edgeUs * (F_CPU / 1000000UL);
+  for (int d = 0; d < steps; ++d) {
+    for (int q = 0; q < 4; ++q) {
+      const int* ab = (detents > 0) ? kCw[q] : kCw[(2 - q + 4) % 4];
+      setPin(b, 2, ab[0]);
+      setPin(b, 3, ab[1]);
+      runUntil(b, b->avr->cycle + edgeCycles);
+    }
+  }
+}
+
+// --- Replay parsing ---
+
+static int hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  c = (char)tolower((unsigned char)c);
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+static size_t unescape(const char* in, uint8_t* out) {
+  size_t n = 0;
+  for (size_t i = 0; in[i] != '\0'; ++i) {
+    if (in[i] != '\\' || in[i + 1] == '\0') {
+      out[n++] = (uint8_t)in[i];
+      continue;
+    }
+    char e = in[++i];
+    if (e == 'n') {
+      out[n++] = '\n';
+    } else if (e == 'r') {
+      out[n++] = '\r';
+    } else if (e == 't') {
+      out[n++] = '\t';
+    } else if (e == 'x' && hexValue(in[i + 1]) >= 0 && hexValue(in[i + 2]) >= 0) {
+      out[n++] = (uint8_t)(hexValue(in[i + 1]) * 16 + hexValue(in[i + 2]));
+      i += 2;
+    } else {
+      out[n++] = (uint8_t)e;
+    }
+  }
+  return n;
+}
+
+static size_t parseHex(const char* in, uint8_t* out) {
+  size_t n = 0;
+  int hi = -1;
+  for (; *in != '\0'; ++in) {
+    int v = hexValue(*in);
+    if (v < 0) continue;
+    if (hi < 0) {
+      hi = v;
+    } else {
+      out[n++] = (uint8_t)(hi * 16 + v);
+      hi = -1;
+    }
+  }
+  return n;
+}
+
+static void chomp(char* s) {
+  size_t n = strlen(s);
+  while (n > 0 && (s[n - 1] == '\n' || s[n - 1] == '\r')) s[--n] = '\0';
+}
+
+static void runTrace(bench_t* b, const char* path) {
+  FILE* in = fopen(path, "r");
+  if (in == NULL) {
+    fprintf(stderr, "cannot open %s\n", path);
+    exit(2);
+  }
+  char line[512];
+  uint8_t bytes[4096];
+  unsigned lineNo = 0;
+  while (fgets(line, sizeof(line), in) != NULL) {
+    ++lineNo;
+    chomp(line);
+    char* op = line;
+    while (*op == ' ' || *op == '\t') ++op;
+    if (*op == '\0' || *op == '#') continue;
+    char* arg = strchr(op, ' ');
+    if (arg != NULL) {
+      *arg++ = '\0';
+    } else {
+      arg = op + strlen(op);
+    }
+
+    if (strcmp(op, "frame") == 0) {
+      size_t n = 0;
+      while (fgets(line, sizeof(line), in) != NULL) {
+        ++lineNo;
+        chomp(line);
+        if (strcmp(line, "end") == 0) break;
+        size_t len = strlen(line);
+        if (n + len + 2 > sizeof(bytes)) break;
+        memcpy(bytes + n, line, len);
+        n += len;
+        bytes[n++] = '\n';
+      }
+      bytes[n++] = '\n';
+      sendBytes(b, bytes, n);
+    } else if (strcmp(op, "rx") == 0) {
+      sendBytes(b, bytes, unescape(arg, bytes));
+    } else if (strcmp(op, "rxhex") == 0) {
+      sendBytes(b, bytes, parseHex(arg, bytes));
+    } else if (strcmp(op, "wait") == 0) {
+      runUntil(b, b->avr->cycle + strtoull(arg, NULL, 10) * (F_CPU / 1000));
+    } else if (strcmp(op, "enc") == 0) {
+      char* rest = NULL;
+      long detents = strtol(arg, &rest, 10);
+      unsigned long edgeUs = strtoul(rest, NULL, 10);
+      turnEncoder(b, (int)detents, edgeUs ? (unsigned)edgeUs : DEFAULT_EDGE_US);
+    } else if (strcmp(op, "button") == 0) {
+      setPin(b, 4, strcmp(arg, "down") == 0 ? 0 : 1);
+    } else if (strcmp(op, "press") == 0) {
+      setPin(b, 4, 0);
+      runUntil(b, b->avr->cycle + strtoull(arg, NULL, 10) * (F_CPU / 1000));
+      setPin(b, 4, 1);
+    } else if (strcmp(op, "lcd") == 0) {
+      // Panel dumps are a native-simulator feature.
+    } else {
+      fprintf(stderr, "%s:%u: unknown directive '%s'\n", path, lineNo, op);
+      exit(2);
+    }
+  }
+  fclose(in);
+  // Let the tail of the trace finish processing.
+  runUntil(b, b->avr->cycle + 50 * (F_CPU / 1000));
+}
+
+// --- SRAM layout ---
+
+// Address of `_end` (first byte past .data/.bss), or 0 if not found.
+static uint32_t findBssEnd(const char* elfPath) {
+  uint32_t end = 0;
+  int fd = open(elfPath, O_RDONLY);
+  if (fd < 0) return 0;
+  elf_version(EV_CURRENT);
+  Elf* elf = elf_begin(fd, ELF_C_READ, NULL);
+  Elf_Scn* scn = NULL;
+  while (elf != NULL && (scn = elf_nextscn(elf, scn)) != NULL) {
+    GElf_Shdr shdr;
+    if (gelf_getshdr(scn, &shdr) == NULL || shdr.sh_type != SHT_SYMTAB) continue;
+    Elf_Data* data = elf_getdata(scn, NULL);
+    size_t count = shdr.sh_size / shdr.sh_entsize;
+    for (size_t i = 0; i < count; ++i) {
+      GElf_Sym sym;
+      gelf_getsym(data, (int)i, &sym);
+      const char* name = elf_strptr(elf, shdr.sh_link, sym.st_name);
+      if (name != NULL && strcmp(name, "_end") == 0) {
+        end = (uint32_t)(sym.st_value & 0xFFFF);  // strip the 0x800000 data-space tag
+      }
+    }
+  }
+  if (elf != NULL) elf_end(elf);
+  close(fd);
+  return end;
+}
+
+// Program image size: .text plus the .data initialisers copied out of flash
+// at reset, as avr-size counts them. 0 if the ELF cannot be read.
+static uint32_t findFlashBytes(const char* elfPath) {
+  uint32_t bytes = 0;
+  int fd = open(elfPath, O_RDONLY);
+  if (fd < 0) return 0;
+  elf_version(EV_CURRENT);
+  Elf* elf = elf_begin(fd, ELF_C_READ, NULL);
+  size_t names = 0;
+  if (elf != NULL && elf_getshdrstrndx(elf, &names) == 0) {
+    Elf_Scn* scn = NULL;
+    while ((scn = elf_nextscn(elf, scn)) != NULL) {
+      GElf_Shdr shdr;
+      if (gelf_getshdr(scn, &shdr) == NULL) continue;
+      const char* name = elf_strptr(elf, names, shdr.sh_name);
+      if (name != NULL && (strcmp(name, ".text") == 0 || strcmp(name, ".data") == 0)) {
+        bytes += (uint32_t)shdr.sh_size;
+      }
+    }
+  }
+  if (elf != NULL) elf_end(elf);
+  close(fd);
+  return bytes;
+}
+
+// --- Report ---
+
+static void writeTrace(FILE* out, const char* path, bench_t* b, uint32_t bssEnd, int last) {
+  const char* name = strrchr(path, '/');
+  name = name ? name + 1 : path;
+  size_t nameLen = strcspn(name, ".");
+
+  uint32_t ramEnd = b->avr->ramend;
+  uint32_t lowest = ramEnd + 1;  // lowest address the stack ever touched
+  for (uint32_t a = bssEnd; a <= ramEnd; ++a) {
+    if (b->avr->data[a] != PAINT) {
+      lowest = a;
+      break;
+    }
+  }
+  uint32_t stackPeak = ramEnd + 1 - lowest;
+  uint32_t staticBytes = bssEnd > RAMSTART ? bssEnd - RAMSTART : 0;
+
+  fprintf(out, "    \"%.*s\": {\n", (int)nameLen, name);
+  fprintf(out, "      \"cycles\": %llu,\n", (unsigned long long)b->avr->cycle);
+  fprintf(out, "      \"probes\": {\n");
+  int first = 1;
+  for (int id = 1; id < PROBE_COUNT; ++id) {
+    probe_stats_t* p = &b->probes[id];
+    fprintf(out, "%s        \"%s\": {\"calls\": %u, \"total_cycles\": %llu, \"max_cycles\": %llu}",
+            first ? "" : ",\n", kProbeNames[id], p->calls, (unsigned long long)p->total,
+            (unsigned long long)p->max);
+    first = 0;
+  }
+  fprintf(out, "\n      },\n");
+  fprintf(out, "      \"loop_latency_max_us\": %.1f,\n",
+          (double)b->probes[1].max * 1e6 / (double)F_CPU);
+  fprintf(out, "      \"sram_static_bytes\": %u,\n", staticBytes);
+  fprintf(out, "      \"stack_peak_bytes\": %u,\n", stackPeak);
+  fprintf(out, "      \"sram_peak_bytes\": %u,\n", staticBytes + stackPeak);
+  fprintf(out, "      \"tx_bytes\": %u,\n", b->txBytes);
+  fprintf(out, "      \"probe_errors\": %u\n", b->probeErrors);
+  fprintf(out, "    }%s\n", last ? "" : ",");
+}
+
+int main(int argc, char** argv) {
+  if (argc < 4) {
+    fprintf(stderr, "usage: %s <firmware.elf> <out.json> <trace.replay>...\n", argv[0]);
+    return 2;
+  }
+  const char* elfPath = argv[1];
+  uint32_t bssEnd = findBssEnd(elfPath);
+  if (bssEnd == 0) {
+    fprintf(stderr, "%s: no _end symbol; cannot measure SRAM\n", elfPath);
+    return 2;
+  }
+
+  FILE* out = fopen(argv[2], "w");
+  if (out == NULL) {
+    fprintf(stderr, "cannot write %s\n", argv[2]);
+    return 2;
+  }
+  fprintf(out, "{\n  \"schema\": 1,\n  \"f_cpu\": %lu,\n", F_CPU);
+  fprintf(out, "  \"flash_bytes\": %u,\n  \"traces\": {\n", findFlashBytes(elfPath));
+
+  for (int t = 3; t < argc; ++t) {
+    elf_firmware_t fw;
+    memset(&fw, 0, sizeof(fw));
+    if (elf_read_firmware(elfPath, &fw) != 0) {
+      fprintf(stderr, "cannot load %s\n", elfPath);
+      return 2;
+    }
+    strcpy(fw.mmcu, "atmega328p");
+    fw.frequency = F_CPU;
+
+    bench_t b;
+    memset(&b, 0, sizeof(b));
+    b.avr = avr_make_mcu_by_name(fw.mmcu);
+    avr_init(b.avr);
+    avr_load_firmware(b.avr, &fw);
+    memset(b.avr->data + RAMSTART, PAINT, b.avr->ramend + 1 - RAMSTART);
+
+    avr_register_io_write(b.avr, GPIOR0_ADDR, onGpior0Write, &b);
+    uint32_t flags = 0;
+    avr_ioctl(b.avr, AVR_IOCTL_UART_GET_FLAGS('0'), &flags);
+    flags &= ~AVR_UART_FLAG_STDIO;
+    avr_ioctl(b.avr, AVR_IOCTL_UART_SET_FLAGS('0'), &flags);
+    avr_irq_register_notify(avr_io_getirq(b.avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_OUTPUT),
+                            onTx, &b);
+    // Idle levels: encoder at rest and button released (pull-ups on the board).
+    setPin(&b, 2, 1);
+    setPin(&b, 3, 1);
+    setPin(&b, 4, 1);
+
+    runTrace(&b, argv[t]);
+    writeTrace(out, argv[t], &b, bssEnd, t == argc - 1);
+    fprintf(stderr, "%s: %llu cycles\n", argv[t], (unsigned long long)b.avr->cycle);
+    avr_terminate(b.avr);
+    free(b.rx);
+  }
+
+  fprintf(out, "  }\n}\n");
+  fclose(out);
+  return 0;
+}
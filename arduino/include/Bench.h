@@ -0,0 +1,42 @@
+// Cycle probes for the simavr benchmark (make arduino-bench).
+//
+// Built only into env:nano_bench (-DLCDMON_BENCH). Each probe is a single
+// `out` to GPIOR0, which no other code uses: 0x80|id on entry, id on exit.
+// The harness timestamps those writes with the simulated cycle counter.
+// Everywhere else the macros compile to nothing.
+#pragma once
+#include <Arduino.h>
+
+enum BenchProbe : uint8_t {
+  BENCH_LOOP = 1,
+  BENCH_PROCESS_SERIAL = 2,
+  BENCH_COMMIT_FRAME = 3,
+  BENCH_RENDER = 4,
+  BENCH_ENCODER_ISR = 5,
+  BENCH_UART_RX_ISR = 6,
+  BENCH_LCD_TICK_ISR = 7,
+};
+
+#ifdef LCDMON_BENCH
+
+#define BENCH_ENTER(id) (GPIOR0 = static_cast<uint8_t>(0x80 | (id)))
+#define BENCH_EXIT(id) (GPIOR0 = static_cast<uint8_t>(id))
+
+// Marks entry now and exit when the enclosing scope ends (covers early returns).
+class BenchScope {
+ public:
+  explicit BenchScope(uint8_t id) : _id(id) { BENCH_ENTER(id); }
+  ~BenchScope() { BENCH_EXIT(_id); }
+
+ private:
+  uint8_t _id;
+};
+#define BENCH_SCOPE(id) BenchScope benchScope_(id)
+
+#else
+
+#define BENCH_ENTER(id) ((void)0)
+#define BENCH_EXIT(id) ((void)0)
+#define BENCH_SCOPE(id) ((void)0)
+
+#endif
@@ -0,0 +1,15 @@
+// CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF), as used by binary frames.
+// Same bit loop as avr-libc's _crc_xmodem_update, kept portable for tests.
+#pragma once
+#include <Arduino.h>
+
+constexpr uint16_t CRC16_INIT = 0xFFFF;
+
+inline uint16_t crc16Update(uint16_t crc, uint8_t data) {
+  crc ^= static_cast<uint16_t>(data) << 8;
+  for (uint8_t i = 0; i < 8; ++i) {
+    crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ 0x1021)
+                         : static_cast<uint16_t>(crc << 1);
+  }
+  return crc;
+}
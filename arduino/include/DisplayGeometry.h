@@ -0,0 +1,38 @@
+// Compile-time panel geometry.
+//
+// One firmware source serves every supported HD44780 module; the build env
+// picks the panel with -DLCDMON_PANEL_1602 or -DLCDMON_PANEL_4002 (20x4 when
+// neither is set). Everything sized by the panel reads it from `Panel`: the
+// line width of the scroll buffer and arena, the framebuffer, the rows the UI
+// draws and the limits announced in CAPS.
+#pragma once
+#include <Arduino.h>
+
+#include "ScrollBuffer.h"
+
+template <uint8_t Cols, uint8_t Rows, uint8_t Lines>
+struct DisplayGeometry {
+  static_assert(Rows >= 1 && Rows <= 4, "HD44780 drives at most 4 rows");
+  static_assert(static_cast<uint16_t>(Cols) * Rows <= 80, "HD44780 DDRAM holds 80 chars");
+  static_assert(Lines >= Rows, "keep at least one screen of telemetry");
+
+  static constexpr uint8_t kCols = Cols;
+  static constexpr uint8_t kRows = Rows;
+  static constexpr uint8_t kLines = Lines;  // telemetry lines kept
+
+  using Buffer = ScrollBuffer<Cols, Lines>;
+  using Arena = typename Buffer::Arena;
+};
+
+// Lines per panel keep the arena near 800 bytes: wide panels get fewer.
+using Geometry1602 = DisplayGeometry<16, 2, 32>;
+using Geometry2004 = DisplayGeometry<20, 4, 32>;
+using Geometry4002 = DisplayGeometry<40, 2, 16>;
+
+#if defined(LCDMON_PANEL_1602)
+using Panel = Geometry1602;
+#elif defined(LCDMON_PANEL_4002)
+using Panel = Geometry4002;
+#else
+using Panel = Geometry2004;
+#endif
@@ -0,0 +1,833 @@
+// Byte-at-a-time parser for frames sent by the daemon (docs/adr/0001-protocol.md).
+//
+// Text mode (line framing, terminated by a blank line):
+//   [META interval=<s> hello=1 seq=<n> ...]
+//   [COMMANDS v1 | PAGE <menu> <parent> <offset> <total> [<digest>] | DELTA <total> |
+//    REQ STATS]
+//   <lines...>
+// Binary mode, entered whenever STX starts a line:
+//   STX type lenLo lenHi payload[len] crcHi crcLo ETX
+// The CRC-16/CCITT-FALSE covers type, length and payload. Payload by type:
+//   'T' telemetry  u16 intervalMs, then lines as [len][bytes]
+//   'D' delta      u16 intervalMs, u8 total, then [index][len][bytes]
+//   'K' keepalive  u16 intervalMs
+//   'C' commands   lines as [len][bytes] ("<id> <label>")
+//   'P' page       u8 menu, u8 parent, u16 offset, u16 total, u16 digest, then
+//                  lines as in 'C'
+//   'L' layout     u16 intervalMs, u8 layoutId, u8 fieldCount,
+//                  fieldCount x [line][col][fmt], then lines as [len][bytes]
+//   'V' values     u16 intervalMs, u8 layoutId, then [field][i16 value]
+//   'B' baud       u32 rate the link moves to (see main.cpp)
+// A layout is a telemetry frame whose numeric fields NumericLayout keeps;
+// values frames only make sense against the layout id they name.
+// Multi-byte integers are little-endian. A frame is only exposed once it has
+// arrived intact; damaged frames are reported and discarded.
+//
+// Lines are written straight into the panel ScrollBuffer's staging slots as
+// bytes arrive, a delta line at the position of the line it replaces; the
+// caller commits a frame with its swap()/adoptStaged() before the next
+// feed(), which returns whatever is left to the arena. META is parsed as it
+// streams in and never occupies a slot: each key is matched against
+// FRAME_META_KEYS character by character and its decimal value accumulated
+// in fixed point, so no line is buffered or scanned twice. The pairs of a
+// values frame are packed into staging slots as raw bytes.
+// Telemetry lines (full, delta and layout frames) may run to kLongWidth: the
+// characters past kLineWidth go to the staged slot's continuation, which the
+// display scrolls as a marquee. Other lines are cut at kLineWidth.
+#pragma once
+#include <Arduino.h>
+#include <string.h>
+#include "Crc16.h"
+#include "DisplayGeometry.h"
+#include "NumericLayout.h"
+
+enum class FrameKind : uint8_t {
+  None = 0,
+  Telemetry,
+  Delta,
+  Commands,
+  Page,  // a window of one command menu (see main.cpp)
+  KeepAlive,
+  Layout,
+  Values,
+  Baud,
+  Stats,  // "REQ STATS": the daemon polls the runtime counters
+};
+
+// Header words stay in flash; they are compared with pgm_read_byte/strncmp_P.
+constexpr char FRAME_META_PREFIX[] PROGMEM = "META ";
+constexpr char FRAME_COMMANDS_HEADER[] PROGMEM = "COMMANDS v1";
+constexpr char FRAME_DELTA_HEADER[] PROGMEM = "DELTA ";
+constexpr char FRAME_PAGE_HEADER[] PROGMEM = "PAGE ";
+constexpr char FRAME_STATS_HEADER[] PROGMEM = "REQ STATS";
+
+// META keys in MetaKey order. A value is a decimal number; interval's is in
+// seconds with up to three decimals and kept as milliseconds. A key that is
+// not listed, and whatever follows a malformed value, is skipped up to the
+// next space. New keys take an entry here and a case in applyMeta().
+enum class MetaKey : uint8_t {
+  Interval,  // seconds between frames
+  Hello,     // the daemon wants CAPS again (value ignored)
+  Sequence,  // frame number, for callers that track gaps
+  Count,
+};
+constexpr uint8_t FRAME_META_KEY_MAX = 8;
+constexpr char FRAME_META_KEYS[][FRAME_META_KEY_MAX + 1] PROGMEM = {"interval", "hello", "seq"};
+static_assert(sizeof(FRAME_META_KEYS) / sizeof(FRAME_META_KEYS[0]) ==
+                  static_cast<uint8_t>(MetaKey::Count),
+              "one name per MetaKey");
+
+class FrameParser {
+ public:
+  static constexpr uint8_t kMaxLines = Panel::Buffer::kCapacity;
+  static constexpr uint8_t kLineWidth = Panel::Buffer::kWidth;
+  static constexpr uint8_t kLongWidth = Panel::Buffer::kLongWidth;
+  static constexpr uint8_t kMetaKeys = static_cast<uint8_t>(MetaKey::Count);
+  static_assert(kMetaKeys <= 8, "candidate keys are tracked in one byte");
+  static constexpr unsigned long kMetaValueMax = 0xFFFFFFFFUL / 10 - 1;  // x10 + 9 fits
+  static constexpr uint16_t kMaxPayload = 512;
+
+  static constexpr uint8_t STX = 0x02;
+  static constexpr uint8_t ETX = 0x03;
+  static constexpr uint8_t TYPE_TELEMETRY = 'T';
+  static constexpr uint8_t TYPE_DELTA = 'D';
+  static constexpr uint8_t TYPE_KEEPALIVE = 'K';
+  static constexpr uint8_t TYPE_COMMANDS = 'C';
+  static constexpr uint8_t TYPE_PAGE = 'P';
+  static constexpr uint8_t TYPE_LAYOUT = 'L';
+  static constexpr uint8_t TYPE_VALUES = 'V';
+  static constexpr uint8_t TYPE_BAUD = 'B';
+  // [field][lo][hi] records packed into one staging slot, clear of the byte
+  // past kLineWidth that LineArena keeps for a continuation link.
+  static constexpr uint8_t kValuesPerSlot = kLineWidth / 3;
+  static_assert(NumericLayout::kMaxFields <= Panel::Buffer::kStageGuarantee * kValuesPerSlot,
+                "a values frame for every field must fit the guaranteed staging slots");
+
+  enum class Result : uint8_t {
+    Pending,  // need more bytes
+    Frame,    // a complete frame is available until the next feed()
+    Corrupt,  // bad CRC/terminator/layout; frame discarded
+    Dropped,  // frame discarded after markCorrupt()
+    NoSlot,   // frame discarded: no staging slot for its first line
+  };
+
+  explicit FrameParser(Panel::Buffer& stage) : _stage(stage) { reset(); }
+
+  // Drop any partial frame and wait for the next line/STX.
+  void reset() {
+    _state = State::Text;
+    _col = 0;
+    _corrupt = false;
+    _noSlot = false;
+    clearFrame();
+  }
+
+  // Bytes were lost upstream: discard the frame that is currently arriving.
+  void markCorrupt() { _corrupt = true; }
+
+  Result feed(uint8_t b) {
+    if (_frameReady) {
+      clearFrame();
+    }
+    switch (_state) {
+      case State::Text:
+        return feedText(b);
+      case State::BinType:
+        _crc = crc16Update(CRC16_INIT, b);
+        _type = b;
+        _state = State::BinLenLo;
+        return Result::Pending;
+      case State::BinLenLo:
+        _crc = crc16Update(_crc, b);
+        _remaining = b;
+        _state = State::BinLenHi;
+        return Result::Pending;
+      case State::BinLenHi:
+        _crc = crc16Update(_crc, b);
+        _remaining |= static_cast<uint16_t>(b) << 8;
+        if (_remaining > kMaxPayload) return fail();
+        beginBinaryPayload();
+        _state = (_remaining == 0) ? State::BinCrcHi : State::BinPayload;
+        return Result::Pending;
+      case State::BinPayload:
+        _crc = crc16Update(_crc, b);
+        feedPayload(b);
+        if (--_remaining == 0) _state = State::BinCrcHi;
+        return Result::Pending;
+      case State::BinCrcHi:
+        _rxCrc = static_cast<uint16_t>(b) << 8;
+        _state = State::BinCrcLo;
+        return Result::Pending;
+      case State::BinCrcLo:
+        _rxCrc |= b;
+        _state = State::BinEnd;
+        return Result::Pending;
+      case State::BinEnd:
+        return finishBinary(b);
+    }
+    return Result::Pending;
+  }
+
+  FrameKind kind() const { return _kind; }
+  unsigned long intervalMs() const {  // 0 if absent
+    return (_kind == FrameKind::Baud) ? 0 : _intervalMs;
+  }
+  unsigned long baud() const { return (_kind == FrameKind::Baud) ? _intervalMs : 0; }
+  bool hello() const { return _hello; }
+  uint16_t sequence() const { return _sequence; }  // META seq=, 0 if absent
+  uint8_t total() const { return _total; }
+  uint8_t lineCount() const { return _lineCount; }
+  // Staged line i, or for a delta frame the new text of line i ("" when the
+  // frame leaves it alone). A telemetry line that continues past kLineWidth
+  // is not terminated (see LineArena::line()).
+  const char* line(uint8_t i) const { return _stage.backLine(i); }
+  // Line characters cut off since boot (wraps at 16 bits).
+  uint16_t truncated() const { return _truncated; }
+  // Count characters the caller cut after commit (see ScrollBuffer::fitTails).
+  void addTruncated(uint16_t n) { _truncated = static_cast<uint16_t>(_truncated + n); }
+
+  // Which menu a page frame belongs to, the menu Back returns to, the index
+  // of its first line in the menu, how many entries the menu has and the
+  // digest of the daemon's whole menu tree (0 when it sent none).
+  uint8_t menu() const { return _menu; }
+  uint8_t parent() const { return _parent; }
+  uint16_t pageOffset() const { return _pageOffset; }
+  uint16_t pageTotal() const { return _pageTotal; }
+  uint16_t pageDigest() const { return _pageDigest; }
+
+  // Layout id a layout frame installs or a values frame refers to.
+  uint8_t layoutId() const { return _layoutId; }
+  // Fields of the last intact layout frame; cleared by the caller when the
+  // lines it describes are gone.
+  NumericLayout& layout() { return _layout; }
+  uint8_t valueCount() const { return _valueCount; }
+  void value(uint8_t i, uint8_t* field, int16_t* v) const {
+    const uint8_t* rec =
+        reinterpret_cast<const uint8_t*>(_stage.backLine(i / kValuesPerSlot)) +
+        (i % kValuesPerSlot) * 3;
+    *field = rec[0];
+    *v = static_cast<int16_t>(rec[1] | (static_cast<uint16_t>(rec[2]) << 8));
+  }
+
+ private:
+  enum class State : uint8_t {
+    Text,
+    BinType,
+    BinLenLo,
+    BinLenHi,
+    BinPayload,
+    BinCrcHi,
+    BinCrcLo,
+    BinEnd,
+  };
+  enum class Field : uint8_t {
+    Interval0,
+    Interval1,
+    Total,
+    Index,
+    Len,
+    Data,
+    LayoutId,
+    Menu,
+    Parent,
+    PageOffset0,
+    PageOffset1,
+    PageTotal0,
+    PageTotal1,
+    PageDigest0,
+    PageDigest1,
+    FieldCount,
+    FieldLine,
+    FieldCol,
+    FieldFmt,
+    ValueByte,
+    Rate,  // byte _lineRemain of a baud frame's rate
+    Ignore,
+  };
+  enum class LineMode : uint8_t { Detect, MetaKey, MetaValue, MetaSkip, Index, Text };
+  static constexpr uint8_t kNoKey = 0xFF;
+  static constexpr uint8_t kNoFraction = 0xFF;
+
+  void clearFrame() {
+    _stage.discardBack();
+    _frameReady = false;
+    _kind = FrameKind::None;
+    _hadMeta = false;
+    _hello = false;
+    _intervalMs = 0;
+    _sequence = 0;
+    _total = 0;
+    _lineCount = 0;
+    _layoutId = NumericLayout::kNone;
+    _valueCount = 0;
+    _valueByte = 0;
+    _menu = 0;
+    _parent = 0;
+    _pageOffset = 0;
+    _pageTotal = 0;
+    _pageDigest = 0;
+  }
+
+  Result fail() {
+    bool dropped = _corrupt;
+    reset();
+    return dropped ? Result::Dropped : Result::Corrupt;
+  }
+
+  Result complete() {
+    bool dropped = _corrupt;
+    bool noSlot = _noSlot;
+    _state = State::Text;
+    _col = 0;
+    _corrupt = false;
+    _noSlot = false;
+    if (dropped || noSlot) {
+      clearFrame();
+      return dropped ? Result::Dropped : Result::NoSlot;
+    }
+    if (_kind == FrameKind::Layout) _layout.activate(_layoutId);
+    _frameReady = true;
+    return Result::Frame;
+  }
+
+  // Claim the staging slot for the line starting now: the next one, or for a
+  // delta line the one at its index. nullptr once kMaxLines are staged or the
+  // arena is out of slots. The line is counted when it ends.
+  char* stageLine() {
+    uint8_t at = (_kind == FrameKind::Delta) ? _lineIndex : _lineCount;
+    if (_lineCount >= kMaxLines || at >= kMaxLines) return nullptr;
+    char* slot = _stage.backSlot(at);
+    if (slot == nullptr) return nullptr;
+    _slotBack = at;
+    slot[0] = '\0';
+    return slot;
+  }
+
+  bool keepsLongLines() const {
+    return _kind == FrameKind::None || _kind == FrameKind::Telemetry ||
+           _kind == FrameKind::Delta || _kind == FrameKind::Layout;
+  }
+
+  void appendToSlot(uint8_t b) {
+    if (_slot == nullptr) return;
+    if (_lineLen < kLineWidth) {
+      _slot[_lineLen++] = static_cast<char>(b);
+      _slot[_lineLen] = '\0';
+      return;
+    }
+    // A tail is only claimed while the lines a frame may still stage after
+    // this one keep their guaranteed slots.
+    char* tail = nullptr;
+    if (_lineLen < kLongWidth && keepsLongLines()) {
+      uint8_t ahead = static_cast<uint8_t>(Panel::Buffer::kStageGuarantee - 1);
+      uint8_t reserve = (_lineCount < ahead) ? static_cast<uint8_t>(ahead - _lineCount) : 0;
+      tail = _stage.backTail(_slotBack, reserve);
+    }
+    if (tail == nullptr) {
+      ++_truncated;
+      return;
+    }
+    uint8_t at = static_cast<uint8_t>(_lineLen++ - kLineWidth);
+    tail[at] = static_cast<char>(b);
+    tail[at + 1] = '\0';
+  }
+
+  // --- Text mode ---
+  void beginTextLine() {
+    _lineLen = 0;
+    _lineIndex = 0;
+    _sawDigit = false;
+    if (_kind == FrameKind::None) {
+      _lineMode = LineMode::Detect;
+    } else if (_kind == FrameKind::Delta) {
+      _lineMode = LineMode::Index;
+    } else {
+      _lineMode = LineMode::Text;
+    }
+    // Tentatively write into the next slot; it is only kept at end of line.
+    // A delta line has no slot until its index has been read.
+    _slot = (_kind == FrameKind::Delta) ? nullptr : stageLine();
+  }
+
+  Result feedText(uint8_t b) {
+    if (b == '\r') return Result::Pending;
+    if (b == '\n') {
+      if (_col == 0) return finishText();
+      endTextLine();
+      _col = 0;
+      return Result::Pending;
+    }
+    if (_col == 0) {
+      if (b == STX) {
+        // Binary frame; abandon any half-received text frame.
+        clearFrame();
+        _state = State::BinType;
+        return Result::Pending;
+      }
+      beginTextLine();
+    }
+    uint8_t col = _col;
+    if (_col < 0xFF) ++_col;
+    switch (_lineMode) {
+      case LineMode::Detect:
+        if (!_hadMeta && col < sizeof(FRAME_META_PREFIX) - 1 &&
+            b == pgm_read_byte(&FRAME_META_PREFIX[col])) {
+          if (col == sizeof(FRAME_META_PREFIX) - 2) {
+            beginMetaKey();
+            return Result::Pending;
+          }
+        } else {
+          _lineMode = LineMode::Text;
+        }
+        appendToSlot(b);
+        break;
+      case LineMode::MetaKey:
+      case LineMode::MetaValue:
+      case LineMode::MetaSkip:
+        feedMeta(b);
+        break;
+      case LineMode::Index:
+        // "<index> <text>"
+        if (b >= '0' && b <= '9') {
+          _lineIndex = static_cast<uint8_t>(_lineIndex * 10 + (b - '0'));
+          _sawDigit = true;
+          break;
+        }
+        _lineMode = LineMode::Text;
+        if (_sawDigit) _slot = stageLine();
+        if (b != ' ') appendToSlot(b);
+        break;
+      case LineMode::Text:
+        appendToSlot(b);
+        break;
+    }
+    return Result::Pending;
+  }
+
+  // prefix is one of the FRAME_*_HEADER words in flash.
+  template <size_t N>
+  static bool startsWith(const char* s, const char (&prefix)[N]) {
+    return strncmp_P(s, prefix, N - 1) == 0;
+  }
+
+  // Parse a small decimal number; returns pointer past the digits, or nullptr if none.
+  template <typename T>
+  static const char* parseNumber(const char* s, T* out) {
+    T value = 0;
+    const char* p = s;
+    while (*p >= '0' && *p <= '9') {
+      value = static_cast<T>(value * 10 + (*p - '0'));
+      ++p;
+    }
+    if (p == s) return nullptr;
+    *out = value;
+    return p;
+  }
+
+  // --- META: "<key>[=<value>]" words, parsed as they arrive ---
+
+  void beginMetaKey() {
+    _lineMode = LineMode::MetaKey;
+    _lineLen = 0;
+    _metaKeys = static_cast<uint8_t>((1u << kMetaKeys) - 1);
+  }
+
+  char metaKeyChar(uint8_t k) const {
+    return static_cast<char>(pgm_read_byte(&FRAME_META_KEYS[k][_lineLen]));
+  }
+
+  // The candidate whose name ends where the key did; kNoKey if none.
+  uint8_t matchedKey() const {
+    for (uint8_t k = 0; k < kMetaKeys; ++k) {
+      if ((_metaKeys & (1u << k)) && metaKeyChar(k) == '\0') return k;
+    }
+    return kNoKey;
+  }
+
+  void feedMeta(uint8_t b) {
+    switch (_lineMode) {
+      case LineMode::MetaKey:
+        if (b == '=' || b == ' ') {
+          _lineIndex = matchedKey();
+          _metaValue = 0;
+          _metaFrac = kNoFraction;
+          if (b == ' ') {  // a bare key
+            applyMeta();
+            beginMetaKey();
+          } else {
+            _lineMode = (_lineIndex == kNoKey) ? LineMode::MetaSkip : LineMode::MetaValue;
+          }
+          return;
+        }
+        // Drop every candidate that differs here; a name that has already
+        // ended differs from any character, so it is never read past.
+        for (uint8_t k = 0; k < kMetaKeys; ++k) {
+          if ((_metaKeys & (1u << k)) && metaKeyChar(k) != static_cast<char>(b)) {
+            _metaKeys &= static_cast<uint8_t>(~(1u << k));
+          }
+        }
+        if (_metaKeys == 0) {
+          _lineMode = LineMode::MetaSkip;
+        } else {
+          ++_lineLen;  // keys are short; a survivor bounds the position
+        }
+        return;
+      case LineMode::MetaValue:
+        if (b >= '0' && b <= '9') {
+          // Digits past the third decimal are dropped; so are integer
+          // digits that would overflow, which saturates below anyway.
+          if (_metaFrac == kNoFraction) {
+            if (_metaValue < kMetaValueMax) _metaValue = _metaValue * 10 + (b - '0');
+          } else if (_metaFrac < 3) {
+            _metaValue = _metaValue * 10 + (b - '0');
+            ++_metaFrac;
+          }
+          return;
+        }
+        if (b == '.' && _metaFrac == kNoFraction) {
+          _metaFrac = 0;
+          return;
+        }
+        applyMeta();
+        if (b == ' ') {
+          beginMetaKey();
+        } else {
+          _lineMode = LineMode::MetaSkip;
+        }
+        return;
+      default:  // MetaSkip
+        if (b == ' ') beginMetaKey();
+        return;
+    }
+  }
+
+  // The value read so far, in thousandths: "1.5" is 1500.
+  unsigned long metaMillis() const {
+    unsigned long v = _metaValue;
+    for (uint8_t f = (_metaFrac == kNoFraction) ? 0 : _metaFrac; f < 3; ++f) {
+      v = (v > kMetaValueMax) ? 0xFFFFFFFFUL : v * 10;
+    }
+    return v;
+  }
+
+  void applyMeta() {
+    switch (static_cast<MetaKey>(_lineIndex)) {
+      case MetaKey::Interval: {
+        unsigned long ms = metaMillis();
+        if (ms > 0) _intervalMs = ms;
+        break;
+      }
+      case MetaKey::Hello:
+        _hello = true;
+        break;
+      case MetaKey::Sequence:
+        _sequence = static_cast<uint16_t>(_metaValue);
+        break;
+      default:  // kNoKey
+        break;
+    }
+  }
+
+  void endMeta() {
+    if (_lineMode == LineMode::MetaKey && _lineLen > 0) {
+      _lineIndex = matchedKey();  // a bare key ends the line
+      applyMeta();
+    } else if (_lineMode == LineMode::MetaValue) {
+      applyMeta();
+    }
+    _hadMeta = true;
+  }
+
+  void endTextLine() {
+    if (_lineMode == LineMode::MetaKey || _lineMode == LineMode::MetaValue ||
+        _lineMode == LineMode::MetaSkip) {
+      endMeta();
+      return;
+    }
+    if (_kind == FrameKind::None) {
+      if (_slot == nullptr) {
+        // No slot to read a header into: drop the frame, so the daemon
+        // resends it in full rather than diffing against lines we lack.
+        _noSlot = true;
+        return;
+      }
+      // First content line: a header is consumed in place, its slot reused.
+      if (startsWith(_slot, FRAME_COMMANDS_HEADER)) {
+        _kind = FrameKind::Commands;
+        return;
+      }
+      if (startsWith(_slot, FRAME_DELTA_HEADER)) {
+        _kind = FrameKind::Delta;
+        parseNumber(_slot + sizeof(FRAME_DELTA_HEADER) - 1, &_total);
+        _stage.dropBack(_slotBack);  // lines go where their index says
+        return;
+      }
+      if (startsWith(_slot, FRAME_PAGE_HEADER)) {
+        _kind = FrameKind::Page;
+        parsePageHeader(_slot + sizeof(FRAME_PAGE_HEADER) - 1);
+        return;
+      }
+      if (startsWith(_slot, FRAME_STATS_HEADER)) {
+        _kind = FrameKind::Stats;
+        return;
+      }
+      _kind = FrameKind::Telemetry;
+    } else if (_kind == FrameKind::Delta) {
+      if (!_sawDigit) return;  // malformed delta line; skip
+      if (_lineMode == LineMode::Index) _slot = stageLine();  // "<index>" alone: a blank line
+    }
+    if (_slot == nullptr) return;  // more lines than we can hold
+    ++_lineCount;
+  }
+
+  // "<menu> <parent> <offset> <total> [<digest>]"
+  void parsePageHeader(const char* p) {
+    p = parseNumber(p, &_menu);
+    if (p != nullptr && *p == ' ') p = parseNumber(p + 1, &_parent);
+    if (p != nullptr && *p == ' ') p = parseNumber(p + 1, &_pageOffset);
+    if (p != nullptr && *p == ' ') p = parseNumber(p + 1, &_pageTotal);
+    if (p != nullptr && *p == ' ') parseNumber(p + 1, &_pageDigest);
+  }
+
+  Result finishText() {
+    if (_kind == FrameKind::None) {
+      if (!_hadMeta) {
+        // Stray blank line between frames.
+        _corrupt = false;
+        _noSlot = false;
+        return Result::Pending;
+      }
+      _kind = FrameKind::KeepAlive;
+    }
+    return complete();
+  }
+
+  // --- Binary mode ---
+  void beginBinaryPayload() {
+    switch (_type) {
+      case TYPE_TELEMETRY:
+        _kind = FrameKind::Telemetry;
+        _field = Field::Interval0;
+        break;
+      case TYPE_DELTA:
+        _kind = FrameKind::Delta;
+        _field = Field::Interval0;
+        break;
+      case TYPE_KEEPALIVE:
+        _kind = FrameKind::KeepAlive;
+        _field = Field::Interval0;
+        break;
+      case TYPE_COMMANDS:
+        _kind = FrameKind::Commands;
+        _field = Field::Len;
+        break;
+      case TYPE_PAGE:
+        _kind = FrameKind::Page;
+        _field = Field::Menu;
+        break;
+      case TYPE_LAYOUT:
+        _kind = FrameKind::Layout;
+        _field = Field::Interval0;
+        _layout.clear();  // the old one is gone whether or not this one arrives
+        break;
+      case TYPE_VALUES:
+        _kind = FrameKind::Values;
+        _field = Field::Interval0;
+        break;
+      case TYPE_BAUD:
+        _kind = FrameKind::Baud;
+        _field = Field::Rate;
+        _lineRemain = 0;
+        break;
+      default:
+        _kind = FrameKind::None;  // unknown type: validate, then ignore
+        _field = Field::Ignore;
+        break;
+    }
+  }
+
+  void feedPayload(uint8_t b) {
+    switch (_field) {
+      case Field::Interval0:
+        _intervalMs = b;
+        _field = Field::Interval1;
+        break;
+      case Field::Interval1:
+        _intervalMs |= static_cast<unsigned long>(b) << 8;
+        if (_kind == FrameKind::Delta) {
+          _field = Field::Total;
+        } else if (_kind == FrameKind::Layout || _kind == FrameKind::Values) {
+          _field = Field::LayoutId;
+        } else if (_kind == FrameKind::KeepAlive) {
+          _field = Field::Ignore;
+        } else {
+          _field = Field::Len;
+        }
+        break;
+      case Field::Total:
+        _total = b;
+        _field = Field::Index;
+        break;
+      case Field::Index:
+        _lineIndex = b;
+        _field = Field::Len;
+        break;
+      case Field::Len:
+        _slot = stageLine();
+        _lineLen = 0;
+        _lineRemain = b;
+        if (b == 0) {
+          endBinaryLine();
+        } else {
+          _field = Field::Data;
+        }
+        break;
+      case Field::Data:
+        appendToSlot(b);
+        if (--_lineRemain == 0) endBinaryLine();
+        break;
+      case Field::LayoutId:
+        _layoutId = b;
+        _field = (_kind == FrameKind::Layout) ? Field::FieldCount : Field::ValueByte;
+        break;
+      case Field::Menu:
+        _menu = b;
+        _field = Field::Parent;
+        break;
+      case Field::Parent:
+        _parent = b;
+        _field = Field::PageOffset0;
+        break;
+      case Field::PageOffset0:
+        _pageOffset = b;
+        _field = Field::PageOffset1;
+        break;
+      case Field::PageOffset1:
+        _pageOffset |= static_cast<uint16_t>(b) << 8;
+        _field = Field::PageTotal0;
+        break;
+      case Field::PageTotal0:
+        _pageTotal = b;
+        _field = Field::PageTotal1;
+        break;
+      case Field::PageTotal1:
+        _pageTotal |= static_cast<uint16_t>(b) << 8;
+        _field = Field::PageDigest0;
+        break;
+      case Field::PageDigest0:
+        _pageDigest = b;
+        _field = Field::PageDigest1;
+        break;
+      case Field::PageDigest1:
+        _pageDigest |= static_cast<uint16_t>(b) << 8;
+        _field = Field::Len;
+        break;
+      case Field::FieldCount:
+        _lineRemain = b;  // fields still to read
+        _field = (b == 0) ? Field::Len : Field::FieldLine;
+        break;
+      case Field::FieldLine:
+        _lineIndex = b;
+        _field = Field::FieldCol;
+        break;
+      case Field::FieldCol:
+        _lineLen = b;
+        _field = Field::FieldFmt;
+        break;
+      case Field::FieldFmt:
+        _layout.add(_lineIndex, _lineLen, b);
+        _field = (--_lineRemain == 0) ? Field::Len : Field::FieldLine;
+        break;
+      case Field::ValueByte:
+        stageValueByte(b);
+        break;
+      case Field::Rate:
+        _intervalMs |= static_cast<unsigned long>(b) << (8 * _lineRemain);
+        if (++_lineRemain == 4) _field = Field::Ignore;
+        break;
+      case Field::Ignore:
+        break;
+    }
+  }
+
+  void endBinaryLine() {
+    if (_slot != nullptr) ++_lineCount;
+    _field = (_kind == FrameKind::Delta) ? Field::Index : Field::Len;
+  }
+
+  // Byte _valueByte (0..2) of values record _valueCount. A record whose
+  // slot cannot be had is dropped; the daemon resends it on its next change.
+  void stageValueByte(uint8_t b) {
+    if (_valueByte == 0) {
+      _slot = (_valueCount < NumericLayout::kMaxFields)
+                  ? _stage.backSlot(_valueCount / kValuesPerSlot)
+                  : nullptr;
+    }
+    if (_slot != nullptr) _slot[(_valueCount % kValuesPerSlot) * 3 + _valueByte] = b;
+    if (++_valueByte == 3) {
+      _valueByte = 0;
+      if (_slot != nullptr) ++_valueCount;
+    }
+  }
+
+  Result finishBinary(uint8_t b) {
+    if (b != ETX || _rxCrc != _crc) return fail();
+    // Payload must end on a record boundary after the fixed header.
+    bool boundary = _field == Field::Len || _field == Field::Index || _field == Field::Ignore ||
+                    (_field == Field::ValueByte && _valueByte == 0);
+    if (_kind != FrameKind::None && !boundary) return fail();
+    if (_kind == FrameKind::None) {
+      _corrupt = false;
+      _state = State::Text;
+      _col = 0;
+      return Result::Pending;
+    }
+    return complete();
+  }
+
+  Panel::Buffer& _stage;  // lines land in its staging slots
+  State _state = State::Text;
+  Field _field = Field::Ignore;
+  LineMode _lineMode = LineMode::Text;
+  bool _corrupt = false;
+  bool _noSlot = false;  // a line found no slot before the frame's kind was known
+  bool _frameReady = false;
+
+  // Line assembly (both modes)
+  uint8_t _col = 0;  // text: chars seen on the current line
+  char* _slot = nullptr;
+  uint8_t _slotBack = 0;  // staging index of _slot, for its continuation
+  uint8_t _lineLen = 0;    // also a layout entry's column, and the place in a META key
+  uint8_t _lineIndex = 0;  // also a layout entry's line, and the META key being read
+  bool _sawDigit = false;
+  uint8_t _metaKeys = 0;  // META names still matching, one bit per MetaKey
+  uint8_t _metaFrac = kNoFraction;  // decimals read so far; kNoFraction before '.'
+  unsigned long _metaValue = 0;  // digits so far, decimal point ignored
+  uint16_t _truncated = 0;  // survives reset()
+
+  // Binary framing
+  uint8_t _type = 0;
+  uint16_t _remaining = 0;
+  uint16_t _crc = 0;
+  uint16_t _rxCrc = 0;
+  uint8_t _lineRemain = 0;
+
+  // Completed frame
+  FrameKind _kind = FrameKind::None;
+  bool _hadMeta = false;
+  bool _hello = false;
+  unsigned long _intervalMs = 0;  // also a baud frame's rate
+  uint16_t _sequence = 0;
+  uint8_t _total = 0;
+  uint8_t _lineCount = 0;
+  uint8_t _layoutId = NumericLayout::kNone;
+  uint8_t _valueCount = 0;
+  uint8_t _valueByte = 0;  // next byte within the current values record
+  uint8_t _menu = 0;
+  uint8_t _parent = 0;
+  uint16_t _pageOffset = 0;
+  uint16_t _pageTotal = 0;
+  uint16_t _pageDigest = 0;
+
+  NumericLayout _layout;  // outlives frames; see layout()
+};
@@ -0,0 +1,77 @@
+// Interrupt-paced HD44780 driver (4-bit bus).
+//
+// Replaces LiquidCrystal, which busy-waits ~100 us per nibble. setCursor()
+// and write() only append to a small op ring; the Timer2 compare ISR clocks
+// one byte out every kTickMicros, which covers the controller's 37 us
+// execution time, and stops its interrupt once the ring is empty. Callers
+// check room() before queueing (LcdFramebuffer::flush does this), so nothing
+// on the main loop waits for the panel.
+//
+// Wiring is fixed to the board: RS=D7 (PD7), E=D8 (PB0), D4..D7=D9..D12
+// (PB1..PB4), so a nibble is one masked PORTB write. Timer2 is not used by
+// anything else here (no tone(), and D3/D11 are not PWM outputs).
+#pragma once
+#include <Arduino.h>
+
+class LcdDriver {
+ public:
+  static constexpr uint8_t kRingSize = 32;         // power of two
+  static constexpr uint16_t kTickMicros = 50;      // one op per Timer2 tick
+  static constexpr uint8_t kSlowTicks = 32;        // clear/home: 1.52 ms + margin
+
+  // Blocking power-on init (setup() only); leaves the display cleared.
+  static void begin(uint8_t cols, uint8_t rows);
+
+  // --- Queued operations; each takes one ring slot ---
+  static void clear();
+  static void setCursor(uint8_t col, uint8_t row);
+  static void write(uint8_t value);
+  // Point data writes at CGRAM byte addr (glyph * 8 + row) until the next
+  // setCursor().
+  static void setCgramAddress(uint8_t addr);
+
+  static uint8_t room() {
+    return static_cast<uint8_t>(kRingSize - 1 - ((_head - _tail) & (kRingSize - 1)));
+  }
+  static bool idle() { return _head == _tail && _wait == 0; }
+
+  // Timer2 ISR body: clock out the next queued op.
+  static void onTick() {
+    if (_wait != 0) {
+      --_wait;
+      return;
+    }
+    uint8_t tail = _tail;
+    if (tail == _head) {
+      timerEnable(false);
+      return;
+    }
+    uint8_t value = _value[tail];
+    bool data = (_data[tail >> 3] & bit8(tail)) != 0;
+    busWrite(value, data);
+    if (!data && value <= kSlowCommandMax) _wait = kSlowTicks;
+    _tail = (tail + 1) & (kRingSize - 1);
+  }
+
+ private:
+  // Clear (0x01) and home (0x02) are the only instructions that need the
+  // long execution delay, so an op only has to remember RS: one bit each.
+  static constexpr uint8_t kSlowCommandMax = 0x03;
+
+  static uint8_t bit8(uint8_t i) { return static_cast<uint8_t>(1u << (i & 7)); }
+  static void enqueue(uint8_t value, bool data);
+
+  // Platform half: AVR port I/O in LcdDriver.cpp, the HD44780 model on the
+  // native sim.
+  static void timerStart();
+  static void timerEnable(bool on);
+  static void busNibble(uint8_t nibble);  // init only, RS low
+  static void busWrite(uint8_t value, bool data);
+
+  static uint8_t _value[kRingSize];
+  static uint8_t _data[kRingSize / 8];  // RS bit per op
+  static volatile uint8_t _head;  // written by main loop
+  static volatile uint8_t _tail;  // written by ISR
+  static volatile uint8_t _wait;  // ticks to hold off after a slow op
+  static uint8_t _rowOffset[4];
+};
@@ -0,0 +1,128 @@
+// Shadow framebuffer for a character LCD: render into RAM, then flush only the
+// cells that differ from what is already on the glass.
+//
+// One copy of the screen is kept, not two: a cell is overwritten only when
+// the new character differs, and then marked dirty until flush() sends it.
+// clear() does not touch the cells; it forgets which were drawn, and cells
+// the new frame leaves undrawn are blanked when it is flushed. So redrawing
+// the same text costs nothing. A cell changed and changed back within one
+// frame is sent again, unchanged.
+#pragma once
+#include <Arduino.h>
+
+#include "DisplayGeometry.h"
+
+struct FlushStats {
+  uint8_t cells = 0;     // data bytes written (changed characters)
+  uint8_t commands = 0;  // cursor-address commands issued
+  bool complete = true;  // false when the op budget ran out first
+  uint16_t busWrites() const { return static_cast<uint16_t>(cells) + commands; }
+};
+
+class LcdFramebuffer {
+ public:
+  static constexpr uint8_t kCols = Panel::kCols;
+  static constexpr uint8_t kRows = Panel::kRows;
+
+  LcdFramebuffer() { invalidate(); }
+
+  // Forget what the glass shows; the next flush rewrites every cell.
+  void invalidate() {
+    memset(_cells, ' ', sizeof(_cells));
+    memset(_dirty, 0xFF, sizeof(_dirty));
+    memset(_drawn, 0xFF, sizeof(_drawn));
+  }
+
+  // Record that the panel was just cleared (e.g. after lcd.clear()).
+  void markCleared() {
+    memset(_cells, ' ', sizeof(_cells));
+    memset(_dirty, 0, sizeof(_dirty));
+    memset(_drawn, 0xFF, sizeof(_drawn));
+  }
+
+  // Blank the pending frame. Does not touch the panel until flush().
+  void clear() { memset(_drawn, 0, sizeof(_drawn)); }
+
+  void putChar(uint8_t col, uint8_t row, char c) {
+    if (col >= kCols || row >= kRows) return;
+    set(index(col, row), c);
+  }
+
+  // Write s at (col,row), padding with spaces (or truncating) to width cells.
+  void print(uint8_t col, uint8_t row, const char* s, uint8_t width) {
+    if (row >= kRows || col >= kCols) return;
+    if (width > kCols - col) width = kCols - col;
+    uint8_t at = index(col, row);
+    uint8_t i = 0;
+    for (; i < width && s[i] != '\0'; ++i) set(at + i, s[i]);
+    for (; i < width; ++i) set(at + i, ' ');
+  }
+
+  // print() for a string in flash (PROGMEM or PSTR()).
+  void printP(uint8_t col, uint8_t row, const char* s, uint8_t width) {
+    if (row >= kRows || col >= kCols) return;
+    if (width > kCols - col) width = kCols - col;
+    uint8_t at = index(col, row);
+    uint8_t i = 0;
+    for (char c; i < width && (c = static_cast<char>(pgm_read_byte(s + i))) != '\0'; ++i) {
+      set(at + i, c);
+    }
+    for (; i < width; ++i) set(at + i, ' ');
+  }
+
+  char cell(uint8_t col, uint8_t row) const {
+    uint8_t i = index(col, row);
+    return test(_drawn, i) ? _cells[i] : ' ';
+  }
+
+  // Push pending changes to the display. Display needs setCursor(col,row) and
+  // write(uint8_t); the HD44780 auto-increments, so a run of adjacent changed
+  // cells costs one cursor command plus one data byte per cell. At most
+  // budget ops are issued; cells left over stay pending for the next call.
+  template <typename Display>
+  FlushStats flush(Display& lcd, uint8_t budget = 0xFF) {
+    for (uint8_t i = 0; i < kCells; ++i) {
+      if (!test(_drawn, i)) set(i, ' ');
+    }
+    FlushStats stats;
+    for (uint8_t row = 0; row < kRows; ++row) {
+      uint8_t cursorCol = 0xFF;  // unknown
+      for (uint8_t col = 0; col < kCols; ++col) {
+        uint8_t i = index(col, row);
+        if (!test(_dirty, i)) continue;
+        uint8_t cost = (cursorCol != col) ? 2 : 1;
+        if (stats.busWrites() + cost > budget) {
+          stats.complete = false;
+          return stats;
+        }
+        if (cursorCol != col) {
+          lcd.setCursor(col, row);
+          ++stats.commands;
+        }
+        lcd.write(static_cast<uint8_t>(_cells[i]));
+        _dirty[i >> 3] = static_cast<uint8_t>(_dirty[i >> 3] & ~(1 << (i & 7)));
+        cursorCol = col + 1;
+        ++stats.cells;
+      }
+    }
+    return stats;
+  }
+
+ private:
+  static constexpr uint8_t kCells = kCols * kRows;
+
+  static uint8_t index(uint8_t col, uint8_t row) { return static_cast<uint8_t>(row * kCols + col); }
+  static bool test(const uint8_t* bits, uint8_t i) { return bits[i >> 3] & (1 << (i & 7)); }
+
+  void set(uint8_t i, char c) {
+    uint8_t mask = static_cast<uint8_t>(1 << (i & 7));
+    _drawn[i >> 3] = static_cast<uint8_t>(_drawn[i >> 3] | mask);
+    if (_cells[i] == c) return;
+    _cells[i] = c;
+    _dirty[i >> 3] = static_cast<uint8_t>(_dirty[i >> 3] | mask);
+  }
+
+  char _cells[kCells];               // the glass, plus the changes not yet sent
+  uint8_t _dirty[(kCells + 7) / 8];  // cells flush() still has to send
+  uint8_t _drawn[(kCells + 7) / 8];  // cells written since clear()
+};
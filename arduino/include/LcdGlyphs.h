@@ -0,0 +1,71 @@
+// Custom HD44780 glyph sets and the CGRAM upload cache.
+//
+// The controller has 8 user-definable characters (64 bytes of CGRAM). A view
+// asks for the set it draws with; upload() writes it through the driver's op
+// ring a budget at a time and only when the wanted set differs from the one
+// already in CGRAM, so repainting a graph costs nothing but its cells.
+// Glyphs are addressed as codes 8-15, the controller's mirror of 0-7, so a
+// glyph is never 0 and never reads as a string terminator.
+#pragma once
+#include <Arduino.h>
+
+enum class GlyphSet : uint8_t {
+  None = 0,
+  Spark = 1,  // glyph n: bottom n+1 pixel rows lit (eight-step column)
+  Bar = 2,    // glyph n: left n+1 pixel columns lit (five-step bar cell)
+};
+
+class LcdGlyphs {
+ public:
+  static constexpr uint8_t kGlyphs = 8;
+  static constexpr uint8_t kBytes = kGlyphs * 8;
+  static constexpr uint8_t kFirstCode = 8;
+  static constexpr uint8_t kBarSteps = 5;  // pixel columns per cell
+
+  static char spark(uint8_t level) { return static_cast<char>(kFirstCode + (level & 7)); }
+  static char bar(uint8_t columns) {  // 1..kBarSteps
+    return static_cast<char>(kFirstCode + columns - 1);
+  }
+
+  // Pixel row (5 low bits, row 0 on top) of glyph n in set.
+  static uint8_t row(GlyphSet set, uint8_t n, uint8_t r) {
+    switch (set) {
+      case GlyphSet::Spark:
+        return (r >= 7 - n) ? 0x1F : 0x00;
+      case GlyphSet::Bar:
+        if (n >= kBarSteps || r == 0 || r == 7) return 0x00;
+        return static_cast<uint8_t>((0x1F << (kBarSteps - 1 - n)) & 0x1F);
+      default:
+        return 0x00;
+    }
+  }
+
+  void want(GlyphSet set) {
+    if (set == _wanted) return;
+    _wanted = set;
+    _loaded = GlyphSet::None;  // CGRAM is about to change under the old set
+    _next = 0;
+  }
+  bool ready() const { return _loaded == _wanted; }
+
+  // Queue the rest of the wanted set, at most budget ops (each pass starts
+  // with its own CGRAM address, so a later setCursor() can run in between).
+  // Display needs setCgramAddress(addr) and write(uint8_t). Returns the ops
+  // queued.
+  template <typename Display>
+  uint8_t upload(Display& lcd, uint8_t budget) {
+    if (ready() || budget < 2) return 0;
+    lcd.setCgramAddress(_next);
+    uint8_t ops = 1;
+    for (; _next < kBytes && ops < budget; ++_next, ++ops) {
+      lcd.write(row(_wanted, _next >> 3, _next & 7));
+    }
+    if (_next == kBytes) _loaded = _wanted;
+    return ops;
+  }
+
+ private:
+  GlyphSet _wanted = GlyphSet::None;
+  GlyphSet _loaded = GlyphSet::None;  // set fully present in CGRAM
+  uint8_t _next = 0;                  // next CGRAM byte of _wanted to write
+};
@@ -0,0 +1,100 @@
+// Shared pool of LCD line slots.
+//
+// Telemetry lines, the lines FrameParser stages for the next frame and the
+// command menu all borrow slots from one arena instead of owning separate
+// arrays. The UI never needs telemetry and the menu at once: main.cpp
+// releases the telemetry lines when a command list arrives and refetches
+// them when the menu closes, so the pool is sized for the larger user rather
+// than the sum. See MemoryBudget.h for how it fits the 2 KB of SRAM.
+//
+// Width is the line length (the panel's columns) and Slots the pool size;
+// both come from DisplayGeometry via ScrollBuffer. A line up to twice as wide
+// (a marquee line) continues in a second slot linked to the first; releasing
+// the first returns both. The link costs no memory of its own: only a slot
+// that is full gets a continuation, so its last byte, the terminator, holds
+// the continuation's id + 1 instead (0 still means none).
+#pragma once
+#include <Arduino.h>
+
+template <size_t Width, uint8_t Slots>
+class LineArena {
+ public:
+  static_assert(Slots > 0 && Slots < 0xFF, "slot ids are bytes and 0xFF means none");
+
+  static constexpr size_t kWidth = Width;
+  static constexpr uint8_t kSlots = Slots;
+  static constexpr uint8_t kNone = 0xFF;  // no slot (an empty line)
+
+  LineArena() { reset(); }
+
+  void reset() {
+    memset(_used, 0, sizeof(_used));
+    _free = kSlots;
+  }
+
+  // Claim a slot holding an empty string; kNone when the pool is exhausted.
+  uint8_t alloc() {
+    if (_free == 0) return kNone;
+    for (uint8_t byte = 0; byte < sizeof(_used); ++byte) {
+      uint8_t bits = _used[byte];
+      if (bits == 0xFF) continue;
+      uint8_t bit = 0;
+      while (bits & (1 << bit)) ++bit;
+      uint8_t slot = static_cast<uint8_t>(byte * 8 + bit);
+      if (slot >= kSlots) break;
+      _used[byte] = static_cast<uint8_t>(bits | (1 << bit));
+      --_free;
+      _lines[slot][0] = '\0';
+      _lines[slot][kWidth] = '\0';
+      return slot;
+    }
+    return kNone;
+  }
+
+  // Return a slot and its continuation to the pool; kNone is ignored.
+  void release(uint8_t slot) {
+    if (slot >= kSlots) return;
+    uint8_t mask = static_cast<uint8_t>(1 << (slot & 7));
+    if ((_used[slot >> 3] & mask) == 0) return;
+    _used[slot >> 3] = static_cast<uint8_t>(_used[slot >> 3] & ~mask);
+    ++_free;
+    trim(slot);
+  }
+
+  // Continuation of slot, claimed on first use; kNone when the pool is
+  // exhausted. Only a line's first slot is ever extended, once it holds
+  // kWidth chars.
+  uint8_t extend(uint8_t slot) {
+    uint8_t tail = next(slot);
+    if (tail == kNone) {
+      tail = alloc();
+      if (tail != kNone) _lines[slot][kWidth] = static_cast<char>(tail + 1);
+    }
+    return tail;
+  }
+  uint8_t next(uint8_t slot) const {
+    uint8_t link = static_cast<uint8_t>(_lines[slot][kWidth]);
+    return (link != 0) ? static_cast<uint8_t>(link - 1) : kNone;
+  }
+
+  // Release slot's continuation, if any, leaving it a kWidth line.
+  void trim(uint8_t slot) {
+    uint8_t tail = next(slot);
+    _lines[slot][kWidth] = '\0';
+    release(tail);
+  }
+
+  uint8_t available() const { return _free; }
+
+  // Slot text, NUL-terminated within kWidth chars unless the slot has a
+  // continuation; read a line that may have one with a kWidth bound. Writers
+  // leave byte kWidth alone unless they store a terminator there. Only valid
+  // for slots returned by alloc().
+  char* line(uint8_t slot) { return _lines[slot]; }
+  const char* line(uint8_t slot) const { return _lines[slot]; }
+
+ private:
+  char _lines[kSlots][kWidth + 1];  // byte kWidth: terminator or link, see next()
+  uint8_t _used[(kSlots + 7) / 8];  // one bit per slot
+  uint8_t _free;
+};
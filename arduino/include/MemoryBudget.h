@@ -0,0 +1,46 @@
+// Compile-time SRAM budget for the ATmega328 (2048 bytes).
+//
+// The large buffers are summed block by block; sketch scalars, core state and
+// any string literal still copied to .data get a fixed allowance (screen and
+// reply text is kept in flash, see TextFormat.h), and whatever is left is the
+// stack. The AVR build fails when a change pushes the blocks past
+// their share; panel-sized blocks follow the build's DisplayGeometry, so each
+// panel env is checked on its own. `make arduino-size` prints the linker's
+// totals and the largest symbols; `make arduino-bench` reports the stack
+// high-water mark that the reserve has to cover.
+#pragma once
+#include <Arduino.h>
+
+#include "DisplayGeometry.h"
+#include "FrameParser.h"
+#include "LcdDriver.h"
+#include "LcdFramebuffer.h"
+#include "MetricHistory.h"
+#include "SerialLink.h"
+
+struct MemoryBudget {
+  static constexpr uint16_t kSram = 2048;
+  static constexpr uint16_t kStackReserve = 224;  // deepest loop() chain plus an ISR frame
+  static constexpr uint16_t kOtherStatics = 352;  // sketch scalars, core, stray literals
+
+  static constexpr uint16_t kLineArena = sizeof(Panel::Arena);
+  static constexpr uint16_t kScrollBuffer = sizeof(Panel::Buffer);
+  // main.cpp commandPages (2 x page, loaded flag, slot ids) and menuStack (4 x i16)
+  static constexpr uint16_t kCommandPages = 2 * (2 + Panel::Buffer::kStageGuarantee) + 4 * 2;
+  static constexpr uint16_t kFrameParser = sizeof(FrameParser);
+  static constexpr uint16_t kFramebuffer = sizeof(LcdFramebuffer);
+  static constexpr uint16_t kLcdRing = LcdDriver::kRingSize + LcdDriver::kRingSize / 8;
+  static constexpr uint16_t kMetricHistory = sizeof(MetricHistory);
+  static constexpr uint16_t kRxRing = SerialLink::kRxCapacity;
+
+  static constexpr uint16_t kBlocks = kLineArena + kScrollBuffer + kCommandPages +
+                                      kFrameParser + kFramebuffer + kLcdRing + kMetricHistory +
+                                      kRxRing;
+  static constexpr uint16_t kBlocksLimit = kSram - kStackReserve - kOtherStatics;
+};
+
+#ifdef __AVR__
+// Host builds have wider pointers and size_t, so only the target is checked.
+static_assert(MemoryBudget::kBlocks <= MemoryBudget::kBlocksLimit,
+              "static SRAM over budget; see make arduino-size");
+#endif
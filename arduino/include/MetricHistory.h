@@ -0,0 +1,83 @@
+// Recent samples of the numeric fields the daemon flags for history.
+//
+// The layout frame marks up to kMetrics fields (NumericLayout format bit 6,
+// e.g. CPU load, GPU load, temperature); every committed layout or values
+// frame adds one sample per field, read back from the cells it was printed
+// into. Samples are quantised to kLevels steps over 0..100 and packed two to
+// a byte, so the history view costs a few dozen bytes of SRAM instead of a
+// line slot per metric.
+#pragma once
+#include <Arduino.h>
+
+#include "NumericLayout.h"
+
+class MetricHistory {
+ public:
+  static constexpr uint8_t kMetrics = 3;
+  static constexpr uint8_t kDepth = 16;   // samples kept per metric (even)
+  static constexpr uint8_t kLevels = 16;  // 4-bit samples
+  static constexpr int16_t kFullScale = 100;
+
+  MetricHistory() { clear(); }
+
+  // Forget the tracked fields and every sample.
+  void clear() {
+    _layoutId = NumericLayout::kNone;
+    _metrics = 0;
+    _count = 0;
+    _head = 0;
+    memset(_samples, 0, sizeof(_samples));
+  }
+
+  // Follow the flagged fields of layout id. A resent layout (same id) keeps
+  // the samples; a new one starts over.
+  void track(const NumericLayout& layout, uint8_t id) {
+    if (id == _layoutId) return;
+    clear();
+    _layoutId = id;
+    for (uint8_t f = 0; f < layout.count() && _metrics < kMetrics; ++f) {
+      const NumericLayout::Entry* e = layout.entry(f);
+      if (e != nullptr && NumericLayout::historyOf(e->fmt)) _fields[_metrics++] = f;
+    }
+  }
+
+  uint8_t metrics() const { return _metrics; }
+  uint8_t field(uint8_t metric) const { return _fields[metric]; }
+  uint8_t size() const { return _count; }
+
+  // Store metric's value for the sample being taken; commit() closes it.
+  void record(uint8_t metric, int16_t value) {
+    uint8_t& pair = _samples[metric][_head >> 1];
+    uint8_t level = levelOf(value);
+    pair = (_head & 1) ? static_cast<uint8_t>((pair & 0x0F) | (level << 4))
+                       : static_cast<uint8_t>((pair & 0xF0) | level);
+  }
+  void commit() {
+    _head = static_cast<uint8_t>((_head + 1) & (kDepth - 1));
+    if (_count < kDepth) ++_count;
+  }
+
+  // Level (0..kLevels-1) of metric's sample age commits ago (0 = newest).
+  uint8_t level(uint8_t metric, uint8_t age) const {
+    uint8_t i = static_cast<uint8_t>((_head + kDepth - 1 - age) & (kDepth - 1));
+    uint8_t pair = _samples[metric][i >> 1];
+    return (i & 1) ? (pair >> 4) : (pair & 0x0F);
+  }
+
+  // value clamped to 0..kFullScale and scaled to a level, rounding to nearest.
+  static uint8_t levelOf(int16_t value) {
+    if (value < 0) value = 0;
+    if (value > kFullScale) value = kFullScale;
+    return static_cast<uint8_t>((value * (kLevels - 1) + kFullScale / 2) / kFullScale);
+  }
+
+ private:
+  static_assert((kDepth & (kDepth - 1)) == 0, "ring index is masked");
+
+  uint8_t _samples[kMetrics][kDepth / 2];
+  uint8_t _fields[kMetrics];
+  uint8_t _layoutId;
+  uint8_t _metrics;  // fields tracked
+  uint8_t _count;    // samples held
+  uint8_t _head;     // next sample slot
+};
@@ -0,0 +1,124 @@
+// Numeric telemetry channel: field positions cached from a layout frame.
+//
+// A layout frame ('L', see FrameParser.h) carries the telemetry lines with
+// their labels and units plus one entry per numeric field: the line and
+// column it occupies and how to print it. Later values frames ('V') carry
+// only (field, int16) pairs; each value is printed on the device straight
+// into its line, so a steady-state update costs 3 bytes per changed metric
+// instead of a whole line of text.
+#pragma once
+#include <Arduino.h>
+
+class NumericLayout {
+ public:
+  static constexpr uint8_t kMaxFields = 12;
+  static constexpr uint8_t kNone = 0;  // layout id meaning "no layout"
+
+  // Format byte: bits 0-3 width (1..15 chars), bits 4-5 decimals (0..3),
+  // bit 6 keep a history of the field on the device (MetricHistory.h).
+  static uint8_t widthOf(uint8_t fmt) { return fmt & 0x0F; }
+  static uint8_t decimalsOf(uint8_t fmt) { return (fmt >> 4) & 0x03; }
+  static bool historyOf(uint8_t fmt) { return (fmt & 0x40) != 0; }
+
+  struct Entry {
+    uint8_t line;  // absolute telemetry line (oldest=0)
+    uint8_t col;
+    uint8_t fmt;
+  };
+
+  NumericLayout() { clear(); }
+
+  // Forget the cached layout; values frames are refused until the next one.
+  void clear() {
+    _id = kNone;
+    _count = 0;
+  }
+
+  // Collect entries of a layout frame; the layout only answers to its id
+  // once activate() confirms the frame arrived intact. Entries past
+  // kMaxFields are dropped.
+  void add(uint8_t line, uint8_t col, uint8_t fmt) {
+    if (_count < kMaxFields) _entries[_count] = {line, col, fmt};
+    if (_count < 0xFF) ++_count;  // field ids stay aligned; entry() ignores the excess
+  }
+  void activate(uint8_t id) { _id = id; }
+
+  bool matches(uint8_t id) const { return _id != kNone && _id == id; }
+  const Entry* entry(uint8_t field) const {
+    if (field >= _count || field >= kMaxFields || widthOf(_entries[field].fmt) == 0) {
+      return nullptr;
+    }
+    return &_entries[field];
+  }
+  uint8_t count() const { return (_count < kMaxFields) ? _count : kMaxFields; }
+
+  // Print value into exactly widthOf(fmt) chars at out: right-aligned, with
+  // decimalsOf(fmt) implied decimals ("12.3" for 123 with one decimal).
+  // A value that does not fit shows as '#' in every cell. Not terminated.
+  static void format(int16_t value, uint8_t fmt, char* out) {
+    uint8_t width = widthOf(fmt);
+    uint8_t decimals = decimalsOf(fmt);
+    char digits[10];  // reversed: up to 5 digits, '.', 3 decimals' padding, '-'
+    uint8_t n = 0;
+    uint16_t mag = (value < 0) ? static_cast<uint16_t>(-static_cast<int32_t>(value))
+                               : static_cast<uint16_t>(value);
+    for (uint8_t i = 0; i < decimals; ++i) {
+      digits[n++] = static_cast<char>('0' + mag % 10);
+      mag /= 10;
+    }
+    if (decimals != 0) digits[n++] = '.';
+    do {
+      digits[n++] = static_cast<char>('0' + mag % 10);
+      mag /= 10;
+    } while (mag != 0);
+    if (value < 0) digits[n++] = '-';
+
+    if (n > width) {
+      memset(out, '#', width);
+      return;
+    }
+    uint8_t pad = static_cast<uint8_t>(width - n);
+    memset(out, ' ', pad);
+    for (uint8_t i = 0; i < n; ++i) out[pad + i] = digits[n - 1 - i];
+  }
+
+  // Print value into line text (at most lineWidth chars, NUL-terminated when
+  // shorter) at the entry's column, padding a short line with spaces. A field
+  // that does not fit inside lineWidth is left alone rather than shown cut.
+  static void patch(char* line, uint8_t lineWidth, const Entry& e, int16_t value) {
+    uint8_t width = widthOf(e.fmt);
+    if (e.col + width > lineWidth) return;
+    char cells[15];
+    format(value, e.fmt, cells);
+    uint8_t len = static_cast<uint8_t>(strnlen(line, lineWidth));
+    while (len < e.col) line[len++] = ' ';
+    memcpy(line + e.col, cells, width);
+    if (len < e.col + width) line[e.col + width] = '\0';
+  }
+
+  // Whole-number part of the value shown in the entry's cells of line; 0
+  // for cells that are blank, past the end of the line or '#'-filled.
+  static int16_t parse(const char* line, const Entry& e) {
+    uint8_t len = static_cast<uint8_t>(strlen(line));
+    uint8_t end = static_cast<uint8_t>(e.col + widthOf(e.fmt));
+    if (end > len) end = len;
+    int16_t value = 0;
+    bool negative = false;
+    for (uint8_t i = e.col; i < end; ++i) {
+      char c = line[i];
+      if (c == '-') {
+        negative = true;
+      } else if (c >= '0' && c <= '9') {
+        value = static_cast<int16_t>(value * 10 + (c - '0'));
+      } else if (c == '.') {
+        break;
+      }
+    }
+    return negative ? static_cast<int16_t>(-value) : value;
+  }
+
+ private:
+  Entry _entries[kMaxFields];
+  uint8_t _id;
+  uint8_t _count;
+};
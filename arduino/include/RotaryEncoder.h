@@ -1,36 +1,42 @@
 #pragma once
 #include <Arduino.h>
 
+// Quadrature decoder for the panel encoder.
+//
+// A and B are wired to D2/D3 (PD2/PD3, INT0/INT1), so the ISR samples both
+// with a single PIND read instead of two digitalRead() calls, and decodes the
+// (previous, current) pair through a 16-entry table in flash.
 class RotaryEncoder {
 public:
-    static void init(uint8_t pinA, uint8_t pinB) {
-        _pinA = pinA;
-        _pinB = pinB;
-        pinMode(_pinA, INPUT_PULLUP);
-        pinMode(_pinB, INPUT_PULLUP);
-        _lastEncoded = (digitalRead(_pinB) << 1) | digitalRead(_pinA);
+    static constexpr uint8_t kPinA = 2;  // PD2
+    static constexpr uint8_t kPinB = 3;  // PD3
+
+    // Acceleration: detents closer together than kAccelWindowMs count for
+    // more lines, up to kAccelMaxFactor each.
+    static constexpr uint8_t kAccelWindowMs = 50;
+    static constexpr uint8_t kAccelStepMs = 16;
+    static constexpr int16_t kAccelMaxFactor = 4;
+
+    static void init() {
+        pinMode(kPinA, INPUT_PULLUP);
+        pinMode(kPinB, INPUT_PULLUP);
+        _lastEncoded = readPins();
     }
 
     static void handleInterrupt() {
-        // Get current state
-        uint8_t MSB = digitalRead(_pinA);
-        uint8_t LSB = digitalRead(_pinB);
-        uint8_t encoded = (MSB << 1) | LSB;
-        
-        uint8_t sum = (_lastEncoded << 2) | encoded;
+        uint8_t encoded = readPins();
+        int8_t step = static_cast<int8_t>(
+            pgm_read_byte(&kTransitions[(_lastEncoded << 2) | encoded]));
         _lastEncoded = encoded;
-
-        // Table for valid rotations and their directions
-        if(sum == 0b1101 || sum == 0b0100 || sum == 0b0010 || sum == 0b1011) {
-            _position++;
-            _changed = true;
-        }
-        else if(sum == 0b1110 || sum == 0b0111 || sum == 0b0001 || sum == 0b1000) {
-            _position--;
+        if (step != 0) {
+            _position += step;
             _changed = true;
         }
     }
 
+    // Movement waiting to be collected by getMovement().
+    static bool pending() { return _changed; }
+
     static int16_t getMovement() {
         noInterrupts();
         int16_t change = 0;
@@ -44,10 +50,41 @@ public:
         return change;
     }
 
+    // getMovement() scaled by spin speed, for scrolling. The gap is measured
+    // between collections, so a burst collected at once is averaged over its
+    // detents; a change of direction always starts again at one line.
+    static int16_t getAcceleratedMovement(unsigned long now) {
+        int16_t steps = getMovement();
+        if (steps == 0) return 0;
+        int16_t count = steps < 0 ? -steps : steps;
+        unsigned long gap = (now - _lastDetentMs) / static_cast<unsigned long>(count);
+        bool sameWay = (steps < 0) == (_lastSteps < 0);
+        _lastDetentMs = now;
+        _lastSteps = steps;
+        if (!sameWay || gap >= kAccelWindowMs) return steps;
+        int16_t factor = 1 + static_cast<int16_t>((kAccelWindowMs - gap) / kAccelStepMs);
+        if (factor > kAccelMaxFactor) factor = kAccelMaxFactor;
+        return static_cast<int16_t>(steps * factor);
+    }
+
 private:
-    static uint8_t _pinA;
-    static uint8_t _pinB;
+    // Current (A,B) as bits 1,0.
+#ifdef __AVR__
+    static uint8_t readPins() {
+        uint8_t pins = PIND;
+        return static_cast<uint8_t>(((pins >> (PD2 - 1)) & 0x02) | ((pins >> PD3) & 0x01));
+    }
+#else
+    static uint8_t readPins();  // sim/SimCore.cpp
+#endif
+
+    // Indexed by (previous << 2) | current: +1 clockwise, -1 counter-clockwise,
+    // 0 for no change or an invalid (bounced) double transition.
+    static const int8_t kTransitions[16] PROGMEM;
+
     static uint8_t _lastEncoded;
     static volatile int16_t _position;
     static volatile bool _changed;
-};
\ No newline at end of file
+    static unsigned long _lastDetentMs;  // main loop only
+    static int16_t _lastSteps;
+};
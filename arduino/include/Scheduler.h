@@ -0,0 +1,59 @@
+// Deadline table for the cooperative main loop.
+//
+// Each task is a small integer id that is either disarmed or armed with a
+// millis() deadline. loop() polls due() for the tasks it owns, then calls
+// idle(), which puts the MCU in idle sleep unless work is already waiting.
+// Any interrupt wakes it: UART RX, the encoder/button pins, or the Timer0
+// overflow behind millis(). That 1.024 ms tick bounds how late a deadline is
+// noticed and closes the race between checking for work and sleeping.
+#pragma once
+#include <Arduino.h>
+#ifdef __AVR__
+#include <avr/sleep.h>
+#endif
+
+template <uint8_t N>
+class Scheduler {
+  static_assert(N <= 16, "task mask is two bytes");
+
+ public:
+  void at(uint8_t task, unsigned long when) {
+    _deadline[task] = when;
+    _armed |= maskOf(task);
+  }
+
+  void cancel(uint8_t task) { _armed &= static_cast<uint16_t>(~maskOf(task)); }
+
+  bool armed(uint8_t task) const { return (_armed & maskOf(task)) != 0; }
+
+  // True once per arming when the deadline has passed; disarms the task.
+  bool due(uint8_t task, unsigned long now) {
+    if (!armed(task) || static_cast<long>(now - _deadline[task]) < 0) return false;
+    cancel(task);
+    return true;
+  }
+
+  bool anyDue(unsigned long now) const {
+    for (uint8_t t = 0; t < N; ++t) {
+      if (armed(t) && static_cast<long>(now - _deadline[t]) >= 0) return true;
+    }
+    return false;
+  }
+
+  // Sleep until the next interrupt unless work is pending or a task is due.
+  void idle(bool workPending) const {
+    if (workPending || anyDue(millis())) return;
+#ifdef __AVR__
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    sleep_mode();
+#else
+    delay(1);  // native sim: stands in for the next Timer0 wake
+#endif
+  }
+
+ private:
+  static uint16_t maskOf(uint8_t task) { return static_cast<uint16_t>(1u << task); }
+
+  unsigned long _deadline[N] = {};
+  uint16_t _armed = 0;
+};
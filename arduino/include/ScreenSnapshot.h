@@ -0,0 +1,129 @@
+// Last telemetry screen kept in EEPROM, shown at boot until the daemon's
+// first frame replaces it.
+//
+// A record holds the visible rows as the panel showed them (not the whole
+// scroll buffer, which would not fit twice in 1 KB), the META interval and
+// the geometry it was taken on, so a snapshot from another panel build is
+// ignored:
+//
+//   [seq:2][cols][rows][interval ms:4][rows x cols text, NUL padded][crc:2]
+//
+// Records rotate through EEPROM, each save going to the slot after the
+// newest, so every cell is written once per kRecords saves; bytes that
+// already hold the right value are not rewritten at all. The CRC is written
+// last: a save cut short by a reset leaves a record that fails it, and the
+// one before it is still found. Saving is paced by the caller, one byte per
+// put() whenever ready() (an AVR EEPROM write takes 3.4 ms), so loop() never
+// waits on the EEPROM.
+#pragma once
+#include <Arduino.h>
+
+#include "Crc16.h"
+#include "DisplayGeometry.h"
+
+class ScreenSnapshot {
+ public:
+  static constexpr uint16_t kEepromSize = 1024;  // ATmega328P
+  static constexpr uint8_t kCols = Panel::kCols;
+  static constexpr uint8_t kRows = Panel::kRows;
+  static constexpr uint8_t kText = 8;  // offset of the first text cell
+  static constexpr uint16_t kRecordSize = kText + kCols * kRows + 2;
+  static constexpr uint8_t kRecords = static_cast<uint8_t>(kEepromSize / kRecordSize);
+  static_assert(kRecordSize < 0xFF, "put() counts record bytes in a uint8_t");
+  static_assert(kRecords >= 2, "a torn save must leave an older record");
+
+  // Hardware half (src/ScreenSnapshot.cpp on AVR, sim/SimCore.cpp natively).
+  static bool ready();  // the last byte written has landed
+  static uint8_t readByte(uint16_t addr);
+  static void updateByte(uint16_t addr, uint8_t value);  // skips an equal byte
+
+  // Find the newest intact record for this panel; false when there is none.
+  // Saves continue in the slot after it.
+  bool load() {
+    bool found = false;
+    for (uint8_t slot = 0; slot < kRecords; ++slot) {
+      if (!intact(slot)) continue;
+      uint16_t seq = read16(base(slot));
+      if (!found || static_cast<int16_t>(seq - _seq) > 0) {
+        _slot = slot;
+        _seq = seq;
+        found = true;
+      }
+    }
+    return found;
+  }
+
+  // Contents of the record load() found.
+  uint32_t intervalMs() const {
+    uint16_t at = base(_slot) + 4;
+    return read16(at) | static_cast<uint32_t>(read16(at + 2)) << 16;
+  }
+  void row(uint8_t r, char out[kCols + 1]) const {
+    uint16_t at = base(_slot) + kText + r * kCols;
+    for (uint8_t c = 0; c < kCols; ++c) out[c] = static_cast<char>(readByte(at + c));
+    out[kCols] = '\0';
+  }
+
+  // Start a record in the next slot; put() then writes it a byte at a time.
+  void begin(uint32_t intervalMs) {
+    _slot = static_cast<uint8_t>((_slot + 1) % kRecords);
+    ++_seq;
+    _interval = intervalMs;
+    _crc = CRC16_INIT;
+    _pos = 0;
+  }
+  bool saving() const { return _pos < kRecordSize; }
+  // Forget a save in progress; its slot fails the CRC until written again.
+  void abort() { _pos = kRecordSize; }
+
+  // True when the next byte is a text cell; the caller passes its char to put().
+  bool cell(uint8_t* row, uint8_t* col) const {
+    if (_pos < kText || _pos >= kText + kCols * kRows) return false;
+    *row = static_cast<uint8_t>((_pos - kText) / kCols);
+    *col = static_cast<uint8_t>((_pos - kText) % kCols);
+    return true;
+  }
+
+  // Write the next byte of the record; c is only used for a text cell.
+  // Call while saving() and ready().
+  void put(char c) {
+    uint8_t b;
+    if (_pos < 2) {
+      b = static_cast<uint8_t>(_seq >> (8 * _pos));
+    } else if (_pos == 2) {
+      b = kCols;
+    } else if (_pos == 3) {
+      b = kRows;
+    } else if (_pos < kText) {
+      b = static_cast<uint8_t>(_interval >> (8 * (_pos - 4)));
+    } else if (_pos < kRecordSize - 2) {
+      b = static_cast<uint8_t>(c);
+    } else {
+      b = static_cast<uint8_t>(_crc >> (8 * (_pos - (kRecordSize - 2))));
+    }
+    updateByte(base(_slot) + _pos, b);
+    if (_pos < kRecordSize - 2) _crc = crc16Update(_crc, b);
+    ++_pos;
+  }
+
+ private:
+  static uint16_t base(uint8_t slot) { return static_cast<uint16_t>(slot * kRecordSize); }
+
+  static uint16_t read16(uint16_t addr) {
+    return static_cast<uint16_t>(readByte(addr) | readByte(addr + 1) << 8);
+  }
+
+  static bool intact(uint8_t slot) {
+    uint16_t at = base(slot);
+    if (readByte(at + 2) != kCols || readByte(at + 3) != kRows) return false;
+    uint16_t crc = CRC16_INIT;
+    for (uint16_t i = 0; i < kRecordSize - 2; ++i) crc = crc16Update(crc, readByte(at + i));
+    return crc == read16(at + kRecordSize - 2);
+  }
+
+  uint8_t _slot = kRecords - 1;  // newest record; the first save goes to slot 0
+  uint8_t _pos = kRecordSize;    // next byte put() writes; kRecordSize when idle
+  uint16_t _seq = 0;
+  uint16_t _crc = CRC16_INIT;
+  uint32_t _interval = 0;
+};
@@ -1,53 +1,253 @@
-// Simple fixed-size scroll buffer for 20-char LCD lines
+// Simple fixed-size scroll buffer for LCD lines
+//
+// Width is the line length and Capacity the number of lines kept; Slots sizes
+// the LineArena both share with the frame being staged (a quarter more than
+// Capacity by default). DisplayGeometry.h picks all three per panel. A
+// power-of-two Capacity wraps the ring with a mask instead of a division.
+//
+// Line text lives in LineArena slots; the ring only holds one slot id per
+// line (Arena::kNone for an empty line). Incoming frames are written
+// straight into staged back slots (backSlot) from the same arena and
+// committed by moving ids: swap() for a full frame, adoptStaged() for a
+// delta, whose lines are staged at their own index. Committing never copies
+// line text. A telemetry line wider than Width keeps the rest, up to
+// kLongWidth, in a continuation slot (tail()) that moves with its first one.
 #pragma once
 #include <Arduino.h>
 
+#include "LineArena.h"
+
+template <size_t Width, size_t Capacity, uint8_t Slots = Capacity + Capacity / 4>
 class ScrollBuffer {
  public:
-  static constexpr size_t kWidth = 20;
-  static constexpr size_t kCapacity = 12;  // number of lines stored (limit)
+  using Arena = LineArena<Width, Slots>;
+
+  static constexpr size_t kWidth = Width;
+  static constexpr size_t kCapacity = Capacity;  // number of lines stored (limit)
+  static constexpr size_t kLongWidth = 2 * Width;  // a line with a continuation
+  // Lines a frame can always stage, even while the ring is full.
+  static constexpr size_t kStageGuarantee = Slots - Capacity;
+  static_assert(Capacity > 0 && Capacity < 0x100, "ring positions are bytes");
+  static_assert(Slots > Capacity, "arena must leave slots for staging");
 
-  ScrollBuffer() { clear(); }
+  explicit ScrollBuffer(Arena& arena) : _arena(arena) {
+    memset(_ring, Arena::kNone, sizeof(_ring));
+    memset(_back, Arena::kNone, sizeof(_back));
+  }
 
+  // Drop every line and hand its slot back to the arena.
   void clear() {
-    _count = 0;
-    _head = 0;
     for (size_t i = 0; i < kCapacity; ++i) {
-      _lines[i][0] = '\0';
+      _arena.release(_ring[i]);
+      _ring[i] = Arena::kNone;
     }
+    _count = 0;
+    _head = 0;
   }
 
   void push(const char* s) {
-    // Truncate to kWidth and copy
-    char* slot = _lines[_head];
-    size_t i = 0;
-    for (; i < kWidth && s[i] != '\0'; ++i) {
-      slot[i] = s[i];
-    }
-    slot[i] = '\0';
+    // When full, _head is the oldest line and its slot is reused.
+    uint8_t& slot = _ring[_head];
+    if (slot == Arena::kNone) slot = _arena.alloc();
+    if (slot != Arena::kNone) copyLine(slot, s);
 
-    _head = (_head + 1) % kCapacity;
+    _head = static_cast<uint8_t>(wrap(_head + 1));
     if (_count < kCapacity) {
       ++_count;
     }
   }
 
+  // Overwrite line at absolute index (oldest=0); out-of-range is ignored, as
+  // is a blank line when the arena has no slot left for it.
+  void set(size_t index, const char* s) {
+    if (index >= _count) return;
+    uint8_t& slot = _ring[slotOf(index)];
+    if (slot == Arena::kNone) slot = _arena.alloc();
+    if (slot != Arena::kNone) copyLine(slot, s);
+  }
+
+  // Append blank lines or drop the newest ones until size() == n. Blank
+  // lines take no slot until they are written.
+  void resize(size_t n) {
+    if (n > kCapacity) n = kCapacity;
+    while (_count < n) {
+      _head = static_cast<uint8_t>(wrap(_head + 1));
+      ++_count;
+    }
+    if (n < _count) {
+      uint8_t head = static_cast<uint8_t>(slotOf(n));
+      for (size_t i = n; i < _count; ++i) {
+        uint8_t& slot = _ring[slotOf(i)];
+        _arena.release(slot);
+        slot = Arena::kNone;
+      }
+      _head = head;
+      _count = static_cast<uint8_t>(n);
+    }
+  }
+
+  // Writable text of the line at absolute index, for patching in place. A
+  // long line is not terminated (see LineArena::line()): the caller reads it
+  // with a kWidth bound and writes only its first kWidth chars. A blank line
+  // claims a slot first; nullptr when out of range or the arena is exhausted.
+  char* edit(size_t index) {
+    if (index >= _count) return nullptr;
+    uint8_t& slot = _ring[slotOf(index)];
+    if (slot == Arena::kNone) slot = _arena.alloc();
+    return (slot != Arena::kNone) ? _arena.line(slot) : nullptr;
+  }
+
   size_t size() const { return _count; }
 
   // Get line by absolute index from oldest=0 to newest=size-1
   void get(size_t index, char out[kWidth + 1]) const {
-    if (index >= _count) {
+    uint8_t slot = (index < _count) ? _ring[slotOf(index)] : Arena::kNone;
+    if (slot == Arena::kNone) {
       out[0] = '\0';
       return;
     }
-    size_t oldest = (_count == kCapacity) ? _head : 0;
-    size_t pos = (oldest + index) % kCapacity;
-    strncpy(out, _lines[pos], kWidth + 1);
+    strncpy(out, _arena.line(slot), kWidth + 1);
     out[kWidth] = '\0';
   }
 
+  // Characters of the line at index past kWidth; "" for a line that fits.
+  const char* tail(size_t index) const {
+    uint8_t slot = (index < _count) ? _ring[slotOf(index)] : Arena::kNone;
+    if (slot == Arena::kNone || _arena.next(slot) == Arena::kNone) return "";
+    return _arena.line(_arena.next(slot));
+  }
+
+  // Writable staging slot i, claimed from the arena on first use and cut
+  // back to kWidth; the writer keeps it NUL-terminated within kWidth chars.
+  // nullptr when out of range or the arena is exhausted.
+  char* backSlot(size_t i) {
+    if (i >= kCapacity) return nullptr;
+    if (_back[i] == Arena::kNone) _back[i] = _arena.alloc();
+    if (_back[i] == Arena::kNone) return nullptr;
+    _arena.trim(_back[i]);
+    return _arena.line(_back[i]);
+  }
+
+  // Writable continuation of staging slot i for the characters past kWidth.
+  // nullptr when nothing is staged there, or when claiming it would leave
+  // fewer than reserve slots free (the rest of the frame needs them).
+  char* backTail(size_t i, uint8_t reserve) {
+    if (i >= kCapacity || _back[i] == Arena::kNone) return nullptr;
+    uint8_t tail = _arena.next(_back[i]);
+    if (tail == Arena::kNone) {
+      if (_arena.available() <= reserve) return nullptr;
+      tail = _arena.extend(_back[i]);
+    }
+    return _arena.line(tail);
+  }
+  const char* backLine(size_t i) const {
+    return (_back[i] != Arena::kNone) ? _arena.line(_back[i]) : "";
+  }
+
+  // Show back slots [0, n) as the new contents (oldest first). The old lines
+  // and any unused staging slots go back to the arena.
+  void swap(size_t n) {
+    if (n > kCapacity) n = kCapacity;
+    clear();
+    for (size_t i = 0; i < n; ++i) {
+      _ring[i] = _back[i];
+      _back[i] = Arena::kNone;
+    }
+    discardBack();
+    _count = static_cast<uint8_t>(n);
+    _head = static_cast<uint8_t>(wrap(n));
+  }
+
+  // Cut continuations, newest line first, until the lines and their tails
+  // take at most kCapacity slots, so the next frame still finds
+  // kStageGuarantee free. Call after a commit; returns the characters cut.
+  uint16_t fitTails() {
+    uint8_t used = 0;
+    for (size_t i = 0; i < kCapacity; ++i) {
+      if (_ring[i] == Arena::kNone) continue;
+      used = static_cast<uint8_t>(used + ((_arena.next(_ring[i]) != Arena::kNone) ? 2 : 1));
+    }
+    uint16_t cut = 0;
+    for (size_t index = _count; used > kCapacity && index-- > 0;) {
+      uint8_t slot = _ring[slotOf(index)];
+      if (slot == Arena::kNone || _arena.next(slot) == Arena::kNone) continue;
+      cut = static_cast<uint16_t>(cut + strlen(_arena.line(_arena.next(slot))));
+      _arena.trim(slot);
+      --used;
+    }
+    return cut;
+  }
+
+  // Make back slot i the line at absolute index (a delta update). The
+  // replaced line's slot takes its place in staging until discardBack().
+  void adoptBack(size_t index, size_t i) {
+    if (index >= _count || i >= kCapacity) return;
+    uint8_t& slot = _ring[slotOf(index)];
+    uint8_t old = slot;
+    slot = _back[i];
+    _back[i] = old;
+  }
+
+  // Make every staged slot the line at its own index (a delta frame). The
+  // replaced lines take their places in staging until discardBack().
+  void adoptStaged() {
+    for (uint8_t i = 0; i < _count; ++i) {
+      if (_back[i] != Arena::kNone) adoptBack(i, i);
+    }
+  }
+
+  // Return staging slot i to the arena.
+  void dropBack(size_t i) {
+    if (i >= kCapacity) return;
+    _arena.release(_back[i]);
+    _back[i] = Arena::kNone;
+  }
+
+  // Detach back slot i for another owner (the command menu); the caller
+  // releases it to the arena when done. kNone if nothing was staged there.
+  uint8_t takeBack(size_t i) {
+    if (i >= kCapacity) return Arena::kNone;
+    uint8_t slot = _back[i];
+    _back[i] = Arena::kNone;
+    return slot;
+  }
+
+  // Return every staging slot to the arena.
+  void discardBack() {
+    for (size_t i = 0; i < kCapacity; ++i) {
+      _arena.release(_back[i]);
+      _back[i] = Arena::kNone;
+    }
+  }
+
  private:
-  char _lines[kCapacity][kWidth + 1];
-  size_t _count = 0;  // number of valid lines
-  size_t _head = 0;   // next insert position
+  static constexpr bool kPow2 = (Capacity & (Capacity - 1)) == 0;
+
+  // i mod kCapacity for i < 2 * kCapacity; a mask when kCapacity is 2^n.
+  static size_t wrap(size_t i) {
+    if (kPow2) return i & (kCapacity - 1);
+    return (i >= kCapacity) ? i - kCapacity : i;
+  }
+
+  size_t slotOf(size_t index) const {
+    size_t oldest = wrap(_head + kCapacity - _count);
+    return wrap(oldest + index);
+  }
+
+  void copyLine(uint8_t slot, const char* s) {
+    // Truncate to kWidth and copy
+    _arena.trim(slot);
+    char* text = _arena.line(slot);
+    size_t i = 0;
+    for (; i < kWidth && s[i] != '\0'; ++i) {
+      text[i] = s[i];
+    }
+    text[i] = '\0';
+  }
+
+  Arena& _arena;
+  uint8_t _ring[kCapacity];  // arena slot per line, kNone when blank
+  uint8_t _back[kCapacity];  // staged slots of the frame being received
+  uint8_t _count = 0;        // number of valid lines
+  uint8_t _head = 0;         // next insert position
 };
@@ -0,0 +1,61 @@
+// Interrupt-driven UART link to the host daemon.
+//
+// Replaces HardwareSerial: nothing in the sketch references `Serial`, so the
+// core's USART_RX_vect is never linked and this module owns the vector. The RX
+// ring holds one whole maximum-size frame, so a loop() pass stalled behind a
+// long LCD redraw or an EEPROM write never costs bytes. FrameParser streams
+// lines into arena slots as they arrive; it never waits for a frame to
+// complete. Bytes that still cannot be stored are counted.
+#pragma once
+#include <Arduino.h>
+
+class SerialLink {
+ public:
+  // The largest frame the daemon sends: META, a DELTA header and a full stage
+  // of maximum-width lines, about 220 bytes on a 20x4 panel. That is ~22 ms
+  // of back-to-back bytes at 115200 baud, 2.5 ms at 1 Mbaud.
+  static constexpr uint16_t kRxCapacity = 256;
+
+  // Also changes the rate of a running link; the RX ring is emptied.
+  static void begin(unsigned long baud);
+
+  static uint16_t available();
+  static int16_t read();  // -1 when empty
+
+  // Blocking transmit; replies to the host are short and infrequent.
+  static void write(uint8_t b);
+  static void print(const char* s);
+  static void print(unsigned long value);
+  static void println(const char* s);
+  static void println(unsigned long value);
+  static void println();
+  // s is in flash (PROGMEM or PSTR()).
+  static void printP(const char* s);
+  static void printlnP(const char* s);
+  // Wait until the last byte written has left the UART.
+  static void flush();
+
+  // Bytes lost since boot: ring full, or a UART data overrun in hardware.
+  static uint16_t overruns();
+
+  // ISR entry: store one received byte; hwOverrun flags a byte the UART
+  // already dropped before this one.
+  static void onRxByte(uint8_t b, bool hwOverrun) {
+    if (hwOverrun) ++_overruns;
+    uint16_t next = _head + 1;
+    if (next == kRxCapacity) next = 0;
+    if (next == _tail) {
+      ++_overruns;
+      return;
+    }
+    _rx[_head] = b;
+    _head = next;
+  }
+
+ private:
+  static uint8_t _rx[kRxCapacity];
+  static volatile uint16_t _head;  // written by ISR
+  static volatile uint16_t _tail;  // written by main loop
+  static volatile uint16_t _overruns;
+  static bool _sent;  // flush() has a byte to wait for
+};
@@ -0,0 +1,19 @@
+// Free-SRAM low-water mark for the STATS reply.
+//
+// Before main() runs, code in .init1 fills everything from the end of .bss to
+// the top of SRAM with kPaint. The sketch never allocates from the heap, so
+// only the stack grows into that region, downwards; the painted bytes still
+// intact above .bss are memory the firmware has not needed since reset.
+// kPaint is the byte bench/simavr_bench.c paints with, so its stack
+// measurement still sees untouched memory.
+#pragma once
+#include <Arduino.h>
+
+class StackPaint {
+ public:
+  static constexpr uint8_t kPaint = 0xA5;
+
+  // Bytes between .bss and the deepest stack so far. Scans up to the current
+  // stack pointer, so call it from loop() depth. 0 on the native simulator.
+  static uint16_t unused();
+};
@@ -0,0 +1,56 @@
+// printf-free text for display lines and replies to the host.
+//
+// Writers put characters straight into a buffer the caller already owns and
+// return the new length, so building "Timeout: 30s" costs a few divisions
+// rather than a vfprintf call and the formatting code it links in. Strings
+// that never change live in flash: declare them PROGMEM (or wrap a literal
+// in PSTR()) and hand them to the *P writers, which read them a byte at a
+// time with pgm_read_byte. The native build maps both to ordinary memory.
+#pragma once
+
+#include <Arduino.h>
+
+namespace TextFormat {
+
+constexpr uint8_t kMaxDigits = 10;  // 4294967295
+
+// Decimal digits of value at out, not terminated; returns how many.
+inline uint8_t writeUnsigned(char* out, uint32_t value) {
+  char digits[kMaxDigits];  // least significant first
+  uint8_t n = 0;
+  do {
+    digits[n++] = static_cast<char>('0' + value % 10);
+    value /= 10;
+  } while (value != 0);
+  for (uint8_t i = 0; i < n; ++i) out[i] = digits[n - 1 - i];
+  return n;
+}
+
+// The append* writers extend a terminated line of len characters, never past
+// cap (line holds cap + 1), and return the new length. Whatever does not fit
+// is cut, as snprintf would.
+
+inline uint8_t appendChar(char* line, uint8_t len, uint8_t cap, char c) {
+  if (len < cap) line[len++] = c;
+  line[len] = '\0';
+  return len;
+}
+
+inline uint8_t appendUnsigned(char* line, uint8_t len, uint8_t cap, uint32_t value) {
+  char digits[kMaxDigits];
+  uint8_t n = writeUnsigned(digits, value);
+  for (uint8_t i = 0; i < n && len < cap; ++i) line[len++] = digits[i];
+  line[len] = '\0';
+  return len;
+}
+
+// s is in flash.
+inline uint8_t appendP(char* line, uint8_t len, uint8_t cap, const char* s) {
+  for (char c; len < cap && (c = static_cast<char>(pgm_read_byte(s))) != '\0'; ++s) {
+    line[len++] = c;
+  }
+  line[len] = '\0';
+  return len;
+}
+
+}  // namespace TextFormat
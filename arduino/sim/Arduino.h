@@ -0,0 +1,55 @@
+// Host stand-in for the Arduino core, used by the `native` PlatformIO env.
+//
+// Only what the sketch and its modules call is provided. Time comes from the
+// simulator's virtual clock (see Sim.h), never from the host.
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+
+#define NOT_AN_INTERRUPT -1
+// Nano (ATmega328): INT0 on D2, INT1 on D3.
+#define digitalPinToInterrupt(p) ((p) == 2 ? 0 : ((p) == 3 ? 1 : NOT_AN_INTERRUPT))
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+typedef uint8_t byte;
+
+// Flash tables are ordinary data on the host.
+#define PROGMEM
+#define pgm_read_byte(addr) (*reinterpret_cast<const uint8_t*>(addr))
+#define PSTR(s) (s)
+#define strncmp_P strncmp
+
+// unsigned long is 64-bit on the host; millis()/micros() still wrap at 32 bits
+// like on the AVR so rollover paths behave the same.
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+
+void attachInterrupt(uint8_t interruptNum, void (*handler)(), int mode);
+void detachInterrupt(uint8_t interruptNum);
+
+// The simulator is single-threaded; "ISRs" run synchronously from sim calls.
+inline void noInterrupts() {}
+inline void interrupts() {}
@@ -0,0 +1,70 @@
+#include "Hd44780.h"
+
+namespace {
+
+constexpr uint8_t LCD_CLEARDISPLAY = 0x01;
+constexpr uint8_t LCD_RETURNHOME = 0x02;
+constexpr uint8_t LCD_SETCGRAMADDR = 0x40;
+constexpr uint8_t LCD_SETDDRAMADDR = 0x80;
+
+}  // namespace
+
+Hd44780::Hd44780(uint8_t cols, uint8_t rows) : _cols(cols), _rows(rows) {
+  memset(_ddram, ' ', sizeof(_ddram));
+  memset(_cgram, 0, sizeof(_cgram));
+}
+
+uint8_t Hd44780::rowOffset(uint8_t row) const {
+  // Rows 2/3 continue rows 0/1 after `cols` characters.
+  const uint8_t offsets[4] = {0x00, 0x40, _cols, static_cast<uint8_t>(0x40 + _cols)};
+  return offsets[row & 0x03];
+}
+
+void Hd44780::nibble(uint8_t) { ++_stats.commands; }
+
+void Hd44780::command(uint8_t value) {
+  ++_stats.commands;
+  if (value & LCD_SETDDRAMADDR) {
+    _address = value & 0x7F;
+    _toCgram = false;
+  } else if (value & LCD_SETCGRAMADDR) {
+    _address = value & 0x3F;
+    _toCgram = true;
+  } else if (value == LCD_CLEARDISPLAY) {
+    memset(_ddram, ' ', sizeof(_ddram));
+    _address = 0;
+    _toCgram = false;
+  } else if (value == LCD_RETURNHOME) {
+    _address = 0;
+    _toCgram = false;
+  }
+}
+
+void Hd44780::write(uint8_t value) {
+  ++_stats.data;
+  if (_toCgram) {
+    _cgram[_address] = value & 0x1F;
+    _address = (_address + 1) & (kCgramSize - 1);
+    return;
+  }
+  _ddram[_address] = value;
+  // Two-line mode: 0x00-0x27 and 0x40-0x67, each wrapping into the other.
+  if (_address == 0x27) {
+    _address = 0x40;
+  } else if (_address == 0x67) {
+    _address = 0x00;
+  } else {
+    ++_address;
+  }
+}
+
+char Hd44780::at(uint8_t col, uint8_t row) const {
+  if (col >= _cols || row >= _rows) return '\0';
+  return static_cast<char>(_ddram[(rowOffset(row) + col) & 0x7F]);
+}
+
+void Hd44780::row(uint8_t r, char* out) const {
+  uint8_t c = 0;
+  for (; c < _cols; ++c) out[c] = at(c, r);
+  out[c] = '\0';
+}
@@ -0,0 +1,57 @@
+// Byte-level HD44780 model for the native simulator.
+//
+// LcdDriver's bus half (sim/SimCore.cpp) feeds it every nibble and byte the
+// firmware clocks out. It decodes them against a DDRAM image and counts them,
+// so tests can read the panel and measure what a render cost on the bus.
+// Custom glyphs land in a CGRAM image: at() returns the raw code (0-7, or its
+// 8-15 mirror) and glyphRow() the pixels it stands for.
+#pragma once
+#include <Arduino.h>
+
+struct LcdBusStats {
+  uint32_t commands = 0;   // instruction bytes (cursor moves, clear, setup)
+  uint32_t data = 0;       // character bytes
+  uint32_t busMicros = 0;  // time the bus was occupied, execution delays included
+
+  uint32_t ops() const { return commands + data; }
+  uint32_t nibbles() const { return ops() * 2; }  // 4-bit wiring: two strobes per byte
+};
+
+class Hd44780 {
+ public:
+  static constexpr uint8_t kDdramSize = 0x80;
+  static constexpr uint8_t kCgramSize = 0x40;  // 8 glyphs x 8 rows
+
+  // Geometry of the board's panel (20x4).
+  Hd44780(uint8_t cols = 20, uint8_t rows = 4);
+
+  // --- Bus side ---
+  void nibble(uint8_t value);  // lone init strobe; counted as an instruction
+  void command(uint8_t value);
+  void write(uint8_t value);
+  void chargeBus(uint32_t us) { _stats.busMicros += us; }
+
+  // --- Inspection ---
+  uint8_t cols() const { return _cols; }
+  uint8_t rows() const { return _rows; }
+  char at(uint8_t col, uint8_t row) const;
+  // Copy visible row text (cols chars + NUL) into out.
+  void row(uint8_t row, char* out) const;
+  // Pixel row (5 low bits) of custom glyph code 0-15.
+  uint8_t glyphRow(uint8_t code, uint8_t row) const {
+    return _cgram[((code & 7) << 3) | (row & 7)];
+  }
+  const LcdBusStats& stats() const { return _stats; }
+  void resetStats() { _stats = LcdBusStats(); }
+
+ private:
+  uint8_t rowOffset(uint8_t row) const;
+
+  uint8_t _cols;
+  uint8_t _rows;
+  uint8_t _ddram[kDdramSize];
+  uint8_t _cgram[kCgramSize];
+  uint8_t _address = 0;
+  bool _toCgram = false;  // data writes go to CGRAM until the next DDRAM address
+  LcdBusStats _stats;
+};
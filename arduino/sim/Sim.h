@@ -0,0 +1,68 @@
+// Simulator control surface for the native build.
+//
+// Drives the unmodified sketch (setup()/loop() from src/main.cpp) against a
+// virtual clock, fake pins, the HD44780 model behind LcdDriver's Timer2 tick
+// and the SerialLink RX ring.
+// Used by test/test_sim_* and by the replay runner in sim_main.cpp.
+#pragma once
+#include <Arduino.h>
+
+#include <string>
+
+#include "Hd44780.h"
+
+void setup();
+void loop();
+
+namespace sim {
+
+// Nano pin map used by the sketch.
+constexpr uint8_t kPinEncA = 2;
+constexpr uint8_t kPinEncB = 3;
+constexpr uint8_t kPinButton = 4;
+constexpr uint8_t kPinLedGreen = 5;
+constexpr uint8_t kPinLedRed = 6;
+constexpr uint8_t kPinCount = 20;
+
+// --- Virtual clock ---
+// Advancing time fires the LcdDriver Timer2 tick while its interrupt is on.
+uint64_t nowMicros();
+void advanceMicros(uint64_t us);
+
+// --- Pins ---
+// Drive an input as the outside world would; fires attached CHANGE handlers.
+void setPin(uint8_t pin, uint8_t level);
+uint8_t pin(uint8_t pin);
+
+// Rotate the encoder by whole detents (+ = clockwise), one quadrature edge at
+// a time, exactly as the A/B interrupts would see it.
+void turnEncoder(int detents);
+
+// --- Serial ---
+// Deliver bytes to the sketch through the RX ISR path all at once, as if
+// loop() stalled while they arrived: bytes past the RX ring's capacity are
+// dropped and counted, like the hardware's.
+void serialRx(const uint8_t* data, size_t len);
+void serialRx(const char* text);
+// Deliver bytes at the host's baud rate, running loop() after each one.
+void serialStream(const uint8_t* data, size_t len);
+void serialStream(const char* text);
+// Bytes the sketch transmitted since the last call.
+std::string takeTx();
+void onTx(uint8_t b);  // called by the native SerialLink::write()
+// Link rates: the sketch's follows SerialLink::begin(), the host's stays at
+// 115200 until changed. While they differ, bytes cross garbled both ways.
+void setHostBaud(unsigned long baud);
+unsigned long hostBaud();
+unsigned long deviceBaud();
+
+// --- Sketch ---
+// Run loop() until the virtual clock reaches now + ms (at least once).
+void runFor(unsigned long ms);
+// Keep running until LcdDriver has clocked out everything queued (max 1 s).
+void drainLcd();
+Hd44780& lcd();
+// Print the panel as a boxed picture, one line per row.
+void dumpLcd(FILE* out);
+
+}  // namespace sim
@@ -0,0 +1,249 @@
+// Arduino core fakes and simulator state for the native build.
+#include "Sim.h"
+
+#include "DisplayGeometry.h"
+#include "LcdDriver.h"
+#include "RotaryEncoder.h"
+#include "ScreenSnapshot.h"
+#include "SerialLink.h"
+#include "StackPaint.h"
+
+namespace {
+
+uint64_t clockMicros = 0;
+
+uint8_t pinMode_[sim::kPinCount];
+uint8_t pinLevel[sim::kPinCount];
+bool pinDriven[sim::kPinCount];  // set by the outside world via sim::setPin
+
+void (*interruptHandlers[2])() = {nullptr, nullptr};
+
+std::string txBytes;
+
+unsigned long deviceRate = 0;  // set by SerialLink::begin()
+unsigned long hostRate = 115200;
+
+// A byte sent at the wrong rate. The real UART sees framing errors and
+// noise; here every byte gets its high bit set, so no STX, newline or
+// frame survives the mismatch and the outcome is deterministic.
+uint8_t wire(uint8_t b) {
+  return (deviceRate == hostRate) ? b : static_cast<uint8_t>(b | 0x80);
+}
+
+Hd44780 panel(Panel::kCols, Panel::kRows);  // the geometry the sketch was built for
+bool timer2On = false;
+uint64_t nextTick = 0;
+
+// Survives setup() being run again, as the real one survives a reset.
+struct Eeprom {
+  uint8_t cells[ScreenSnapshot::kEepromSize];
+  Eeprom() { memset(cells, 0xFF, sizeof(cells)); }  // erased
+} eeprom;
+
+void advance(uint64_t us) {
+  uint64_t target = clockMicros + us;
+  while (timer2On && nextTick <= target) {
+    clockMicros = nextTick;
+    nextTick += LcdDriver::kTickMicros;
+    LcdDriver::onTick();
+  }
+  clockMicros = target;
+}
+
+void fireInterrupt(uint8_t pin) {
+  int num = digitalPinToInterrupt(pin);
+  if (num >= 0 && interruptHandlers[num] != nullptr) interruptHandlers[num]();
+}
+
+}  // namespace
+
+// --- Arduino core ---
+
+unsigned long micros() { return static_cast<uint32_t>(clockMicros); }
+unsigned long millis() { return static_cast<uint32_t>(clockMicros / 1000); }
+void delay(unsigned long ms) { advance(static_cast<uint64_t>(ms) * 1000); }
+void delayMicroseconds(unsigned int us) { advance(us); }
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  if (pin >= sim::kPinCount) return;
+  pinMode_[pin] = mode;
+  if (mode == INPUT_PULLUP && !pinDriven[pin]) pinLevel[pin] = HIGH;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  if (pin >= sim::kPinCount || pinMode_[pin] != OUTPUT) return;
+  pinLevel[pin] = val ? HIGH : LOW;
+}
+
+int digitalRead(uint8_t pin) { return (pin < sim::kPinCount) ? pinLevel[pin] : LOW; }
+
+void attachInterrupt(uint8_t interruptNum, void (*handler)(), int) {
+  if (interruptNum < 2) interruptHandlers[interruptNum] = handler;
+}
+
+void detachInterrupt(uint8_t interruptNum) {
+  if (interruptNum < 2) interruptHandlers[interruptNum] = nullptr;
+}
+
+// --- RotaryEncoder PIND read ---
+
+uint8_t RotaryEncoder::readPins() {
+  return static_cast<uint8_t>((pinLevel[kPinA] << 1) | pinLevel[kPinB]);
+}
+
+// --- SerialLink hardware half (the ring itself is shared with the AVR build) ---
+
+void SerialLink::begin(unsigned long baud) {
+  _head = 0;
+  _tail = 0;
+  deviceRate = baud;
+}
+
+void SerialLink::write(uint8_t b) { sim::onTx(b); }
+
+void SerialLink::flush() {}  // bytes reach the host as they are written
+
+// --- StackPaint: the host stack is not the sketch's to measure ---
+
+uint16_t StackPaint::unused() { return 0; }
+
+// --- ScreenSnapshot EEPROM: writes land at once ---
+
+bool ScreenSnapshot::ready() { return true; }
+
+uint8_t ScreenSnapshot::readByte(uint16_t addr) { return eeprom.cells[addr % kEepromSize]; }
+
+void ScreenSnapshot::updateByte(uint16_t addr, uint8_t value) {
+  eeprom.cells[addr % kEepromSize] = value;
+}
+
+// --- LcdDriver hardware half: Timer2 compare tick and the 4-bit bus ---
+
+void LcdDriver::timerStart() {}
+
+void LcdDriver::timerEnable(bool on) {
+  if (on && !timer2On) {
+    // The counter free-runs; the next compare is on the tick grid.
+    nextTick = (clockMicros / kTickMicros + 1) * kTickMicros;
+  }
+  timer2On = on;
+}
+
+void LcdDriver::busNibble(uint8_t nibble) { panel.nibble(nibble); }
+
+void LcdDriver::busWrite(uint8_t value, bool data) {
+  if (data) {
+    panel.write(value);
+  } else {
+    panel.command(value);
+  }
+  // Bus occupancy: one tick per op, plus the hold-off after clear/home.
+  panel.chargeBus(kTickMicros);
+  if (!data && value <= 0x03) {
+    panel.chargeBus(static_cast<uint32_t>(kSlowTicks) * kTickMicros);
+  }
+}
+
+// --- Simulator API ---
+
+namespace sim {
+
+uint64_t nowMicros() { return clockMicros; }
+void advanceMicros(uint64_t us) { advance(us); }
+
+void setPin(uint8_t p, uint8_t level) {
+  if (p >= kPinCount) return;
+  pinDriven[p] = true;
+  uint8_t prev = pinLevel[p];
+  pinLevel[p] = level ? HIGH : LOW;
+  if (prev != pinLevel[p]) fireInterrupt(p);
+}
+
+uint8_t pin(uint8_t p) { return (p < kPinCount) ? pinLevel[p] : LOW; }
+
+void turnEncoder(int detents) {
+  // (A,B) per quarter step, clockwise from the detent rest state 11.
+  static const uint8_t kCw[4][2] = {{0, 1}, {0, 0}, {1, 0}, {1, 1}};
+  int steps = detents < 0 ? -detents : detents;
+  for (int d = 0; d < steps; ++d) {
+    for (int q = 0; q < 4; ++q) {
+      // Counter-clockwise walks the same cycle backwards: 10, 00, 01, 11.
+      const uint8_t* ab = (detents > 0) ? kCw[q] : kCw[(2 - q + 4) % 4];
+      if (pin(kPinEncA) != ab[0]) setPin(kPinEncA, ab[0]);
+      if (pin(kPinEncB) != ab[1]) setPin(kPinEncB, ab[1]);
+    }
+  }
+}
+
+void serialRx(const uint8_t* data, size_t len) {
+  // A burst with loop() stalled: whatever the ring cannot hold is lost.
+  for (size_t i = 0; i < len; ++i) SerialLink::onRxByte(wire(data[i]), false);
+}
+
+void serialRx(const char* text) {
+  serialRx(reinterpret_cast<const uint8_t*>(text), strlen(text));
+}
+
+void serialStream(const uint8_t* data, size_t len) {
+  // 10 bits per byte (start, 8 data, stop) at the host's rate.
+  const uint64_t byteMicros = 10000000ULL / hostRate;
+  for (size_t i = 0; i < len; ++i) {
+    advance(byteMicros);
+    SerialLink::onRxByte(wire(data[i]), false);
+    loop();
+  }
+}
+
+void serialStream(const char* text) {
+  serialStream(reinterpret_cast<const uint8_t*>(text), strlen(text));
+}
+
+void onTx(uint8_t b) { txBytes.push_back(static_cast<char>(wire(b))); }
+
+void setHostBaud(unsigned long baud) { hostRate = baud; }
+unsigned long hostBaud() { return hostRate; }
+unsigned long deviceBaud() { return deviceRate; }
+
+std::string takeTx() {
+  std::string out;
+  out.swap(txBytes);
+  return out;
+}
+
+void runFor(unsigned long ms) {
+  uint64_t until = clockMicros + static_cast<uint64_t>(ms) * 1000;
+  do {
+    uint64_t before = clockMicros;
+    loop();
+    // A loop() that never waits would spin forever on a frozen clock.
+    if (clockMicros == before) advance(1000);
+  } while (clockMicros < until);
+}
+
+void drainLcd() {
+  int ms = 0;
+  do {
+    runFor(1);
+  } while (!LcdDriver::idle() && ++ms < 1000);
+}
+
+Hd44780& lcd() { return panel; }
+
+void dumpLcd(FILE* out) {
+  char text[Hd44780::kDdramSize + 1];
+  fputc('+', out);
+  for (uint8_t c = 0; c < panel.cols(); ++c) fputc('-', out);
+  fputs("+\n", out);
+  for (uint8_t r = 0; r < panel.rows(); ++r) {
+    panel.row(r, text);
+    for (char* c = text; *c != '\0'; ++c) {
+      if (static_cast<uint8_t>(*c) < 0x10) *c = '*';  // custom glyph
+    }
+    fprintf(out, "|%s|\n", text);
+  }
+  fputc('+', out);
+  for (uint8_t c = 0; c < panel.cols(); ++c) fputc('-', out);
+  fputs("+\n", out);
+}
+
+}  // namespace sim
@@ -0,0 +1,289 @@
+// Replay runner for the native build: boots the sketch, feeds it a script of
+// serial bytes and input events, and reports what the device sent back, what
+// the LCD shows, and what each step cost on the LCD bus.
+//
+// Usage: program [replay-file]   (stdin when omitted or "-")
+//        program --pty           (serve the sketch on a pseudo-terminal)
+//
+// Script directives, one per line ('#' starts a comment):
+//   frame ... end      send the enclosed lines, each + '\n', then a blank line
+//   rx <text>          send text; escapes \n \r \t \\ \xNN
+//   rxhex <hh hh ...>  send raw bytes
+//   wait <ms>          run loop() for ms of virtual time
+//   enc <detents> [us] turn the encoder (+ clockwise); edge spacing is only
+//                      honoured by the simavr bench
+//   button down|up     drive the push button
+//   press <ms>         hold the button for ms, then release
+//   lcd                print the panel
+//
+// After each directive the runner lets the LCD queue drain, then prints device
+// replies ("< line") and the LCD bus operations it caused
+// ("lcd: cmds=… data=… bus_us=…").
+//
+// With --pty the sketch runs in real time behind a pseudo-terminal whose path
+// is printed as "pty <path>"; point the daemon (or a serial terminal) at it.
+// The rate the client sets on the port is the host rate of the simulated
+// link, so a baud switch only works when both ends agree on it.
+#ifndef PIO_UNIT_TESTING
+
+#include <ctype.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "Sim.h"
+
+namespace {
+
+constexpr unsigned long kStepMs = 0;  // run loop() once after each event
+
+void report() {
+  std::string tx = sim::takeTx();
+  size_t start = 0;
+  while (start < tx.size()) {
+    size_t end = tx.find('\n', start);
+    if (end == std::string::npos) end = tx.size();
+    std::string line = tx.substr(start, end - start);
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    printf("  < %s\n", line.c_str());
+    start = end + 1;
+  }
+  Hd44780& lcd = sim::lcd();
+  const LcdBusStats& s = lcd.stats();
+  if (s.ops() != 0) {
+    printf("  lcd: cmds=%u data=%u bus_us=%u\n", static_cast<unsigned>(s.commands),
+           static_cast<unsigned>(s.data), static_cast<unsigned>(s.busMicros));
+  }
+  lcd.resetStats();
+}
+
+int hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  c = static_cast<char>(tolower(c));
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+std::string unescape(const std::string& in) {
+  std::string out;
+  for (size_t i = 0; i < in.size(); ++i) {
+    if (in[i] != '\\' || i + 1 >= in.size()) {
+      out.push_back(in[i]);
+      continue;
+    }
+    char e = in[++i];
+    if (e == 'n') {
+      out.push_back('\n');
+    } else if (e == 'r') {
+      out.push_back('\r');
+    } else if (e == 't') {
+      out.push_back('\t');
+    } else if (e == 'x' && i + 2 < in.size() && hexValue(in[i + 1]) >= 0 &&
+               hexValue(in[i + 2]) >= 0) {
+      out.push_back(static_cast<char>(hexValue(in[i + 1]) * 16 + hexValue(in[i + 2])));
+      i += 2;
+    } else {
+      out.push_back(e);
+    }
+  }
+  return out;
+}
+
+std::string parseHex(const std::string& in) {
+  std::string out;
+  int hi = -1;
+  for (char c : in) {
+    int v = hexValue(c);
+    if (v < 0) continue;
+    if (hi < 0) {
+      hi = v;
+    } else {
+      out.push_back(static_cast<char>(hi * 16 + v));
+      hi = -1;
+    }
+  }
+  return out;
+}
+
+bool readLine(FILE* in, std::string& line) {
+  line.clear();
+  int c;
+  while ((c = fgetc(in)) != EOF) {
+    if (c == '\n') return true;
+    line.push_back(static_cast<char>(c));
+  }
+  return !line.empty();
+}
+
+void sendBytes(const std::string& bytes) {
+  sim::serialStream(reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size());
+}
+
+// Rate the client configured on the terminal; 0 when it has no Bxxx constant
+// here (so it never matches the sketch's).
+unsigned long terminalRate(int fd) {
+  termios t;
+  if (tcgetattr(fd, &t) != 0) return 0;
+  switch (cfgetospeed(&t)) {
+    case B9600:
+      return 9600;
+    case B57600:
+      return 57600;
+    case B115200:
+      return 115200;
+    case B230400:
+      return 230400;
+#ifdef B500000
+    case B500000:
+      return 500000;
+#endif
+#ifdef B1000000
+    case B1000000:
+      return 1000000;
+#endif
+    default:
+      return 0;
+  }
+}
+
+uint64_t wallMicros() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000u + static_cast<uint64_t>(ts.tv_nsec) / 1000u;
+}
+
+int runPty() {
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+    perror("posix_openpt");
+    return 2;
+  }
+  const char* path = ptsname(master);
+  // Holding the slave open keeps the master readable between clients, and its
+  // termios is where a client's rate shows up.
+  int slave = (path != nullptr) ? open(path, O_RDWR | O_NOCTTY) : -1;
+  if (slave < 0) {
+    perror("open pty");
+    return 2;
+  }
+  termios t;
+  tcgetattr(slave, &t);
+  cfmakeraw(&t);
+  cfsetspeed(&t, B115200);
+  tcsetattr(slave, TCSANOW, &t);
+  printf("pty %s\n", path);
+  fflush(stdout);
+
+  setup();
+  const uint64_t start = wallMicros() - sim::nowMicros();
+  uint8_t buf[256];
+  for (;;) {
+    pollfd p = {master, POLLIN, 0};
+    int ready = poll(&p, 1, 1);
+    // After poll(): a client that switches rate and then writes has
+    // switched by the time its bytes are readable.
+    sim::setHostBaud(terminalRate(slave));
+    if (ready > 0 && (p.revents & POLLIN) != 0) {
+      ssize_t n = read(master, buf, sizeof(buf));
+      if (n < 0) {
+        perror("read pty");
+        return 1;
+      }
+      sim::serialStream(buf, static_cast<size_t>(n));
+    }
+    // The virtual clock follows the wall clock.
+    uint64_t now = wallMicros() - start;
+    unsigned long lag = (now > sim::nowMicros()) ? (now - sim::nowMicros()) / 1000 : 0;
+    sim::runFor(lag);
+    std::string tx = sim::takeTx();
+    size_t off = 0;
+    while (off < tx.size()) {
+      ssize_t n = write(master, tx.data() + off, tx.size() - off);
+      if (n < 0) {
+        perror("write pty");
+        return 1;
+      }
+      off += static_cast<size_t>(n);
+    }
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc > 1 && strcmp(argv[1], "--pty") == 0) return runPty();
+  FILE* in = stdin;
+  if (argc > 1 && strcmp(argv[1], "-") != 0) {
+    in = fopen(argv[1], "r");
+    if (in == nullptr) {
+      fprintf(stderr, "cannot open %s\n", argv[1]);
+      return 2;
+    }
+  }
+
+  printf("@%lu boot\n", millis());
+  setup();
+  sim::drainLcd();
+  report();
+
+  std::string line;
+  unsigned lineNo = 0;
+  while (readLine(in, line)) {
+    ++lineNo;
+    size_t first = line.find_first_not_of(" \t");
+    if (first == std::string::npos || line[first] == '#') continue;
+    line = line.substr(first);
+    std::string arg;
+    size_t space = line.find(' ');
+    std::string op = line.substr(0, space);
+    if (space != std::string::npos) arg = line.substr(space + 1);
+
+    printf("@%lu %s\n", millis(), line.c_str());
+    if (op == "frame") {
+      std::string bytes;
+      std::string body;
+      while (readLine(in, body) && body != "end") {
+        ++lineNo;
+        bytes += body;
+        bytes.push_back('\n');
+      }
+      ++lineNo;
+      bytes.push_back('\n');
+      sendBytes(bytes);
+      sim::runFor(kStepMs);
+    } else if (op == "rx") {
+      sendBytes(unescape(arg));
+      sim::runFor(kStepMs);
+    } else if (op == "rxhex") {
+      sendBytes(parseHex(arg));
+      sim::runFor(kStepMs);
+    } else if (op == "wait") {
+      sim::runFor(strtoul(arg.c_str(), nullptr, 10));
+    } else if (op == "enc") {
+      sim::turnEncoder(atoi(arg.c_str()));
+      sim::runFor(kStepMs);
+    } else if (op == "button") {
+      sim::setPin(sim::kPinButton, arg == "down" ? LOW : HIGH);
+      sim::runFor(kStepMs);
+    } else if (op == "press") {
+      sim::setPin(sim::kPinButton, LOW);
+      sim::runFor(strtoul(arg.c_str(), nullptr, 10));
+      sim::setPin(sim::kPinButton, HIGH);
+      sim::runFor(kStepMs);
+    } else if (op == "lcd") {
+      sim::dumpLcd(stdout);
+    } else {
+      fprintf(stderr, "line %u: unknown directive '%s'\n", lineNo, op.c_str());
+      return 2;
+    }
+    sim::drainLcd();
+    report();
+  }
+  return 0;
+}
+
+#endif  // PIO_UNIT_TESTING
@@ -0,0 +1,137 @@
+#include "LcdDriver.h"
+
+#include "Bench.h"
+
+#ifdef __AVR__
+#include <avr/interrupt.h>
+#endif
+
+namespace {
+
+constexpr uint8_t LCD_CLEARDISPLAY = 0x01;
+constexpr uint8_t LCD_ENTRYMODESET = 0x04;
+constexpr uint8_t LCD_DISPLAYCONTROL = 0x08;
+constexpr uint8_t LCD_FUNCTIONSET = 0x20;
+constexpr uint8_t LCD_SETCGRAMADDR = 0x40;
+constexpr uint8_t LCD_SETDDRAMADDR = 0x80;
+
+}  // namespace
+
+uint8_t LcdDriver::_value[LcdDriver::kRingSize];
+uint8_t LcdDriver::_data[LcdDriver::kRingSize / 8];
+volatile uint8_t LcdDriver::_head = 0;
+volatile uint8_t LcdDriver::_tail = 0;
+volatile uint8_t LcdDriver::_wait = 0;
+uint8_t LcdDriver::_rowOffset[4] = {0x00, 0x40, 0x14, 0x54};
+
+void LcdDriver::begin(uint8_t cols, uint8_t rows) {
+  _rowOffset[2] = cols;
+  _rowOffset[3] = static_cast<uint8_t>(0x40 + cols);
+
+  for (uint8_t pin = 7; pin <= 12; ++pin) {
+    pinMode(pin, OUTPUT);
+    digitalWrite(pin, LOW);
+  }
+  // Datasheet 4-bit init: three 8-bit function sets, then switch to 4-bit.
+  delay(50);
+  busNibble(0x03);
+  delayMicroseconds(4500);
+  busNibble(0x03);
+  delayMicroseconds(4500);
+  busNibble(0x03);
+  delayMicroseconds(150);
+  busNibble(0x02);
+  delayMicroseconds(100);
+
+  busWrite(LCD_FUNCTIONSET | (rows > 1 ? 0x08 : 0x00), false);  // 4-bit, 5x8
+  delayMicroseconds(kTickMicros);
+  busWrite(LCD_DISPLAYCONTROL | 0x04, false);  // display on, no cursor
+  delayMicroseconds(kTickMicros);
+  busWrite(LCD_CLEARDISPLAY, false);
+  delayMicroseconds(2000);
+  busWrite(LCD_ENTRYMODESET | 0x02, false);  // increment, no shift
+  delayMicroseconds(kTickMicros);
+
+  _head = 0;
+  _tail = 0;
+  _wait = 0;
+  timerStart();
+}
+
+void LcdDriver::clear() { enqueue(LCD_CLEARDISPLAY, false); }
+
+void LcdDriver::setCursor(uint8_t col, uint8_t row) {
+  enqueue(static_cast<uint8_t>(LCD_SETDDRAMADDR | (col + _rowOffset[row & 0x03])), false);
+}
+
+void LcdDriver::setCgramAddress(uint8_t addr) {
+  enqueue(static_cast<uint8_t>(LCD_SETCGRAMADDR | (addr & 0x3F)), false);
+}
+
+void LcdDriver::write(uint8_t value) { enqueue(value, true); }
+
+void LcdDriver::enqueue(uint8_t value, bool data) {
+  uint8_t head = _head;
+  uint8_t next = (head + 1) & (kRingSize - 1);
+  while (next == _tail) {
+    // Caller ignored room(); wait for the ISR rather than drop an op.
+  }
+  _value[head] = value;
+  if (data) {
+    _data[head >> 3] |= bit8(head);
+  } else {
+    _data[head >> 3] &= static_cast<uint8_t>(~bit8(head));
+  }
+  _head = next;
+  timerEnable(true);
+}
+
+#ifdef __AVR__
+// On the native simulator the bus and timer halves live in sim/SimCore.cpp.
+
+ISR(TIMER2_COMPA_vect) {
+  BENCH_SCOPE(BENCH_LCD_TICK_ISR);
+  LcdDriver::onTick();
+}
+
+void LcdDriver::timerStart() {
+  // CTC, clk/32: 2 us per count, compare every 25 counts = kTickMicros.
+  static_assert(kTickMicros == 50, "OCR2A assumes a 50 us tick");
+  TCCR2A = _BV(WGM21);
+  TCCR2B = _BV(CS21) | _BV(CS20);
+  OCR2A = 24;
+  TCNT2 = 0;
+}
+
+void LcdDriver::timerEnable(bool on) {
+  if (on) {
+    TIMSK2 |= _BV(OCIE2A);
+  } else {
+    TIMSK2 &= static_cast<uint8_t>(~_BV(OCIE2A));
+  }
+}
+
+static inline void strobe(uint8_t nibble) {
+  // D4..D7 on PB1..PB4, E on PB0
+  PORTB = static_cast<uint8_t>((PORTB & 0xE0) | ((nibble & 0x0F) << 1));
+  PORTB |= _BV(PB0);
+  __builtin_avr_delay_cycles(8);  // E high >= 450 ns
+  PORTB &= static_cast<uint8_t>(~_BV(PB0));
+  __builtin_avr_delay_cycles(8);  // enable cycle >= 1 us
+}
+
+void LcdDriver::busNibble(uint8_t nibble) {
+  PORTD &= static_cast<uint8_t>(~_BV(PD7));
+  strobe(nibble);
+}
+
+void LcdDriver::busWrite(uint8_t value, bool data) {
+  if (data) {
+    PORTD |= _BV(PD7);
+  } else {
+    PORTD &= static_cast<uint8_t>(~_BV(PD7));
+  }
+  strobe(value >> 4);
+  strobe(value);
+}
+#endif  // __AVR__
@@ -1,7 +1,14 @@
 #include "RotaryEncoder.h"
 
-uint8_t RotaryEncoder::_pinA = 0;
-uint8_t RotaryEncoder::_pinB = 0;
+const int8_t RotaryEncoder::kTransitions[16] PROGMEM = {
+    0, -1, 1, 0,   // from 00
+    1, 0, 0, -1,   // from 01
+    -1, 0, 0, 1,   // from 10
+    0, 1, -1, 0,   // from 11
+};
+
 uint8_t RotaryEncoder::_lastEncoded = 0;
 volatile int16_t RotaryEncoder::_position = 0;
-volatile bool RotaryEncoder::_changed = false;
\ No newline at end of file
+volatile bool RotaryEncoder::_changed = false;
+unsigned long RotaryEncoder::_lastDetentMs = 0;
+int16_t RotaryEncoder::_lastSteps = 0;
@@ -0,0 +1,16 @@
+#include "ScreenSnapshot.h"
+
+#ifdef __AVR__
+// On the native simulator build the EEPROM is an array in sim/SimCore.cpp.
+#include <avr/eeprom.h>
+
+bool ScreenSnapshot::ready() { return eeprom_is_ready(); }
+
+uint8_t ScreenSnapshot::readByte(uint16_t addr) {
+  return eeprom_read_byte(reinterpret_cast<const uint8_t*>(addr));
+}
+
+void ScreenSnapshot::updateByte(uint16_t addr, uint8_t value) {
+  eeprom_update_byte(reinterpret_cast<uint8_t*>(addr), value);
+}
+#endif  // __AVR__
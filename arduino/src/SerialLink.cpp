@@ -0,0 +1,121 @@
+#include "SerialLink.h"
+
+#include "Bench.h"
+#include "TextFormat.h"
+
+#ifdef __AVR__
+#include <avr/interrupt.h>
+#endif
+
+uint8_t SerialLink::_rx[SerialLink::kRxCapacity];
+volatile uint16_t SerialLink::_head = 0;
+volatile uint16_t SerialLink::_tail = 0;
+volatile uint16_t SerialLink::_overruns = 0;
+bool SerialLink::_sent = false;
+
+#ifdef __AVR__
+// On the native simulator build begin(), write() and flush() live in
+// sim/SimCore.cpp and received bytes are injected through onRxByte().
+ISR(USART_RX_vect) {
+  BENCH_SCOPE(BENCH_UART_RX_ISR);
+  // UCSR0A must be read before UDR0; reading UDR0 clears the error flags.
+  bool hwOverrun = (UCSR0A & _BV(DOR0)) != 0;
+  uint8_t b = UDR0;
+  SerialLink::onRxByte(b, hwOverrun);
+}
+
+void SerialLink::begin(unsigned long baud) {
+  // Double-speed mode, same divisor rounding as HardwareSerial.
+  uint16_t ubrr = static_cast<uint16_t>((F_CPU / 4 / baud - 1) / 2);
+  noInterrupts();
+  _head = 0;
+  _tail = 0;
+  UCSR0A = _BV(U2X0);
+  UBRR0H = static_cast<uint8_t>(ubrr >> 8);
+  UBRR0L = static_cast<uint8_t>(ubrr);
+  UCSR0C = _BV(UCSZ01) | _BV(UCSZ00);  // 8N1
+  UCSR0B = _BV(RXEN0) | _BV(TXEN0) | _BV(RXCIE0);
+  interrupts();
+}
+#endif  // __AVR__
+
+uint16_t SerialLink::available() {
+  noInterrupts();
+  uint16_t head = _head;
+  interrupts();
+  uint16_t tail = _tail;
+  return (head >= tail) ? (head - tail) : (kRxCapacity - tail + head);
+}
+
+int16_t SerialLink::read() {
+  noInterrupts();
+  uint16_t head = _head;
+  interrupts();
+  uint16_t tail = _tail;
+  if (head == tail) return -1;
+  uint8_t b = _rx[tail];
+  ++tail;
+  if (tail == kRxCapacity) tail = 0;
+  noInterrupts();
+  _tail = tail;
+  interrupts();
+  return b;
+}
+
+uint16_t SerialLink::overruns() {
+  noInterrupts();
+  uint16_t n = _overruns;
+  interrupts();
+  return n;
+}
+
+#ifdef __AVR__
+void SerialLink::write(uint8_t b) {
+  while ((UCSR0A & _BV(UDRE0)) == 0) {
+  }
+  UDR0 = b;
+  // Clear TXC0 (write one) behind the byte, keeping U2X0, for flush().
+  UCSR0A = static_cast<uint8_t>((UCSR0A & _BV(U2X0)) | _BV(TXC0));
+  _sent = true;
+}
+
+void SerialLink::flush() {
+  if (!_sent) return;  // TXC0 is only ever set by a transmission
+  while ((UCSR0A & _BV(TXC0)) == 0) {
+  }
+}
+#endif
+
+void SerialLink::print(const char* s) {
+  while (*s != '\0') write(static_cast<uint8_t>(*s++));
+}
+
+void SerialLink::print(unsigned long value) {
+  char digits[TextFormat::kMaxDigits];
+  uint8_t n = TextFormat::writeUnsigned(digits, static_cast<uint32_t>(value));
+  for (uint8_t i = 0; i < n; ++i) write(static_cast<uint8_t>(digits[i]));
+}
+
+void SerialLink::printP(const char* s) {
+  for (uint8_t c; (c = pgm_read_byte(s)) != '\0'; ++s) write(c);
+}
+
+void SerialLink::println() {
+  write('\r');
+  write('\n');
+}
+
+void SerialLink::println(const char* s) {
+  print(s);
+  println();
+}
+
+void SerialLink::println(unsigned long value) {
+  print(value);
+  println();
+}
+
+void SerialLink::printlnP(const char* s) {
+  printP(s);
+  println();
+}
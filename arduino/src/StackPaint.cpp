@@ -0,0 +1,33 @@
+#include "StackPaint.h"
+
+#ifdef __AVR__
+// On the native simulator build unused() lives in sim/SimCore.cpp.
+
+extern uint8_t _end;     // first byte after .bss (avr-libc linker script)
+extern uint8_t __stack;  // last byte of SRAM
+
+// .init1 runs before the stack pointer and __zero_reg__ are set up, so this
+// is plain register code: store kPaint from _end through __stack.
+extern "C" void stackPaint() __attribute__((naked, used, section(".init1")));
+extern "C" void stackPaint() {
+  __asm volatile(
+      "    ldi r30, lo8(_end)\n"
+      "    ldi r31, hi8(_end)\n"
+      "    ldi r24, %0\n"
+      "    ldi r25, hi8(__stack)\n"
+      "    rjmp 2f\n"
+      "1:  st Z+, r24\n"
+      "2:  cpi r30, lo8(__stack)\n"
+      "    cpc r31, r25\n"
+      "    brlo 1b\n"
+      "    breq 1b\n" ::"M"(StackPaint::kPaint));
+}
+
+uint16_t StackPaint::unused() {
+  const uint8_t* p = &_end;
+  const uint8_t* sp = reinterpret_cast<const uint8_t*>(SP);
+  uint16_t n = 0;
+  while (p + n < sp && p[n] == kPaint) ++n;
+  return n;
+}
+#endif
@@ -1,34 +1,83 @@
 #include <Arduino.h>
-#include <LiquidCrystal.h>
 #include <stdlib.h>
 #include <string.h>
-#include <stdio.h>
-#include "ScrollBuffer.h"
+#include "DisplayGeometry.h"
 #include "RotaryEncoder.h"
+#include "LcdFramebuffer.h"
+#include "LcdDriver.h"
+#include "LcdGlyphs.h"
+#include "MetricHistory.h"
+#include "SerialLink.h"
+#include "FrameParser.h"
+#include "Bench.h"
+#include "Scheduler.h"
+#include "MemoryBudget.h"
+#include "ScreenSnapshot.h"
+#include "StackPaint.h"
+#include "TextFormat.h"
+#ifdef __AVR__
+#include <avr/interrupt.h>
+#endif
 
-// LCD pins: RS=7, E=8, D4=9, D5=10, D6=11, D7=12
-LiquidCrystal lcd(7, 8, 9, 10, 11, 12);
+// LCD pins: RS=7, E=8, D4=9, D5=10, D6=11, D7=12 (fixed in LcdDriver)
+static LcdDriver lcd;
 
-// LCD geometry & string sizing
-constexpr uint8_t LCD_COLS = ScrollBuffer::kWidth;
-constexpr uint8_t LCD_ROWS = 4;
+// LCD geometry & string sizing (the panel is picked at build time, see
+// DisplayGeometry.h)
+constexpr uint8_t LCD_COLS = Panel::kCols;
+constexpr uint8_t LCD_ROWS = Panel::kRows;
 constexpr uint8_t LCD_BUFFER_LEN = LCD_COLS + 1;
+static_assert(LcdFramebuffer::kCols == LCD_COLS, "framebuffer width must match LCD");
+static_assert(LcdFramebuffer::kRows == LCD_ROWS, "framebuffer height must match LCD");
+
+// Shadow of the panel contents. render() only marks the screen dirty; the
+// loop composes once per pass and feeds the diff to LcdDriver's ring as space
+// frees up, so bursts of input and frames coalesce into one paced update.
+static LcdFramebuffer frame;
+static FlushStats lastFlush;  // bus cost of the most recent complete flush
+static FlushStats flushProgress;
+static bool renderRequested = false;
+static bool flushPending = false;  // composed cells not yet queued
+static LcdGlyphs glyphs;           // custom character set in CGRAM
 
 constexpr uint8_t CMD_ID_STORAGE = 8;                  // 7 visible chars + null
 constexpr uint8_t CMD_LABEL_VISIBLE = LCD_COLS - 1;    // reserve column 0 for cursor
-constexpr uint8_t CMD_LABEL_STORAGE = CMD_LABEL_VISIBLE + 1;
 
-constexpr char COMMANDS_HEADER[] = "COMMANDS v1";
-constexpr size_t COMMANDS_HEADER_LEN = sizeof(COMMANDS_HEADER) - 1;
-constexpr char META_PREFIX[] = "META ";
-constexpr size_t META_PREFIX_LEN = sizeof(META_PREFIX) - 1;
-constexpr char META_INTERVAL_KEY[] = "interval=";
-constexpr size_t META_INTERVAL_KEY_LEN = sizeof(META_INTERVAL_KEY) - 1;
+// Features announced to the daemon at boot and when META carries hello=,
+// followed by lines=<telemetry capacity> stage=<lines one frame can always
+// carry> cols=<line width> fields=<numeric fields per layout> credits=<frames
+// in flight> baud=<fastest link rate> wide=<longest telemetry line, kept as
+// a marquee>; the daemon splits bigger updates into several frames and cuts
+// telemetry to wide= and other lines to the panel width. `num` is the
+// layout/values channel (NumericLayout.h); `stats` answers REQ STATS (see
+// reportStats()); `menuhash` takes the menu digest in page frames (see
+// keepTopPage()).
+constexpr char CAPS_LINE[] PROGMEM = "CAPS delta bin num stats menuhash";
+
+// Flow control: the daemon keeps at most FRAME_CREDITS telemetry frames in
+// flight and gets one credit back per "ACK <n>" frame. A frame is acked once
+// it is committed and the display has caught up with it, so a slow panel
+// throttles the sender instead of overrunning the RX ring.
+constexpr uint8_t FRAME_CREDITS = 2;
+
+// Link rate: the sketch boots at SERIAL_BAUD_DEFAULT. A 'B' frame moves it to
+// any rate up to SERIAL_BAUD_MAX that the U2X divisor hits exactly (250000,
+// 500000 and 1000000 at 16 MHz) or back to the default; the device answers
+// "BAUD <rate>" at the old rate, then switches. A new rate is on probation
+// until a frame arrives intact at it, and the link falls back to the default
+// when the probation runs out, after BAUD_MAX_BAD rejected frames in a row or
+// when the frame watchdog fires.
+constexpr unsigned long SERIAL_BAUD_DEFAULT = 115200;
+constexpr unsigned long SERIAL_BAUD_MAX = 1000000;
+constexpr unsigned long BAUD_PROBATION_MS = 1000;
+constexpr uint8_t BAUD_MAX_BAD = 3;
 
 // Rotary encoder pins
 constexpr uint8_t PIN_ENC_A = 2;   // D2
 constexpr uint8_t PIN_ENC_B = 3;   // D3
 constexpr uint8_t PIN_BTN = 4;     // D4
+static_assert(PIN_ENC_A == RotaryEncoder::kPinA && PIN_ENC_B == RotaryEncoder::kPinB,
+              "RotaryEncoder reads A/B straight from PIND");
 
 // Heartbeat LEDs
 constexpr uint8_t PIN_LED_GREEN = 5;  // D5: healthy heartbeat
@@ -45,25 +94,109 @@ static const unsigned long FRAME_LOSS_MULTIPLIER = 10;
 constexpr unsigned long WAITING_ANIM_INTERVAL_MS = 250;
 constexpr uint8_t WAITING_ANIM_FRAMES = 4;
 
+// Marquee: a telemetry line longer than the panel (up to
+// Panel::Buffer::kLongWidth, announced as wide= in CAPS) scrolls through its
+// row on the device, so the daemon sends it once. Every MARQUEE_STEP_MS the
+// visible long rows move one column; each pass rests on the start of the
+// line for MARQUEE_HOLD steps and runs MARQUEE_GAP blanks before the text
+// comes round again. A step recomposes only those rows.
+constexpr unsigned long MARQUEE_STEP_MS = 350;
+constexpr uint8_t MARQUEE_HOLD = 4;
+constexpr uint8_t MARQUEE_GAP = 3;
+static_assert(LCD_ROWS <= 8, "marquee rows are one bit each");
+
+// Screen snapshot: the visible telemetry rows and the interval are saved to
+// EEPROM (ScreenSnapshot.h) once a frame has changed them, at most once per
+// SNAPSHOT_PERIOD_MS. At boot the newest snapshot is shown, the waiting
+// spinner in its top-right cell marking it stale, until the daemon's first
+// full frame replaces it. With 11 records on the 20x4 panel each EEPROM cell
+// sees its 100k rated writes after about 20 years of saves.
+constexpr unsigned long SNAPSHOT_PERIOD_MS = 600000UL;
+
+// Screen text, kept in flash and drawn with frame.printP() / TextFormat. Reply
+// words sent only once are written inline with PSTR().
+static const char TEXT_WAITING[] PROGMEM = "Waiting for data...";
+static const char TEXT_WAITING_ANIM[] PROGMEM = "Waiting for data ";
+static const char WAITING_ANIM[WAITING_ANIM_FRAMES + 1] PROGMEM = "|/-\\";
+static const char TEXT_TIMEOUT[] PROGMEM = "Timeout: ";
+static const char TEXT_TIMEOUT_OFF[] PROGMEM = "Timeout: --";
+static const char TEXT_NO_HISTORY[] PROGMEM = "No history yet";
+static const char TEXT_LOADING[] PROGMEM = "> Loading commands...";
+static const char TEXT_EXIT[] PROGMEM = "Exit";
+static const char TEXT_BACK[] PROGMEM = "Back";
+static const char TEXT_PAGE_PENDING[] PROGMEM = "...";
+static const char REQ_FULL[] PROGMEM = "REQ FULL";
+
 // --- Telemetry buffer/state ---
-ScrollBuffer buffer;
+// One slot pool for telemetry lines, the frame being received and the
+// command menu (see LineArena.h).
+static Panel::Arena arena;
+Panel::Buffer buffer(arena);
 int16_t scroll = 0;
 
+// The placeholder line shown until the first frame arrives.
+static void pushWaiting() {
+  char line[LCD_BUFFER_LEN];
+  TextFormat::appendP(line, 0, LCD_COLS, TEXT_WAITING);
+  buffer.push(line);
+}
+
 // --- Modes ---
-enum class UIMode : uint8_t { Telemetry = 0, CommandsWaiting = 1, Commands = 2 };
+// History graphs the telemetry it keeps receiving; both hold the arena.
+enum class UIMode : uint8_t { Telemetry = 0, CommandsWaiting = 1, Commands = 2, History = 3 };
 static UIMode mode = UIMode::Telemetry;
 static UIMode requestedMode = UIMode::Telemetry;  // user’s desired mode
 
+static bool telemetryMode() { return mode == UIMode::Telemetry || mode == UIMode::History; }
+
+// --- Metric history view ---
+// Rows show "<label> <graph>"; the encoder pages through sparklines, then
+// bar graphs, LCD_ROWS metrics at a time.
+constexpr uint8_t HISTORY_LABEL_COLS = 4;  // 3 chars of the line + the unit after the field
+constexpr uint8_t HISTORY_GRAPH_COLS = LCD_COLS - HISTORY_LABEL_COLS;
+static MetricHistory history;
+static int16_t historyPage = 0;
+
 // --- Commands list state ---
-constexpr uint8_t CMD_MAX = 12;  // max commands kept (fits our frame capacity)
-struct CmdItem {
-  char id[CMD_ID_STORAGE];           // short id, e.g., "1", "42"
-  char label[CMD_LABEL_STORAGE];     // label text (will render in CMD_LABEL_VISIBLE cols)
+// The daemon serves each menu in pages of CMD_PAGE "<id> <label>" entries.
+// The sketch asks for the pages the window shows plus the next one in the
+// direction the cursor last moved, and keeps each entry in the arena slot it
+// was received into. Telemetry only holds the arena in Telemetry mode: its
+// lines are released when the menu is requested and refetched when it
+// closes. An entry whose id is "@<n>" opens menu n; the row after the last
+// entry leaves the menu (Exit in the top menu 0, Back in a submenu).
+// Pages carry the daemon's digest of its whole menu tree; with one, the top
+// menu's first page outlives the menu (and the frame watchdog) for as long
+// as telemetry leaves its slots free, so the next long press shows it at
+// once and only asks whether it is still current.
+constexpr uint8_t CMD_PAGE = static_cast<uint8_t>(Panel::Buffer::kStageGuarantee);
+constexpr uint8_t CMD_PAGES = 2;        // pages cached: the window's, or its and the next
+constexpr uint8_t CMD_NO_PAGE = 0xFF;
+constexpr int16_t CMD_MAX = static_cast<int16_t>(CMD_PAGE) * CMD_NO_PAGE;  // entries per menu
+constexpr uint8_t CMD_MENU_DEPTH = 4;   // submenu cursors remembered for Back
+constexpr char CMD_SUBMENU_PREFIX = '@';
+static_assert(LCD_ROWS <= CMD_PAGE, "the window spans at most CMD_PAGES pages");
+static_assert((CMD_PAGES + 1) * CMD_PAGE <= Panel::Arena::kSlots,
+              "cached pages and the page being staged share the arena");
+
+struct CommandPage {
+  uint8_t page = CMD_NO_PAGE;
+  bool loaded = false;      // false while the request is in flight
+  uint8_t slots[CMD_PAGE];  // arena slot per entry once loaded, kNone past the end
 };
-static CmdItem commands[CMD_MAX];
-static uint8_t commandsCount = 0;   // number of received commands (without Exit)
+static CommandPage commandPages[CMD_PAGES];
+static uint8_t menuId = 0;          // menu on screen
+static uint8_t menuParent = 0;      // menu Back returns to
+static int16_t commandsCount = 0;   // entries in the menu (without Exit/Back)
 static int16_t cursorIndex = 0;     // selection within [0..commandsCount] where last is Exit
 static int16_t windowStart = 0;     // top-most visible item index in commands view
+static bool cursorDown = true;      // last cursor direction; picks the page to prefetch
+static int16_t menuStack[CMD_MENU_DEPTH];  // cursor in each menu above this one
+static uint8_t menuDepth = 0;
+static uint16_t menuDigest = 0;     // daemon's menu digest from the last page; 0 if none
+static bool menuKept = false;       // the top page outlived the menu; not yet confirmed
+static_assert(sizeof(commandPages) + sizeof(menuStack) == MemoryBudget::kCommandPages,
+              "MemoryBudget.h counts the menu state");
 
 // --- Frame watchdog ---
 static const unsigned long FRAME_TIMEOUT_DEFAULT_MS = 10000;  // fallback watchdog
@@ -75,12 +208,33 @@ static unsigned long lastFrameMs = 0;
 static unsigned long heartbeatIntervalMs = 3000;
 static bool haveData = false;
 static uint8_t waitAnim = 0;
-static unsigned long lastAnimMs = 0;
+static uint16_t marqueeStep = 0;
+static uint8_t marqueeRows = 0;  // visible rows showing a long line
+
+// --- EEPROM snapshot state ---
+static ScreenSnapshot snapshot;
+static bool snapshotShown = false;          // the buffer holds the boot snapshot
+static unsigned long snapshotAllowedMs = 0;  // earliest start of the next save
 
 // --- Heartbeat LED state ---
 static unsigned long greenPulseUntilMs = 0;
 static unsigned long redPulseUntilMs = 0;
-static unsigned long staleNextBlinkMs = 0;
+
+// --- Loop deadlines: loop() only does timed work when one of these is due ---
+enum LoopTask : uint8_t {
+  TASK_GREEN_OFF = 0,   // end of the green heartbeat pulse
+  TASK_RED_OFF,         // end of a red stale/ack pulse
+  TASK_STALE_BLINK,     // next red blink while frames are late
+  TASK_WATCHDOG,        // frame timeout
+  TASK_WAIT_ANIM,       // next step of the waiting animation
+  TASK_BUTTON_SETTLE,   // debounce window over; read the button again
+  TASK_LONG_PRESS,      // button held for BTN_LONG_MS
+  TASK_BAUD_PROBATION,  // no intact frame at the new link rate yet
+  TASK_MARQUEE,         // next marquee step
+  TASK_SNAPSHOT,        // save the screen to EEPROM
+  TASK_COUNT
+};
+static Scheduler<TASK_COUNT> tasks;
 
 static void triggerGreenPulse(unsigned long now, unsigned long duration = GREEN_PULSE_MS) {
   unsigned long expiry = now + duration;
@@ -91,6 +245,7 @@ static void triggerGreenPulse(unsigned long now, unsigned long duration = GREEN_
     expiry = greenPulseUntilMs;
   }
   greenPulseUntilMs = expiry;
+  tasks.at(TASK_GREEN_OFF, expiry);
   digitalWrite(PIN_LED_GREEN, HIGH);
 }
 
@@ -103,11 +258,26 @@ static void triggerRedPulse(unsigned long now, unsigned long duration) {
     expiry = redPulseUntilMs;
   }
   redPulseUntilMs = expiry;
+  tasks.at(TASK_RED_OFF, expiry);
   digitalWrite(PIN_LED_RED, HIGH);
-  staleNextBlinkMs = now + STALE_PERIOD_MS;
+  if (tasks.armed(TASK_STALE_BLINK)) {
+    tasks.at(TASK_STALE_BLINK, now + STALE_PERIOD_MS);
+  }
 }
 
-static void updateHeartbeat(unsigned long now);
+// Without data the red LED follows the waiting animation.
+static void showWaitingLed() {
+  if (redPulseUntilMs == 0) {
+    digitalWrite(PIN_LED_RED, (waitAnim % 2) == 0 ? HIGH : LOW);
+  }
+}
+
+static unsigned long staleThresholdMs() {
+  unsigned long threshold = heartbeatIntervalMs * 2;
+  if (threshold < STALE_THRESHOLD_MIN_MS) threshold = STALE_THRESHOLD_MIN_MS;
+  if (threshold > frameTimeoutMs) threshold = frameTimeoutMs;
+  return threshold;
+}
 
 // --- Button handling (debounced, long/double press) ---
 constexpr uint16_t BTN_DEBOUNCE_MS = 20;
@@ -119,119 +289,384 @@ static unsigned long btnPressStartMs = 0;
 static bool btnPressed = false;
 static unsigned long lastShortReleaseMs = 0;
 
-void encoderISR() {
+#ifdef __AVR__
+// Button edges only need to wake the CPU from idle sleep; loop() reads the pin.
+EMPTY_INTERRUPT(PCINT2_vect);
+
+static void enableButtonWake() {
+  PCMSK2 |= _BV(PCINT20);  // D4
+  PCICR |= _BV(PCIE2);
+}
+#else
+static void enableButtonWake() {}
+#endif
+
+static volatile uint16_t encoderIrqs = 0;  // encoder edges serviced, for STATS
+
+static void encoderISR() {
+    BENCH_SCOPE(BENCH_ENCODER_ISR);
+    ++encoderIrqs;
     RotaryEncoder::handleInterrupt();
 }
 
+#ifdef __AVR__
+// Bound straight to INT0/INT1 rather than through attachInterrupt(), whose
+// shared ISR saves every call-clobbered register around an indirect call.
+// Nothing calls attachInterrupt(), so the core's vectors are never linked.
+ISR(INT0_vect) { encoderISR(); }
+ISR(INT1_vect, ISR_ALIASOF(INT0_vect));
+
+static void enableEncoderInterrupts() {
+  EICRA = _BV(ISC10) | _BV(ISC00);  // any change on INT1 (D3) and INT0 (D2)
+  EIFR = _BV(INTF1) | _BV(INTF0);   // forget edges latched before now
+  EIMSK |= _BV(INT1) | _BV(INT0);
+}
+#else
+static void enableEncoderInterrupts() {
+  attachInterrupt(digitalPinToInterrupt(PIN_ENC_A), encoderISR, CHANGE);
+  attachInterrupt(digitalPinToInterrupt(PIN_ENC_B), encoderISR, CHANGE);
+}
+#endif
+
 // --- Serial frame parsing ---
-static char inLine[LCD_BUFFER_LEN];
-static uint8_t inIdx = 0;
-static char frameLines[ScrollBuffer::kCapacity][LCD_BUFFER_LEN];
-static uint8_t frameCount = 0;
+static FrameParser parser(buffer);  // stages lines in buffer's back bank
+static bool telemetrySynced = false; // buffer holds a server frame that deltas can patch
+static uint16_t rxOverrunsSeen = 0;  // SerialLink::overruns() already accounted for
+static uint16_t badFrames = 0;       // frames rejected for CRC/layout errors
+static uint8_t acksOwed = 0;         // committed telemetry frames not yet acked
+static unsigned long linkBaud = SERIAL_BAUD_DEFAULT;
+static uint8_t linkBadFrames = 0;    // frames rejected in a row at linkBaud
 
-static void applyTelemetryFrame() {
-  // Preserve current scroll position across frame updates
-  int16_t prevScroll = scroll;
-  buffer.clear();
-  for (uint8_t i = 0; i < frameCount; ++i) {
-    buffer.push(frameLines[i]);
-  }
+// --- Runtime counters, answered to REQ STATS ---
+// Counts wrap at 16 bits; the daemon diffs successive replies. The maxima
+// cover the time since the previous reply.
+static uint16_t framesRx = 0;        // intact frames parsed
+static uint16_t framesApplied = 0;   // ...that changed the screen or menu
+static uint16_t framesLost = 0;      // frames dropped after an RX overrun
+static uint16_t renders = 0;         // screens composed
+static uint16_t renderMaxUs = 0;     // longest serviceDisplay() pass
+static uint16_t loopMaxUs = 0;       // longest loop() pass, sleep excluded
+static bool statsRequested = false;  // reply once the loop pass is timed
+
+static void render() { renderRequested = true; }
+
+static void clampScroll() {
   int16_t maxScroll = 0;
   if (buffer.size() > LCD_ROWS) {
     maxScroll = static_cast<int16_t>(buffer.size() - LCD_ROWS);
   }
-  if (prevScroll < 0) prevScroll = 0;
-  if (prevScroll > maxScroll) prevScroll = maxScroll;
-  scroll = prevScroll;
+  if (scroll < 0) scroll = 0;
+  if (scroll > maxScroll) scroll = maxScroll;
 }
 
-static void applyCommandsFrame() {
-  // frameLines[0] == "COMMANDS v1" guaranteed by caller
+static void applyTelemetryFrame() {
+  // Lines already sit in the back bank; preserve scroll position across the swap
+  buffer.swap(parser.lineCount());
+  parser.addTruncated(buffer.fitTails());
+  clampScroll();
+  telemetrySynced = true;
+  snapshotShown = false;
+}
+
+// Print each value of a values frame into its line; false when the frame
+// names a layout other than the one on screen.
+static bool applyValuesFrame() {
+  NumericLayout& layout = parser.layout();
+  if (!telemetrySynced || !layout.matches(parser.layoutId())) {
+    return false;
+  }
+  for (uint8_t i = 0; i < parser.valueCount(); ++i) {
+    uint8_t field;
+    int16_t value;
+    parser.value(i, &field, &value);
+    const NumericLayout::Entry* e = layout.entry(field);
+    if (e == nullptr) continue;
+    char* text = buffer.edit(e->line);
+    if (text != nullptr) NumericLayout::patch(text, LCD_COLS, *e, value);
+  }
+  return true;
+}
+
+// One history sample per tracked field, read from the cells it is shown in.
+static void sampleHistory() {
+  const NumericLayout& layout = parser.layout();
+  history.track(layout, parser.layoutId());
+  if (history.metrics() == 0) return;
+  char line[LCD_BUFFER_LEN];
+  for (uint8_t m = 0; m < history.metrics(); ++m) {
+    const NumericLayout::Entry* e = layout.entry(history.field(m));
+    buffer.get(e->line, line);
+    history.record(m, NumericLayout::parse(line, *e));
+  }
+  history.commit();
+}
+
+static bool applyDeltaFrame() {
+  if (!telemetrySynced) {
+    return false;  // nothing to patch; caller asks for a full frame
+  }
+  buffer.resize(parser.total());
+  buffer.adoptStaged();
+  parser.addTruncated(buffer.fitTails());
+  clampScroll();
+  return true;
+}
+
+static void dropPage(CommandPage& p) {
+  if (p.loaded) {
+    for (uint8_t slot : p.slots) arena.release(slot);
+  }
+  p.page = CMD_NO_PAGE;
+  p.loaded = false;
+}
+
+static void releaseCommands() {
+  for (CommandPage& p : commandPages) dropPage(p);
   commandsCount = 0;
-  for (uint8_t i = 1; i < frameCount && commandsCount < CMD_MAX; ++i) {
-    // Each line: "<id> <label>" (max 20 chars). Split at first space.
-    const char* ln = frameLines[i];
-    // Find first space
-    const char* sp = nullptr;
-    for (uint8_t j = 0; j < LCD_COLS && ln[j] != '\0'; ++j) {
-      if (ln[j] == ' ') { sp = &ln[j]; break; }
-    }
-    if (sp == nullptr) {
-      // malformed; skip
-      continue;
+  menuKept = false;
+}
+
+// Give the telemetry lines back to the arena; the daemon resends them on
+// REQ FULL.
+static void releaseTelemetry() {
+  buffer.clear();
+  telemetrySynced = false;
+  snapshotShown = false;
+}
+
+static CommandPage* cachedPage(uint8_t page) {
+  for (CommandPage& p : commandPages) {
+    if (p.page == page) return &p;
+  }
+  return nullptr;
+}
+
+// Leaving the menu: the top menu's first page stays in the arena when the
+// daemon sent a digest to check it against later; every other page goes.
+static void keepTopPage() {
+  CommandPage* top = (menuId == 0 && menuDigest != 0) ? cachedPage(0) : nullptr;
+  if (top == nullptr || !top->loaded) {
+    releaseCommands();
+    return;
+  }
+  for (CommandPage& p : commandPages) {
+    if (&p != top) dropPage(p);
+  }
+  menuKept = true;  // commandsCount still holds the top menu's size
+}
+
+// Telemetry comes first: once it leaves fewer free slots than the next
+// frame may need to stage, the kept page gives its slots back. Called after
+// a commit, when the staged leftovers can go back to the arena early.
+static void trimKeptPage() {
+  if (!menuKept || !telemetryMode()) return;
+  buffer.discardBack();
+  if (arena.available() < Panel::Buffer::kStageGuarantee) releaseCommands();
+}
+
+// Stored "<id> <label>" line of entry i; nullptr until its page arrives.
+static const char* commandLine(int16_t i) {
+  const CommandPage* p = cachedPage(static_cast<uint8_t>(i / CMD_PAGE));
+  if (p == nullptr || !p->loaded) return nullptr;
+  uint8_t slot = p->slots[i % CMD_PAGE];
+  return (slot != Panel::Arena::kNone) ? arena.line(slot) : nullptr;
+}
+
+// Label part of an entry line (all of it when there is no space).
+static const char* commandLabel(const char* ln) {
+  const char* sp = strchr(ln, ' ');
+  return (sp != nullptr) ? sp + 1 : ln;
+}
+
+// Id part of an entry line, truncated to CMD_ID_STORAGE - 1 chars.
+static void commandId(const char* ln, char out[CMD_ID_STORAGE]) {
+  uint8_t len = 0;
+  while (ln[len] != ' ' && ln[len] != '\0' && len < CMD_ID_STORAGE - 1) {
+    out[len] = ln[len];
+    ++len;
+  }
+  out[len] = '\0';
+}
+
+// "REQ COMMANDS <menu> <offset> <count>[ have=<digest>]"
+static void requestPage(uint8_t page, uint16_t have = 0) {
+  SerialLink::printP(PSTR("REQ COMMANDS "));
+  SerialLink::print(static_cast<unsigned long>(menuId));
+  SerialLink::write(' ');
+  SerialLink::print(static_cast<unsigned long>(page) * CMD_PAGE);
+  SerialLink::write(' ');
+  SerialLink::print(static_cast<unsigned long>(CMD_PAGE));
+  if (have != 0) {
+    SerialLink::printP(PSTR(" have="));
+    SerialLink::print(static_cast<unsigned long>(have));
+  }
+  SerialLink::println();
+}
+
+// Cache the pages under the window and, while the window fits in one page,
+// the neighbouring page the cursor is heading for, so it is usually there
+// before the cursor reaches it. Pages no longer wanted are dropped first to
+// make room; a reply for a dropped page is ignored.
+static void fetchPages() {
+  uint8_t want[CMD_PAGES];
+  uint8_t wanted = 0;
+  int16_t shown = windowStart + LCD_ROWS;
+  if (shown > commandsCount) shown = commandsCount;
+  if (shown > windowStart) {
+    uint8_t first = static_cast<uint8_t>(windowStart / CMD_PAGE);
+    uint8_t last = static_cast<uint8_t>((shown - 1) / CMD_PAGE);
+    want[wanted++] = first;
+    if (last != first) {
+      want[wanted++] = last;
+    } else if (cursorDown && (first + 1) * CMD_PAGE < commandsCount) {
+      want[wanted++] = static_cast<uint8_t>(first + 1);
+    } else if (!cursorDown && first > 0) {
+      want[wanted++] = static_cast<uint8_t>(first - 1);
     }
-    uint8_t idLen = static_cast<uint8_t>(sp - ln);
-    if (idLen == 0) continue;
-    uint8_t lblLen = 0;
-    const char* lbl = sp + 1;
-    while (lbl[lblLen] != '\0' && lblLen < CMD_LABEL_VISIBLE) { ++lblLen; }
-    // Copy id (truncate to storage)
-    uint8_t idCopy = idLen < (CMD_ID_STORAGE - 1) ? idLen : (CMD_ID_STORAGE - 1);
-    for (uint8_t k = 0; k < idCopy; ++k) commands[commandsCount].id[k] = ln[k];
-    commands[commandsCount].id[idCopy] = '\0';
-    // Copy label (truncate to visible width)
-    uint8_t labCopy = lblLen < CMD_LABEL_VISIBLE ? lblLen : CMD_LABEL_VISIBLE;
-    for (uint8_t k = 0; k < labCopy; ++k) commands[commandsCount].label[k] = lbl[k];
-    commands[commandsCount].label[labCopy] = '\0';
-    ++commandsCount;
-  }
-  // Reset cursor/window on fresh commands
+  }
+  for (CommandPage& p : commandPages) {
+    bool keep = false;
+    for (uint8_t i = 0; i < wanted; ++i) keep = keep || p.page == want[i];
+    if (!keep) dropPage(p);
+  }
+  for (uint8_t i = 0; i < wanted; ++i) {
+    if (cachedPage(want[i]) != nullptr) continue;
+    cachedPage(CMD_NO_PAGE)->page = want[i];  // wanted <= CMD_PAGES, so one is free
+    requestPage(want[i]);
+  }
+}
+
+// A lost frame may have been a page reply: ask again for those in flight.
+static void retryPages() {
+  for (const CommandPage& p : commandPages) {
+    if (p.page != CMD_NO_PAGE && !p.loaded) requestPage(p.page);
+  }
+}
+
+// Keep the cursor inside the list and the window around the cursor, then
+// fetch the pages the window now needs.
+static void moveCursor(int16_t movement) {
+  if (movement != 0) cursorDown = movement > 0;
+  int16_t total = commandsCount + 1;  // incl Exit
+  cursorIndex += movement;
+  if (cursorIndex < 0) cursorIndex = 0;
+  if (cursorIndex >= total) cursorIndex = total - 1;
+  if (cursorIndex < windowStart) windowStart = cursorIndex;
+  int16_t windowHeight = static_cast<int16_t>(LCD_ROWS);
+  if (cursorIndex > windowStart + (windowHeight - 1)) {
+    windowStart = cursorIndex - (windowHeight - 1);
+  }
+  int16_t maxWindowStart = (total > windowHeight) ? (total - windowHeight) : 0;
+  if (windowStart > maxWindowStart) windowStart = maxWindowStart;
+  if (windowStart < 0) windowStart = 0;
+  fetchPages();
+}
+
+// Show the kept top page straight away and ask the daemon whether its menu
+// is still the one the page came from; while it is, the reply is the page
+// header alone.
+static void reopenTopMenu() {
+  menuId = 0;
+  menuParent = 0;
   cursorIndex = 0;
   windowStart = 0;
+  cursorDown = true;
+  mode = UIMode::Commands;
+  requestedMode = UIMode::Commands;
+  requestPage(0, menuDigest);
+  moveCursor(0);  // prefetch as usual
+  render();
 }
 
-static bool parseMetaLine(const char* line) {
-  if (strncmp(line, META_PREFIX, META_PREFIX_LEN) != 0) {
+// Show menu `menu`, `cursor` selected on the top row, once its first page
+// arrives.
+static void openMenu(uint8_t menu, int16_t cursor) {
+  if (menu == 0 && cursor == 0 && menuKept) {
+    reopenTopMenu();
+    return;
+  }
+  releaseCommands();
+  menuId = menu;
+  cursorIndex = cursor;
+  windowStart = cursor;
+  cursorDown = true;
+  mode = UIMode::CommandsWaiting;
+  requestedMode = UIMode::Commands;
+  commandPages[0].page = static_cast<uint8_t>(cursor / CMD_PAGE);
+  requestPage(commandPages[0].page);
+  render();
+}
+
+// File the page frame's lines under the request they answer. Pages of
+// another menu, pages the cursor has moved away from and duplicates are
+// ignored. A COMMANDS frame from an older daemon is taken as the first page
+// of the top menu. The answer for a kept page either confirms it (header
+// only, same digest) or replaces it.
+static bool applyCommandPage() {
+  bool legacy = parser.kind() == FrameKind::Commands;
+  uint16_t offset = parser.pageOffset();
+  if (telemetryMode() || parser.menu() != menuId || offset % CMD_PAGE != 0 ||
+      offset / CMD_PAGE >= CMD_NO_PAGE) {
     return false;
   }
+  CommandPage* p = cachedPage(static_cast<uint8_t>(offset / CMD_PAGE));
+  if (p == nullptr) return false;
+  if (p->loaded) {
+    if (!menuKept || legacy || menuId != 0 || offset != 0) return false;
+    menuKept = false;
+    if (parser.lineCount() == 0 && parser.pageDigest() == menuDigest) return true;
+    for (uint8_t slot : p->slots) arena.release(slot);  // the menu changed
+  }
+  menuDigest = legacy ? 0 : parser.pageDigest();
+  for (uint8_t i = 0; i < CMD_PAGE; ++i) {
+    p->slots[i] = (i < parser.lineCount()) ? buffer.takeBack(i) : Panel::Arena::kNone;
+  }
+  p->loaded = true;
+  uint16_t total = legacy ? parser.lineCount() : parser.pageTotal();
+  if (legacy && total > CMD_PAGE) total = CMD_PAGE;
+  commandsCount = (total < CMD_MAX) ? static_cast<int16_t>(total) : CMD_MAX;
+  menuParent = parser.parent();
+  mode = UIMode::Commands;
+  moveCursor(0);  // the menu may have changed size since the last page
+  return true;
+}
 
-  const char* intervalPtr = strstr(line, META_INTERVAL_KEY);
-  if (intervalPtr != nullptr) {
-    intervalPtr += META_INTERVAL_KEY_LEN;
-    char* endPtr = nullptr;
-    double sec = strtod(intervalPtr, &endPtr);
-    if (sec > 0.0) {
-      unsigned long intervalMs = static_cast<unsigned long>(sec * 1000.0);
-      if (intervalMs < HEARTBEAT_MIN_INTERVAL_MS) {
-        intervalMs = HEARTBEAT_MIN_INTERVAL_MS;
-      }
-      heartbeatIntervalMs = intervalMs;
+static void applyInterval(unsigned long intervalMs) {
+  if (intervalMs < HEARTBEAT_MIN_INTERVAL_MS) {
+    intervalMs = HEARTBEAT_MIN_INTERVAL_MS;
+  }
+  heartbeatIntervalMs = intervalMs;
 
-      unsigned long candidate;
-      if (intervalMs > FRAME_TIMEOUT_MAX_MS / FRAME_LOSS_MULTIPLIER) {
-        candidate = FRAME_TIMEOUT_MAX_MS;
-      } else {
-        candidate = intervalMs * FRAME_LOSS_MULTIPLIER;
-      }
-      if (candidate < FRAME_TIMEOUT_MIN_MS) candidate = FRAME_TIMEOUT_MIN_MS;
-      if (candidate > FRAME_TIMEOUT_MAX_MS) candidate = FRAME_TIMEOUT_MAX_MS;
-      frameTimeoutMs = candidate;
-      displayTimeoutMs = candidate;
-    }
+  unsigned long candidate;
+  if (intervalMs > FRAME_TIMEOUT_MAX_MS / FRAME_LOSS_MULTIPLIER) {
+    candidate = FRAME_TIMEOUT_MAX_MS;
+  } else {
+    candidate = intervalMs * FRAME_LOSS_MULTIPLIER;
+  }
+  if (candidate < FRAME_TIMEOUT_MIN_MS) candidate = FRAME_TIMEOUT_MIN_MS;
+  if (candidate > FRAME_TIMEOUT_MAX_MS) candidate = FRAME_TIMEOUT_MAX_MS;
+  frameTimeoutMs = candidate;
+  displayTimeoutMs = candidate;
+  if (haveData) {
+    tasks.at(TASK_WATCHDOG, lastFrameMs + frameTimeoutMs + 1);
   }
-  return true;
 }
 
 static void processTelemetryFrame() {
-  applyTelemetryFrame();
   if (requestedMode == UIMode::Telemetry) {
     mode = UIMode::Telemetry;
     scroll = 0;
   }
 }
 
-static void processCommandsFrame() {
-  applyCommandsFrame();
-  requestedMode = UIMode::Commands;
-  mode = UIMode::Commands;
-}
-
 static void updateWatchdog(unsigned long now, bool pulseGreen) {
   haveData = true;
   lastFrameMs = now;
   waitAnim = 0;
-  lastAnimMs = now;
-  staleNextBlinkMs = now + STALE_PERIOD_MS;
+  tasks.cancel(TASK_WAIT_ANIM);
+  tasks.at(TASK_WATCHDOG, now + frameTimeoutMs + 1);
+  // First stale blink one period after frames are overdue
+  tasks.at(TASK_STALE_BLINK, now + staleThresholdMs() + STALE_PERIOD_MS);
   if (pulseGreen) {
     triggerGreenPulse(now);
   }
@@ -240,227 +675,690 @@ static void updateWatchdog(unsigned long now, bool pulseGreen) {
   }
 }
 
-static void commitFrameIfAny() {
-  if (frameCount == 0) return;
+static void announceCaps() {
+  SerialLink::printP(CAPS_LINE);
+  SerialLink::printP(PSTR(" lines="));
+  SerialLink::print(static_cast<unsigned long>(Panel::Buffer::kCapacity));
+  SerialLink::printP(PSTR(" stage="));
+  SerialLink::print(static_cast<unsigned long>(Panel::Buffer::kStageGuarantee));
+  SerialLink::printP(PSTR(" cols="));
+  SerialLink::print(static_cast<unsigned long>(LCD_COLS));
+  SerialLink::printP(PSTR(" fields="));
+  SerialLink::print(static_cast<unsigned long>(NumericLayout::kMaxFields));
+  SerialLink::printP(PSTR(" credits="));
+  SerialLink::print(static_cast<unsigned long>(FRAME_CREDITS));
+  SerialLink::printP(PSTR(" baud="));
+  SerialLink::print(SERIAL_BAUD_MAX);
+  SerialLink::printP(PSTR(" wide="));
+  SerialLink::println(static_cast<unsigned long>(Panel::Buffer::kLongWidth));
+}
 
-  bool hadMeta = parseMetaLine(frameLines[0]);
-  if (hadMeta) {
-    if (frameCount > 1) {
-      for (uint8_t i = 1; i < frameCount; ++i) {
-        memcpy(frameLines[i - 1], frameLines[i], LCD_BUFFER_LEN);
-      }
-      --frameCount;
-    } else {
-      frameCount = 0;
-    }
+static bool baudSupported(unsigned long rate) {
+  return rate == SERIAL_BAUD_DEFAULT ||
+         (rate != 0 && rate <= SERIAL_BAUD_MAX && F_CPU % (8UL * rate) == 0);
+}
+
+static void setBaud(unsigned long rate) {
+  SerialLink::flush();  // the last reply leaves at the old rate
+  SerialLink::begin(rate);
+  parser.reset();
+  linkBaud = rate;
+  linkBadFrames = 0;
+  if (rate == SERIAL_BAUD_DEFAULT) {
+    tasks.cancel(TASK_BAUD_PROBATION);
+  } else {
+    tasks.at(TASK_BAUD_PROBATION, millis() + BAUD_PROBATION_MS);
   }
+}
 
-  unsigned long now = millis();
+static void restoreBaud() {
+  if (linkBaud != SERIAL_BAUD_DEFAULT) setBaud(SERIAL_BAUD_DEFAULT);
+}
 
-  if (frameCount == 0) {
-    if (hadMeta) {
-      updateWatchdog(now, true);
-    }
+// A refused rate is answered with the one the link stays at.
+static void applyBaudFrame(unsigned long rate) {
+  if (!baudSupported(rate)) rate = linkBaud;
+  SerialLink::printP(PSTR("BAUD "));
+  SerialLink::println(rate);
+  if (rate != linkBaud) setBaud(rate);
+}
+
+// A rejected frame at a negotiated rate; too many in a row and it is dropped.
+static void countBadFrame() {
+  if (linkBaud != SERIAL_BAUD_DEFAULT && ++linkBadFrames >= BAUD_MAX_BAD) restoreBaud();
+}
+
+// Longest duration so far, saturating at 65535 us.
+static void noteMax(uint16_t& maxUs, unsigned long us) {
+  if (us > 0xFFFF) us = 0xFFFF;
+  if (us > maxUs) maxUs = static_cast<uint16_t>(us);
+}
+
+// key is in flash.
+static void printStat(const char* key, unsigned long value) {
+  SerialLink::printP(key);
+  SerialLink::print(value);
+}
+
+// "STATS rx=.. ok=.. bad=.. lost=.. ovr=.. trunc=.. draws=.. draw_us=..
+// loop_us=.. enc=.. free=..": frames parsed, applied, rejected for CRC or
+// layout errors and dropped after an overrun; bytes lost to overruns; line
+// characters cut at the panel width; screens composed and the longest display
+// pass; the longest loop() pass; encoder interrupts; and the fewest bytes of
+// SRAM that have stayed free since reset (StackPaint.h).
+static void reportStats() {
+  noInterrupts();
+  uint16_t enc = encoderIrqs;
+  interrupts();
+  SerialLink::printP(PSTR("STATS"));
+  printStat(PSTR(" rx="), framesRx);
+  printStat(PSTR(" ok="), framesApplied);
+  printStat(PSTR(" bad="), badFrames);
+  printStat(PSTR(" lost="), framesLost);
+  printStat(PSTR(" ovr="), SerialLink::overruns());
+  printStat(PSTR(" trunc="), parser.truncated());
+  printStat(PSTR(" draws="), renders);
+  printStat(PSTR(" draw_us="), renderMaxUs);
+  printStat(PSTR(" loop_us="), loopMaxUs);
+  printStat(PSTR(" enc="), enc);
+  printStat(PSTR(" free="), StackPaint::unused());
+  SerialLink::println();
+  renderMaxUs = 0;
+  loopMaxUs = 0;
+  statsRequested = false;
+}
+
+// Boot: put the saved rows back in the buffer, marked stale, and run the
+// watchdog on the interval they were received at.
+static void showSnapshot() {
+  if (!snapshot.load()) return;
+  buffer.clear();
+  char line[LCD_BUFFER_LEN];
+  for (uint8_t row = 0; row < LCD_ROWS; ++row) {
+    snapshot.row(row, line);
+    buffer.push(line);
+  }
+  scroll = 0;
+  applyInterval(snapshot.intervalMs());
+  snapshotShown = true;
+  render();
+}
+
+// A frame changed the screen: save it once the rate limit allows.
+static void scheduleSnapshot(unsigned long now) {
+  if (!telemetryMode() || !telemetrySynced) return;
+  if (tasks.armed(TASK_SNAPSHOT) || snapshot.saving()) return;
+  bool early = static_cast<long>(snapshotAllowedMs - now) > 0;
+  tasks.at(TASK_SNAPSHOT, early ? snapshotAllowedMs : now);
+}
+
+static void startSnapshot(unsigned long now) {
+  if (!telemetryMode() || !telemetrySynced) return;  // the next frame asks again
+  snapshot.begin(heartbeatIntervalMs);
+  snapshotAllowedMs = now + SNAPSHOT_PERIOD_MS;
+}
+
+// Write the next byte of a save in progress once the EEPROM is free. Rows
+// come from the buffer as the byte is written, so a frame arriving during
+// the save can leave rows from both frames in it.
+static void serviceSnapshot() {
+  if (!snapshot.saving() || !ScreenSnapshot::ready()) return;
+  if (!telemetryMode() || !telemetrySynced) {
+    snapshot.abort();  // the menu took the lines; the previous record stands
     return;
   }
+  uint8_t row, col;
+  char c = '\0';
+  if (snapshot.cell(&row, &col)) {
+    // get() only terminates a blank line, so zero the cells past the text:
+    // the record stays the same from save to save and unchanged bytes are
+    // never rewritten.
+    char line[LCD_BUFFER_LEN] = {};
+    buffer.get(static_cast<uint16_t>(scroll + row), line);
+    c = line[col];
+  }
+  snapshot.put(c);
+}
 
-  bool isCommands = (strncmp(frameLines[0], COMMANDS_HEADER, COMMANDS_HEADER_LEN) == 0);
+// Telemetry frames spend one of the daemon's credits; the replies to the
+// sketch's own requests do not.
+static bool spendsCredit(FrameKind kind) {
+  switch (kind) {
+    case FrameKind::Telemetry:
+    case FrameKind::Delta:
+    case FrameKind::KeepAlive:
+    case FrameKind::Layout:
+    case FrameKind::Values:
+      return true;
+    default:
+      return false;
+  }
+}
 
-  if (isCommands) {
-    processCommandsFrame();
-  } else {
-    processTelemetryFrame();
+static void commitFrame() {
+  BENCH_SCOPE(BENCH_COMMIT_FRAME);
+  if (parser.hello()) {
+    announceCaps();
+  }
+  if (parser.intervalMs() != 0) {
+    applyInterval(parser.intervalMs());
+  }
+
+  unsigned long now = millis();
+  if (spendsCredit(parser.kind()) && acksOwed < 0xFF) {
+    ++acksOwed;  // whether applied or answered with REQ FULL, it left the ring
   }
 
-  frameCount = 0;
-  updateWatchdog(now, !isCommands);
+  switch (parser.kind()) {
+    case FrameKind::KeepAlive:
+      if (!telemetrySynced && telemetryMode()) {
+        SerialLink::printlnP(REQ_FULL);
+      }
+      updateWatchdog(now, true);
+      return;
+    case FrameKind::Commands:
+    case FrameKind::Page:
+      if (applyCommandPage()) ++framesApplied;
+      updateWatchdog(now, false);
+      return;
+    case FrameKind::Delta:
+      if (!telemetryMode()) {
+        break;  // the menu owns the arena; refetched when it closes
+      }
+      if (!applyDeltaFrame()) {
+        // Our buffer is not the screen the daemon is diffing against.
+        SerialLink::printlnP(REQ_FULL);
+        return;
+      }
+      break;
+    case FrameKind::Values:
+      if (!telemetryMode()) {
+        break;
+      }
+      if (!applyValuesFrame()) {
+        SerialLink::printlnP(REQ_FULL);  // the daemon answers with a layout
+        return;
+      }
+      sampleHistory();
+      break;
+    case FrameKind::Layout:
+      if (telemetryMode()) {
+        applyTelemetryFrame();
+        sampleHistory();
+      } else {
+        parser.layout().clear();  // its lines were not taken
+      }
+      break;
+    case FrameKind::Telemetry:
+      if (telemetryMode()) {
+        applyTelemetryFrame();
+      }
+      parser.layout().clear();  // plain text lines have no numeric fields
+      break;
+    case FrameKind::Baud:
+      applyBaudFrame(parser.baud());
+      return;
+    case FrameKind::Stats:
+      statsRequested = true;
+      return;
+    case FrameKind::None:
+      return;
+  }
+  if (telemetryMode()) ++framesApplied;
+  processTelemetryFrame();
+  updateWatchdog(now, true);
+  scheduleSnapshot(now);
+  trimKeptPage();
 }
 
-static void render();
+static void reportRxOverruns(uint16_t count) {
+  SerialLink::printP(PSTR("RXOVR "));
+  SerialLink::println(static_cast<unsigned long>(count));
+}
 
 static void processSerial() {
-  while (Serial.available() > 0) {
-    char c = static_cast<char>(Serial.read());
-    if (c == '\r') {
-      continue;  // ignore CR
+  BENCH_SCOPE(BENCH_PROCESS_SERIAL);
+  while (SerialLink::available() > 0) {
+    uint16_t overruns = SerialLink::overruns();
+    if (overruns != rxOverrunsSeen) {
+      // Lost bytes belong to the frame in flight; never render it half-parsed.
+      rxOverrunsSeen = overruns;
+      parser.markCorrupt();
     }
-    if (c == '\n') {
-      // If we see a blank line, it's end-of-frame
-      if (inIdx == 0) {
-        commitFrameIfAny();
-        // Show new frame immediately
+    switch (parser.feed(static_cast<uint8_t>(SerialLink::read()))) {
+      case FrameParser::Result::Frame:
+        ++framesRx;
+        linkBadFrames = 0;
+        tasks.cancel(TASK_BAUD_PROBATION);  // the rate works
+        commitFrame();
+        // Show new frame on this loop pass
         render();
-      } else {
-        // Terminate current line and add to frame
-        inLine[inIdx] = '\0';
-        if (frameCount < ScrollBuffer::kCapacity) {
-          strncpy(frameLines[frameCount], inLine, LCD_BUFFER_LEN);
-          ++frameCount;
-        }
-        inIdx = 0;
-      }
-    } else {
-      if (inIdx < LCD_COLS) {
-        inLine[inIdx++] = c;
-      }
+        break;
+      case FrameParser::Result::Dropped:
+        ++framesLost;
+        reportRxOverruns(rxOverrunsSeen);
+        countBadFrame();
+        if (!telemetryMode()) retryPages();
+        break;
+      case FrameParser::Result::NoSlot:
+        // The arena was full, not the link: no overrun, no strike on the rate.
+        SerialLink::printlnP(PSTR("NOSLOT"));
+        if (!telemetryMode()) retryPages();
+        break;
+      case FrameParser::Result::Corrupt:
+        ++badFrames;
+        SerialLink::printP(PSTR("BADFRAME "));
+        SerialLink::println(static_cast<unsigned long>(badFrames));
+        countBadFrame();
+        if (!telemetryMode()) retryPages();
+        break;
+      case FrameParser::Result::Pending:
+        break;
     }
   }
 }
 
-static void printPadded(const char* s, uint8_t width) {
-  char padded[LCD_BUFFER_LEN];
+static int16_t historyWindows() {
+  uint8_t metrics = history.metrics();
+  return (metrics > LCD_ROWS) ? static_cast<int16_t>((metrics + LCD_ROWS - 1) / LCD_ROWS) : 1;
+}
+
+// "CPU%": the line's first chars up to the field, then the unit that follows it.
+static void historyLabel(const char* line, const NumericLayout::Entry& e, char out[]) {
+  uint8_t len = static_cast<uint8_t>(strlen(line));
   uint8_t i = 0;
-  for (; i < width && s[i] != '\0'; ++i) padded[i] = s[i];
-  for (; i < width; ++i) padded[i] = ' ';
-  padded[width] = '\0';
-  lcd.print(padded);
-}
-
-static void render() {
-  lcd.clear();
-  if (!haveData) {
-    static const char* anim = "|/-\\";
-    lcd.setCursor(0, 0);
-    char msg[LCD_BUFFER_LEN];
-    snprintf(msg, sizeof(msg), "Waiting for data %c", anim[waitAnim % WAITING_ANIM_FRAMES]);
-    printPadded(msg, LCD_COLS);
-    lcd.setCursor(0, 1);
-    if (displayTimeoutMs == 0) {
-      printPadded("Timeout: --", LCD_COLS);
+  for (; i < HISTORY_LABEL_COLS - 1 && i < e.col && i < len; ++i) out[i] = line[i];
+  uint8_t unit = static_cast<uint8_t>(e.col + NumericLayout::widthOf(e.fmt));
+  out[i++] = (unit < len) ? line[unit] : ' ';
+  out[i] = '\0';
+}
+
+// Newest sample in the rightmost cell, one eighth-step column per sample.
+static void composeSparkline(uint8_t row, uint8_t metric) {
+  uint8_t n = history.size();
+  if (n > HISTORY_GRAPH_COLS) n = HISTORY_GRAPH_COLS;
+  for (uint8_t age = 0; age < n; ++age) {
+    char c = LcdGlyphs::spark(history.level(metric, age) >> 1);
+    frame.putChar(static_cast<uint8_t>(LCD_COLS - 1 - age), row, c);
+  }
+}
+
+// Current value as a bar across the graph columns, kBarSteps pixels a cell.
+static void composeBar(uint8_t row, int16_t value) {
+  if (value < 0) value = 0;
+  if (value > MetricHistory::kFullScale) value = MetricHistory::kFullScale;
+  uint16_t pixels = static_cast<uint16_t>(
+      (static_cast<uint32_t>(value) * HISTORY_GRAPH_COLS * LcdGlyphs::kBarSteps +
+       MetricHistory::kFullScale / 2) / MetricHistory::kFullScale);
+  for (uint8_t col = HISTORY_LABEL_COLS; pixels > 0; ++col) {
+    uint8_t fill = (pixels > LcdGlyphs::kBarSteps) ? LcdGlyphs::kBarSteps
+                                                   : static_cast<uint8_t>(pixels);
+    frame.putChar(col, row, LcdGlyphs::bar(fill));
+    pixels -= fill;
+  }
+}
+
+static void composeHistory() {
+  if (history.metrics() == 0 || history.size() == 0) {
+    frame.printP(0, 0, TEXT_NO_HISTORY, LCD_COLS);
+    return;
+  }
+  int16_t windows = historyWindows();
+  bool bars = historyPage >= windows;
+  glyphs.want(bars ? GlyphSet::Bar : GlyphSet::Spark);
+  uint8_t first = static_cast<uint8_t>((historyPage % windows) * LCD_ROWS);
+  const NumericLayout& layout = parser.layout();
+  char line[LCD_BUFFER_LEN];
+  char label[HISTORY_LABEL_COLS + 1];
+  for (uint8_t row = 0; row < LCD_ROWS && first + row < history.metrics(); ++row) {
+    uint8_t m = static_cast<uint8_t>(first + row);
+    const NumericLayout::Entry* e = layout.entry(history.field(m));
+    if (e == nullptr) continue;  // layout retired by a text frame
+    buffer.get(e->line, line);
+    historyLabel(line, *e, label);
+    frame.print(0, row, label, HISTORY_LABEL_COLS);
+    if (bars) {
+      composeBar(row, NumericLayout::parse(line, *e));
     } else {
-      unsigned long seconds = (displayTimeoutMs + 500) / 1000;
-      char timeoutLine[LCD_BUFFER_LEN];
-      snprintf(timeoutLine, sizeof(timeoutLine), "Timeout: %lus", seconds);
-      printPadded(timeoutLine, LCD_COLS);
+      composeSparkline(row, m);
     }
-    for (uint8_t row = 2; row < LCD_ROWS; ++row) {
-      lcd.setCursor(0, row);
-      printPadded("", LCD_COLS);
+  }
+}
+
+// Telemetry line idx on row; a long line shows the window the marquee has
+// reached. Returns whether the row scrolls.
+static bool composeTelemetryRow(uint8_t row, uint16_t idx) {
+  char line[LCD_BUFFER_LEN];
+  buffer.get(idx, line);
+  const char* tail = buffer.tail(idx);
+  if (tail[0] == '\0') {
+    frame.print(0, row, line, LCD_COLS);
+    return false;
+  }
+  uint8_t headLen = static_cast<uint8_t>(strlen(line));
+  uint8_t len = static_cast<uint8_t>(headLen + strlen(tail));
+  uint8_t cycle = static_cast<uint8_t>(len + MARQUEE_GAP);
+  uint8_t pos = static_cast<uint8_t>(marqueeStep % (cycle + MARQUEE_HOLD));
+  uint8_t start = (pos < MARQUEE_HOLD) ? 0 : static_cast<uint8_t>(pos - MARQUEE_HOLD);
+  for (uint8_t col = 0; col < LCD_COLS; ++col) {
+    uint8_t at = static_cast<uint8_t>((start + col) % cycle);
+    char c = ' ';
+    if (at < headLen) {
+      c = line[at];
+    } else if (at < len) {
+      c = tail[at - headLen];
     }
-    return;
+    frame.putChar(col, row, c);
+  }
+  return true;
+}
+
+// Start the marquee clock when a long line is on screen, stop it otherwise.
+static void armMarquee() {
+  if (marqueeRows == 0) {
+    tasks.cancel(TASK_MARQUEE);
+  } else if (!tasks.armed(TASK_MARQUEE)) {
+    tasks.at(TASK_MARQUEE, millis() + MARQUEE_STEP_MS);
   }
+}
+
+static char waitingSpinner() {
+  return static_cast<char>(pgm_read_byte(&WAITING_ANIM[waitAnim % WAITING_ANIM_FRAMES]));
+}
 
-  if (mode == UIMode::Telemetry) {
+static void composeFrame() {
+  frame.clear();
+  marqueeRows = 0;
+  if (!haveData && !snapshotShown) {
     char line[LCD_BUFFER_LEN];
+    uint8_t len = TextFormat::appendP(line, 0, LCD_COLS, TEXT_WAITING_ANIM);
+    TextFormat::appendChar(line, len, LCD_COLS, waitingSpinner());
+    frame.print(0, 0, line, LCD_COLS);
+    if (displayTimeoutMs == 0) {
+      frame.printP(0, 1, TEXT_TIMEOUT_OFF, LCD_COLS);
+    } else {
+      uint32_t seconds = (displayTimeoutMs + 500) / 1000;
+      len = TextFormat::appendP(line, 0, LCD_COLS, TEXT_TIMEOUT);
+      len = TextFormat::appendUnsigned(line, len, LCD_COLS, seconds);
+      TextFormat::appendChar(line, len, LCD_COLS, 's');
+      frame.print(0, 1, line, LCD_COLS);
+    }
+  } else if (mode == UIMode::Telemetry) {
+    if (!tasks.armed(TASK_MARQUEE)) marqueeStep = 0;  // a long line starts at its start
     for (uint8_t row = 0; row < LCD_ROWS; ++row) {
-      uint16_t idx = scroll + row;
-      buffer.get(idx, line);
-      lcd.setCursor(0, row);
-      printPadded(line, LCD_COLS);
+      if (composeTelemetryRow(row, static_cast<uint16_t>(scroll + row))) {
+        marqueeRows = static_cast<uint8_t>(marqueeRows | (1u << row));
+      }
     }
+    if (snapshotShown) frame.putChar(LCD_COLS - 1, 0, waitingSpinner());  // stale
+  } else if (mode == UIMode::History) {
+    composeHistory();
   } else if (mode == UIMode::CommandsWaiting) {
-    lcd.setCursor(0, 0);
-    printPadded("> Loading commands...", LCD_COLS);
+    frame.printP(0, 0, TEXT_LOADING, LCD_COLS);
   } else {  // Commands
     // Total entries = commandsCount + 1 (Exit)
-    int16_t total = static_cast<int16_t>(commandsCount) + 1;
+    int16_t total = commandsCount + 1;
     for (uint8_t row = 0; row < LCD_ROWS; ++row) {
       int16_t idx = windowStart + row;
-      lcd.setCursor(0, row);
-      char label[CMD_LABEL_STORAGE];
       if (idx < 0 || idx >= total) {
-        printPadded("", LCD_COLS);
         continue;
       }
+      // Cursor at col 0, label at col 1 with width CMD_LABEL_VISIBLE
+      frame.putChar(0, row, (idx == cursorIndex) ? '>' : ' ');
+      const char* ln = (idx < commandsCount) ? commandLine(idx) : nullptr;
       if (idx == commandsCount) {
-        // Exit entry
-        label[0] = '\0';
-        strncpy(label, "Exit", CMD_LABEL_STORAGE);
+        frame.printP(1, row, (menuId == 0) ? TEXT_EXIT : TEXT_BACK, CMD_LABEL_VISIBLE);
+      } else if (ln == nullptr) {
+        frame.printP(1, row, TEXT_PAGE_PENDING, CMD_LABEL_VISIBLE);  // page still on its way
       } else {
-        strncpy(label, commands[idx].label, CMD_LABEL_VISIBLE);
-        label[CMD_LABEL_VISIBLE] = '\0';
+        frame.print(1, row, commandLabel(ln), CMD_LABEL_VISIBLE);
       }
-      label[CMD_LABEL_STORAGE - 1] = '\0';
-      // Render cursor and label (cursor at col 0, label at col 1 with width CMD_LABEL_VISIBLE)
-      lcd.print((idx == cursorIndex) ? ">" : " ");
-      printPadded(label, CMD_LABEL_VISIBLE);
     }
   }
+  armMarquee();
+}
+
+// Queue as much of the composed frame as the LCD ring has room for.
+static void flushDisplay() {
+  uint8_t room = LcdDriver::room();
+  room -= glyphs.upload(lcd, room);  // the frame may draw with the new set
+  if (room == 0) return;
+  FlushStats step = frame.flush(lcd, room);
+  flushProgress.cells += step.cells;
+  flushProgress.commands += step.commands;
+  if (!step.complete) return;
+  flushPending = false;
+  lastFlush = flushProgress;
+#ifdef LCDMON_TRACE_FLUSH
+  SerialLink::printP(PSTR("FLUSH cells="));
+  SerialLink::print(lastFlush.cells);
+  SerialLink::printP(PSTR(" cmds="));
+  SerialLink::println(lastFlush.commands);
+#endif
+}
+
+static void serviceDisplay() {
+  if (!renderRequested && !flushPending) return;
+  BENCH_SCOPE(BENCH_RENDER);
+  unsigned long start = micros();
+  if (renderRequested) {
+    renderRequested = false;
+    composeFrame();
+    ++renders;
+    flushPending = true;
+    flushProgress = FlushStats();
+  }
+  flushDisplay();
+  noteMax(renderMaxUs, micros() - start);
+}
+
+// Move the long rows one column. A display still busy with the last update
+// skips the step rather than restart its flush.
+static void stepMarquee(unsigned long now) {
+  if (marqueeRows == 0 || mode != UIMode::Telemetry || !haveData) return;
+  tasks.at(TASK_MARQUEE, now + MARQUEE_STEP_MS);
+  if (renderRequested || flushPending) return;
+  ++marqueeStep;
+  for (uint8_t row = 0; row < LCD_ROWS; ++row) {
+    if (marqueeRows & (1u << row)) composeTelemetryRow(row, static_cast<uint16_t>(scroll + row));
+  }
+  flushPending = true;
+  flushProgress = FlushStats();
+}
+
+// Return credits once every committed frame is on the glass (or queued for it).
+static void sendAcks() {
+  if (acksOwed == 0 || renderRequested || flushPending) return;
+  SerialLink::printP(PSTR("ACK "));
+  SerialLink::println(static_cast<unsigned long>(acksOwed));
+  acksOwed = 0;
 }
 
 static void updateHeartbeat(unsigned long now) {
-  if (greenPulseUntilMs != 0 && static_cast<long>(now - greenPulseUntilMs) >= 0) {
+  if (tasks.due(TASK_GREEN_OFF, now)) {
     greenPulseUntilMs = 0;
     digitalWrite(PIN_LED_GREEN, LOW);
   }
 
-  if (redPulseUntilMs != 0 && static_cast<long>(now - redPulseUntilMs) >= 0) {
+  if (tasks.due(TASK_RED_OFF, now)) {
     redPulseUntilMs = 0;
     digitalWrite(PIN_LED_RED, LOW);
+    if (!haveData) {
+      showWaitingLed();
+    }
   }
 
-  if (haveData) {
+  if (tasks.due(TASK_STALE_BLINK, now) && haveData) {
     unsigned long since = now - lastFrameMs;
-    unsigned long staleThreshold = heartbeatIntervalMs * 2;
-    if (staleThreshold < STALE_THRESHOLD_MIN_MS) staleThreshold = STALE_THRESHOLD_MIN_MS;
-    if (staleThreshold > frameTimeoutMs) staleThreshold = frameTimeoutMs;
-
-    if (since >= staleThreshold && since < frameTimeoutMs) {
-      if (staleNextBlinkMs == 0 || static_cast<long>(now - staleNextBlinkMs) >= 0) {
-        triggerRedPulse(now, RED_STALE_PULSE_MS);
-        staleNextBlinkMs = now + STALE_PERIOD_MS;
-      }
-    } else {
-      staleNextBlinkMs = now + STALE_PERIOD_MS;
-      if (redPulseUntilMs == 0) {
-        digitalWrite(PIN_LED_RED, LOW);
-      }
+    if (since >= staleThresholdMs() && since < frameTimeoutMs) {
+      triggerRedPulse(now, RED_STALE_PULSE_MS);
     }
+    tasks.at(TASK_STALE_BLINK, now + STALE_PERIOD_MS);
+  }
+}
+
+// Leave the menu: free its slots and ask the daemon for the telemetry lines
+// that were released to make room for it.
+static void showTelemetry() {
+  mode = UIMode::Telemetry;
+  requestedMode = UIMode::Telemetry;
+  scroll = 0;
+  keepTopPage();
+  menuDepth = 0;
+  buffer.clear();
+  snapshotShown = false;
+  pushWaiting();
+  SerialLink::printlnP(REQ_FULL);
+  render();
+}
+
+// Open a submenu, remembering where the cursor was for Back. Past
+// CMD_MENU_DEPTH levels the outermost positions are forgotten; Back still
+// finds its way up because every page names its parent menu.
+static void enterMenu(uint8_t menu) {
+  if (menuDepth == CMD_MENU_DEPTH) {
+    memmove(menuStack, menuStack + 1, sizeof(menuStack) - sizeof(menuStack[0]));
+    --menuDepth;
+  }
+  menuStack[menuDepth++] = cursorIndex;
+  openMenu(menu, 0);
+}
+
+static void leaveMenu() {
+  if (menuId == 0) {
+    showTelemetry();
+    return;
+  }
+  openMenu(menuParent, (menuDepth > 0) ? menuStack[--menuDepth] : 0);
+}
+
+static void onLongPress() {
+  // Long press: toggle Commands mode or exit to Telemetry
+  if (telemetryMode()) {
+    // Enter commands: request the top menu and show waiting
+    releaseTelemetry();  // its pages are staged in the slots this frees
+    menuDepth = 0;
+    openMenu(0, 0);
   } else {
-    staleNextBlinkMs = now + STALE_PERIOD_MS;
-    if (redPulseUntilMs == 0) {
-      bool on = (waitAnim % 2) == 0;
-      digitalWrite(PIN_LED_RED, on ? HIGH : LOW);
+    // Exit to telemetry and reset scroll to top
+    showTelemetry();
+  }
+}
+
+// Telemetry and History both follow the incoming frames; the encoder moves
+// between them past the last line, a double press from anywhere.
+static void showTelemetryView(UIMode view) {
+  mode = view;
+  requestedMode = view;
+  historyPage = 0;
+}
+
+static void onShortPress(unsigned long now) {
+  // Short press: check for double press
+  if ((now - lastShortReleaseMs) <= BTN_DOUBLE_GAP_MS) {
+    // Double press: in Commands mode -> select; Telemetry <-> History
+    if (mode == UIMode::Telemetry || mode == UIMode::History) {
+      showTelemetryView((mode == UIMode::Telemetry) ? UIMode::History : UIMode::Telemetry);
+      render();
+    } else if (mode == UIMode::Commands) {
+      const char* ln = commandLine(cursorIndex);
+      if (cursorIndex == commandsCount) {
+        leaveMenu();  // Exit or Back entry selected
+      } else if (ln != nullptr && ln[0] == CMD_SUBMENU_PREFIX) {
+        enterMenu(static_cast<uint8_t>(atoi(ln + 1)));
+      } else if (ln != nullptr) {
+        char id[CMD_ID_STORAGE];
+        commandId(ln, id);
+        SerialLink::printP(PSTR("SELECT "));
+        SerialLink::println(id);
+        triggerRedPulse(now, RED_ACK_PULSE_MS);
+      }
     }
-    if (greenPulseUntilMs == 0) {
-      digitalWrite(PIN_LED_GREEN, LOW);
+  }
+  lastShortReleaseMs = now;
+}
+
+// Debounced button: long press fires once held for BTN_LONG_MS, short and
+// double presses on release.
+static void updateButton(unsigned long now) {
+  tasks.due(TASK_BUTTON_SETTLE, now);  // only exists to end the sleep
+  uint8_t btn = digitalRead(PIN_BTN);
+  if (btn != btnPrev) {
+    if ((now - btnLastChangeMs) <= BTN_DEBOUNCE_MS) {
+      tasks.at(TASK_BUTTON_SETTLE, btnLastChangeMs + BTN_DEBOUNCE_MS + 1);
+    } else {
+      btnLastChangeMs = now;
+      btnPrev = btn;
+      if (btn == LOW) {
+        // pressed
+        btnPressed = true;
+        btnPressStartMs = now;
+        tasks.at(TASK_LONG_PRESS, now + BTN_LONG_MS);
+      } else if (btnPressed) {
+        // released before the long-press deadline was serviced
+        btnPressed = false;
+        tasks.cancel(TASK_LONG_PRESS);
+        if ((now - btnPressStartMs) >= BTN_LONG_MS) {
+          onLongPress();
+        } else {
+          onShortPress(now);
+        }
+      }
     }
   }
+
+  if (tasks.due(TASK_LONG_PRESS, now) && btnPressed) {
+    btnPressed = false;  // the release that follows is not a short press
+    onLongPress();
+  }
 }
 
 void setup() {
-    Serial.begin(115200);
-    while (!Serial) {
-        ; // Wait for serial
-    }
+    SerialLink::begin(SERIAL_BAUD_DEFAULT);
     
-    RotaryEncoder::init(PIN_ENC_A, PIN_ENC_B);
+    RotaryEncoder::init();
     pinMode(PIN_BTN, INPUT_PULLUP);
     pinMode(PIN_LED_GREEN, OUTPUT);
     pinMode(PIN_LED_RED, OUTPUT);
     digitalWrite(PIN_LED_GREEN, LOW);
     digitalWrite(PIN_LED_RED, LOW);
 
-    attachInterrupt(digitalPinToInterrupt(PIN_ENC_A), encoderISR, CHANGE);
-    attachInterrupt(digitalPinToInterrupt(PIN_ENC_B), encoderISR, CHANGE);
+    enableEncoderInterrupts();
+    enableButtonWake();
     
-    lcd.begin(LCD_COLS, LCD_ROWS);
-    lcd.clear();
+    lcd.begin(LCD_COLS, LCD_ROWS);  // leaves the panel cleared
+    frame.markCleared();
 
     // Initial message shown until first frame arrives
     buffer.clear();
-    buffer.push("Waiting for data...");
+    pushWaiting();
     mode = UIMode::Telemetry;
     requestedMode = UIMode::Telemetry;
     frameTimeoutMs = FRAME_TIMEOUT_DEFAULT_MS;
     displayTimeoutMs = 0;
     waitAnim = 0;
-    lastAnimMs = millis();
+    tasks.at(TASK_WAIT_ANIM, millis() + WAITING_ANIM_INTERVAL_MS);
+    showWaitingLed();
     render();
-    Serial.println("Starting up");
+    SerialLink::printlnP(PSTR("Starting up"));
+    announceCaps();
 
     // Initialize watchdog state
     haveData = false;
     lastFrameMs = millis();
     heartbeatIntervalMs = FRAME_TIMEOUT_DEFAULT_MS / 3;
-    staleNextBlinkMs = lastFrameMs + STALE_PERIOD_MS;
+
+    // The last screen saved to EEPROM, if any, stands in until data arrives
+    showSnapshot();
 }
 
 void loop() {
+    BENCH_ENTER(BENCH_LOOP);
+    unsigned long loopStart = micros();
     // Read and process incoming serial frames
     processSerial();
     
-    int16_t movement = RotaryEncoder::getMovement();
+    int16_t movement = RotaryEncoder::getAcceleratedMovement(millis());
     
     if (movement != 0) {
         if (mode == UIMode::Telemetry) {
@@ -468,112 +1366,87 @@ void loop() {
             if (buffer.size() > LCD_ROWS) {
                 maxScroll = static_cast<int16_t>(buffer.size() - LCD_ROWS);
             }
-            scroll += movement;
-            if (scroll < 0) scroll = 0;
-            if (scroll > maxScroll) scroll = maxScroll;
+            if (movement > 0 && scroll == maxScroll && history.metrics() > 0) {
+                // A detent past the last line opens the history graphs.
+                showTelemetryView(UIMode::History);
+            } else {
+                scroll += movement;
+                if (scroll < 0) scroll = 0;
+                if (scroll > maxScroll) scroll = maxScroll;
+            }
+            render();
+        } else if (mode == UIMode::History) {
+            // Sparkline pages, then bar pages; back above the first to the lines.
+            int16_t last = static_cast<int16_t>(2 * historyWindows() - 1);
+            if (movement < 0 && historyPage == 0) {
+                showTelemetryView(UIMode::Telemetry);
+            } else {
+                historyPage += movement;
+                if (historyPage < 0) historyPage = 0;
+                if (historyPage > last) historyPage = last;
+            }
             render();
-        } else if (mode == UIMode::Commands || mode == UIMode::CommandsWaiting) {
-            // In waiting state, allow moving cursor once list arrives; still render cursor area.
-            int16_t total = static_cast<int16_t>(commandsCount) + 1; // incl Exit
-            if (total < 1) total = 1;
-            cursorIndex += (movement > 0 ? 1 : -1);
-            if (cursorIndex < 0) cursorIndex = 0;
-            if (cursorIndex >= total) cursorIndex = total - 1;
-            // Keep cursor visible within LCD_ROWS window
-            if (cursorIndex < windowStart) windowStart = cursorIndex;
-            int16_t windowHeight = static_cast<int16_t>(LCD_ROWS);
-            if (cursorIndex > windowStart + (windowHeight - 1)) windowStart = cursorIndex - (windowHeight - 1);
-            if (windowStart < 0) windowStart = 0;
-            int16_t maxWindowStart = (total > windowHeight) ? (total - windowHeight) : 0;
-            if (windowStart > maxWindowStart) windowStart = maxWindowStart;
+        } else if (mode == UIMode::Commands) {
+            // Ignored while waiting: the menu size comes with its first page.
+            moveCursor(movement);
             render();
         }
     }
 
     // Watchdog & waiting animation
     unsigned long now = millis();
-    if (haveData) {
-        if ((now - lastFrameMs) > frameTimeoutMs) {
-            haveData = false;
-            mode = UIMode::Telemetry;
-            requestedMode = UIMode::Telemetry;
-            commandsCount = 0;
-            buffer.clear();
-            buffer.push("Waiting for data...");
-            waitAnim = 0;
-            lastAnimMs = now;
-            greenPulseUntilMs = 0;
-            redPulseUntilMs = 0;
-            digitalWrite(PIN_LED_GREEN, LOW);
-            digitalWrite(PIN_LED_RED, LOW);
-            staleNextBlinkMs = now + STALE_PERIOD_MS;
-            render();
-        }
-    } else {
-        if ((now - lastAnimMs) >= WAITING_ANIM_INTERVAL_MS) {
-            waitAnim = static_cast<uint8_t>((waitAnim + 1) % WAITING_ANIM_FRAMES);
-            lastAnimMs = now;
-            render();
-        }
+    if (tasks.due(TASK_WATCHDOG, now) && haveData) {
+        haveData = false;
+        restoreBaud();  // a restarted daemon opens the port at the default rate
+        mode = UIMode::Telemetry;
+        requestedMode = UIMode::Telemetry;
+        keepTopPage();
+        menuDepth = 0;
+        telemetrySynced = false;
+        snapshotShown = false;
+        buffer.clear();
+        pushWaiting();
+        waitAnim = 0;
+        greenPulseUntilMs = 0;
+        redPulseUntilMs = 0;
+        tasks.cancel(TASK_GREEN_OFF);
+        tasks.cancel(TASK_RED_OFF);
+        tasks.cancel(TASK_STALE_BLINK);
+        tasks.at(TASK_WAIT_ANIM, now + WAITING_ANIM_INTERVAL_MS);
+        digitalWrite(PIN_LED_GREEN, LOW);
+        showWaitingLed();
+        render();
+    }
+    if (tasks.due(TASK_WAIT_ANIM, now) && !haveData) {
+        waitAnim = static_cast<uint8_t>((waitAnim + 1) % WAITING_ANIM_FRAMES);
+        tasks.at(TASK_WAIT_ANIM, now + WAITING_ANIM_INTERVAL_MS);
+        showWaitingLed();
+        render();
     }
 
+    if (tasks.due(TASK_BAUD_PROBATION, now)) {
+        restoreBaud();
+    }
+    if (tasks.due(TASK_MARQUEE, now)) {
+        stepMarquee(now);
+    }
+    if (tasks.due(TASK_SNAPSHOT, now)) {
+        startSnapshot(now);
+    }
+    serviceSnapshot();
+
     updateHeartbeat(now);
+    updateButton(now);
+    serviceDisplay();
+    sendAcks();
 
-    // Button handling: debounce + long/double press
-    uint8_t btn = digitalRead(PIN_BTN);
-    unsigned long nowMs = millis();
-    if (btn != btnPrev && (nowMs - btnLastChangeMs) > BTN_DEBOUNCE_MS) {
-        btnLastChangeMs = nowMs;
-        if (btn == LOW) {
-            // pressed
-            btnPressed = true;
-            btnPressStartMs = nowMs;
-        } else {
-            // released
-            if (btnPressed) {
-                unsigned long held = nowMs - btnPressStartMs;
-                btnPressed = false;
-                if (held >= BTN_LONG_MS) {
-                    // Long press: toggle Commands mode or exit to Telemetry
-                    if (mode == UIMode::Telemetry) {
-                        // Enter commands: request list and show waiting
-                        mode = UIMode::CommandsWaiting;
-                        requestedMode = UIMode::Commands;
-                        cursorIndex = 0;
-                        windowStart = 0;
-                        render();
-                        Serial.println("REQ COMMANDS");
-                    } else {
-                        // Exit to telemetry and reset scroll to top
-                        mode = UIMode::Telemetry;
-                        requestedMode = UIMode::Telemetry;
-                        scroll = 0;
-                        render();
-                    }
-                } else {
-                    // Short press: check for double press
-                    if ((nowMs - lastShortReleaseMs) <= BTN_DOUBLE_GAP_MS) {
-                        // Double press: in Commands mode -> select
-                        if (mode == UIMode::Commands) {
-                            if (cursorIndex == commandsCount) {
-                                // Exit entry selected
-                                mode = UIMode::Telemetry;
-                                requestedMode = UIMode::Telemetry;
-                                scroll = 0;
-                                render();
-                            } else if (cursorIndex >= 0 && cursorIndex < commandsCount) {
-                                Serial.print("SELECT ");
-                                Serial.println(commands[cursorIndex].id);
-                                triggerRedPulse(nowMs, RED_ACK_PULSE_MS);
-                            }
-                        }
-                    }
-                    lastShortReleaseMs = nowMs;
-                }
-            }
-        }
-        btnPrev = btn;
+    noteMax(loopMaxUs, micros() - loopStart);
+    BENCH_EXIT(BENCH_LOOP);  // latency excludes idle sleep
+    if (statsRequested) {
+        reportStats();  // its blocking writes stay out of loop_us
     }
-
-    delay(5);
+    // Sleep until UART RX, an encoder/button edge, an LCD tick (ring space)
+    // or the next millis() tick
+    bool displayWork = renderRequested || (flushPending && LcdDriver::room() > 0);
+    tasks.idle(SerialLink::available() > 0 || RotaryEncoder::pending() || displayWork);
 }
@@ -0,0 +1,349 @@
+#include <Arduino.h>
+#include <unity.h>
+#include "FrameParser.h"
+
+static Panel::Arena arena;
+
+void setUp(void) { arena.reset(); }
+void tearDown(void) {}
+
+static FrameParser::Result feedAll(FrameParser& p, const uint8_t* data, size_t len) {
+  FrameParser::Result last = FrameParser::Result::Pending;
+  for (size_t i = 0; i < len; ++i) {
+    FrameParser::Result r = p.feed(data[i]);
+    if (r != FrameParser::Result::Pending) last = r;
+  }
+  return last;
+}
+
+static FrameParser::Result feedText(FrameParser& p, const char* s) {
+  return feedAll(p, reinterpret_cast<const uint8_t*>(s), strlen(s));
+}
+
+// Wrap payload into STX type len payload crc ETX; returns total length.
+static size_t buildBinary(uint8_t type, const uint8_t* payload, uint16_t len, uint8_t* out) {
+  size_t n = 0;
+  out[n++] = FrameParser::STX;
+  out[n++] = type;
+  out[n++] = static_cast<uint8_t>(len);
+  out[n++] = static_cast<uint8_t>(len >> 8);
+  memcpy(&out[n], payload, len);
+  n += len;
+  uint16_t crc = CRC16_INIT;
+  for (size_t i = 1; i < n; ++i) crc = crc16Update(crc, out[i]);
+  out[n++] = static_cast<uint8_t>(crc >> 8);
+  out[n++] = static_cast<uint8_t>(crc);
+  out[n++] = FrameParser::ETX;
+  return n;
+}
+
+void test_crc_check_value() {
+  const char* s = "123456789";
+  uint16_t crc = CRC16_INIT;
+  for (size_t i = 0; i < 9; ++i) crc = crc16Update(crc, static_cast<uint8_t>(s[i]));
+  TEST_ASSERT_EQUAL_HEX16(0x29B1, crc);
+}
+
+void test_text_telemetry_with_meta() {
+  Panel::Buffer stage(arena);
+  FrameParser p(stage);
+  TEST_ASSERT_EQUAL(FrameParser::Result::Frame,
+                    feedText(p, "META interval=2.000 hello=1\r\nCPU  1%\nGPU  2%\n\n"));
+  TEST_ASSERT_EQUAL(FrameKind::Telemetry, p.kind());
+  TEST_ASSERT_EQUAL_UINT32(2000, p.intervalMs());
+  TEST_ASSERT_TRUE(p.hello());
+  TEST_ASSERT_EQUAL_UINT(2, p.lineCount());
+  TEST_ASSERT_EQUAL_STRING("GPU  2%", p.line(1));
+}
+
+void test_text_meta_only_is_keepalive() {
+  Panel::Buffer stage(arena);
+  FrameParser p(stage);
+  TEST_ASSERT_EQUAL(FrameParser::Result::Frame, feedText(p, "META interval=1.5\n\n"));
+  TEST_ASSERT_EQUAL(FrameKind::KeepAlive, p.kind());
+  TEST_ASSERT_EQUAL_UINT32(1500, p.intervalMs());
+  TEST_ASSERT_EQUAL(FrameParser::Result::Pending, feedText(p, "\n"));
+}
+
+void test_text_delta_and_commands() {
+  Panel::Buffer stage(arena);
+  FrameParser p(stage);
+  feedText(p, "META interval=1.000\nDELTA 5\n3 GPU  9%\n4\n\n");
+  TEST_ASSERT_EQUAL(FrameKind::Delta, p.kind());
+  TEST_ASSERT_EQUAL_UINT(5, p.total());
+  TEST_ASSERT_EQUAL_UINT(2, p.lineCount());  // line 4 is blanked
+  TEST_ASSERT_EQUAL_STRING("GPU  9%", p.line(3));  // staged at its index
+  TEST_ASSERT_EQUAL_STRING("", p.line(0));          // not the DELTA header
+
+  feedText(p, "COMMANDS v1\n1 Shutdown\n\n");
+  TEST_ASSERT_EQUAL(FrameKind::Commands, p.kind());
+  TEST_ASSERT_EQUAL_UINT(1, p.lineCount());
+  TEST_ASSERT_EQUAL_STRING("1 Shutdown", p.line(0));
+}
+
+void test_binary_delta_roundtrip() {
+  const uint8_t payload[] = {0xE8, 0x03, 4, 2, 3, 'a', 'b', 'c', 0, 0};
+  uint8_t frame[32];
+  size_t n = buildBinary(FrameParser::TYPE_DELTA, payload, sizeof(payload), frame);
+  Panel::Buffer stage(arena);
+  FrameParser p(stage);
+  TEST_ASSERT_EQUAL(FrameParser::Result::Frame, feedAll(p, frame, n));
+  TEST_ASSERT_EQUAL(FrameKind::Delta, p.kind());
+  TEST_ASSERT_EQUAL_UINT32(1000, p.intervalMs());
+  TEST_ASSERT_EQUAL_UINT(4, p.total());
+  TEST_ASSERT_EQUAL_UINT(2, p.lineCount());
+  TEST_ASSERT_EQUAL_STRING("abc", p.line(2));
+  TEST_ASSERT_EQUAL_STRING("", p.line(0));
+}
+
+void test_binary_bad_crc_is_rejected() {
+  const uint8_t payload[] = {0xE8, 0x03, 2, 'h', 'i'};
+  uint8_t frame[32];
+  size_t n = buildBinary(FrameParser::TYPE_TELEMETRY, payload, sizeof(payload), frame);
+  frame[6] ^= 0x20;  // flip a data bit
+  Panel::Buffer stage(arena);
+  FrameParser p(stage);
+  TEST_ASSERT_EQUAL(FrameParser::Result::Corrupt, feedAll(p, frame, n));
+  // Parser resynchronises on the next frame.
+  frame[6] ^= 0x20;
+  TEST_ASSERT_EQUAL(FrameParser::Result::Frame, feedAll(p, frame, n));
+  TEST_ASSERT_EQUAL_STRING("hi", p.line(0));
+}
+
+void test_mark_corrupt_drops_frame() {
+  Panel::Buffer stage(arena);
+  FrameParser p(stage);
+  feedText(p, "CPU  1%\n");
+  p.markCorrupt();
+  TEST_ASSERT_EQUAL(FrameParser::Result::Dropped, feedText(p, "GPU  2%\n\n"));
+  TEST_ASSERT_EQUAL(FrameParser::Result::Frame, feedText(p, "CPU  3%\n\n"));
+  TEST_ASSERT_EQUAL_UINT(1, p.lineCount());
+}
+
+void test_frame_without_a_slot_is_not_an_overrun() {
+  Panel::Buffer stage(arena);
+  FrameParser p(stage);
+  while (arena.alloc() != Panel::Arena::kNone) {
+  }
+  TEST_ASSERT_EQUAL(FrameParser::Result::NoSlot,
+                    feedText(p, "META interval=1\nCPU  1%\nGPU  2%\n\n"));
+  arena.reset();
+  TEST_ASSERT_EQUAL(FrameParser::Result::Frame, feedText(p, "META interval=1\nCPU  3%\n\n"));
+  TEST_ASSERT_EQUAL_STRING("CPU  3%", p.line(0));
+}
+
+void test_full_frame_lands_in_back_bank() {
+  Panel::Buffer buf(arena);
+  buf.push("old");
+  FrameParser p(buf);
+  TEST_ASSERT_EQUAL(FrameParser::Result::Frame, feedText(p, "META interval=1\nnew 0\nnew 1\n\n"));
+  char out[Panel::Buffer::kWidth + 1];
+  buf.get(0, out);
+  TEST_ASSERT_EQUAL_STRING("old", out);  // front untouched until swap
+  buf.swap(p.lineCount());
+  TEST_ASSERT_EQUAL_UINT(2, buf.size());
+  buf.get(1, out);
+  TEST_ASSERT_EQUAL_STRING("new 1", out);
+}
+
+void test_long_meta_keys_do_not_reach_slots() {
+  Panel::Buffer buf(arena);
+  FrameParser p(buf);
+  feedText(p, "META interval=0.250 hello=1 seq=12345\nCPU\n\n");
+  TEST_ASSERT_EQUAL_UINT32(250, p.intervalMs());
+  TEST_ASSERT_TRUE(p.hello());
+  TEST_ASSERT_EQUAL_UINT16(12345, p.sequence());
+  TEST_ASSERT_EQUAL_UINT(1, p.lineCount());
+  TEST_ASSERT_EQUAL_STRING("CPU", p.line(0));
+}
+
+void test_meta_keys_are_matched_as_they_stream() {
+  Panel::Buffer buf(arena);
+  FrameParser p(buf);
+  // Unknown keys, keys sharing a prefix and values past the old 27-byte
+  // buffer are skipped without disturbing the keys around them.
+  feedText(p, "META pages=3 intervals=9 layout_version=12345678901234 seq=7 interval=5\n\n");
+  TEST_ASSERT_EQUAL_UINT32(5000, p.intervalMs());
+  TEST_ASSERT_EQUAL_UINT16(7, p.sequence());
+  TEST_ASSERT_FALSE(p.hello());
+  // Decimals past the third are dropped; a bare key counts as present.
+  feedText(p, "META interval=0.0125 hello\n\n");
+  TEST_ASSERT_EQUAL_UINT32(12, p.intervalMs());
+  TEST_ASSERT_TRUE(p.hello());
+  // Zero, malformed and overflowing intervals leave the default or saturate.
+  feedText(p, "META interval=0 seq=x1\n\n");
+  TEST_ASSERT_EQUAL_UINT32(0, p.intervalMs());
+  TEST_ASSERT_EQUAL_UINT16(0, p.sequence());
+  feedText(p, "META interval=99999999999\n\n");
+  TEST_ASSERT_EQUAL_UINT32(0xFFFFFFFFUL, p.intervalMs());
+}
+
+void test_binary_layout_installs_fields() {
+  // Two fields on "CPU  12%" (col 4, width 3) and a line of plain text.
+  const uint8_t payload[] = {0xF4, 0x01, 7, 2, 0, 4, 0x03, 1, 0, 0x13,
+                             8, 'C', 'P', 'U', ' ', ' ', '1', '2', '%', 3, 'x', 'y', 'z'};
+  uint8_t frame[48];
+  size_t n = buildBinary(FrameParser::TYPE_LAYOUT, payload, sizeof(payload), frame);
+  Panel::Buffer stage(arena);
+  FrameParser p(stage);
+  TEST_ASSERT_EQUAL(FrameParser::Result::Frame, feedAll(p, frame, n));
+  TEST_ASSERT_EQUAL(FrameKind::Layout, p.kind());
+  TEST_ASSERT_EQUAL_UINT32(500, p.intervalMs());
+  TEST_ASSERT_EQUAL_UINT(2, p.lineCount());
+  TEST_ASSERT_EQUAL_STRING("CPU  12%", p.line(0));
+  TEST_ASSERT_TRUE(p.layout().matches(7));
+  TEST_ASSERT_FALSE(p.layout().matches(8));
+  const NumericLayout::Entry* e = p.layout().entry(1);
+  TEST_ASSERT_NOT_NULL(e);
+  TEST_ASSERT_EQUAL_UINT8(1, e->line);
+  TEST_ASSERT_EQUAL_UINT8(0x13, e->fmt);
+  TEST_ASSERT_NULL(p.layout().entry(2));
+}
+
+void test_binary_values_are_staged() {
+  const uint8_t payload[] = {0xF4, 0x01, 7, 0, 42, 0, 1, 0xFB, 0xFF};
+  uint8_t frame[32];
+  size_t n = buildBinary(FrameParser::TYPE_VALUES, payload, sizeof(payload), frame);
+  Panel::Buffer stage(arena);
+  FrameParser p(stage);
+  TEST_ASSERT_EQUAL(FrameParser::Result::Frame, feedAll(p, frame, n));
+  TEST_ASSERT_EQUAL(FrameKind::Values, p.kind());
+  TEST_ASSERT_EQUAL_UINT8(7, p.layoutId());
+  TEST_ASSERT_EQUAL_UINT(2, p.valueCount());
+  uint8_t field;
+  int16_t value;
+  p.value(0, &field, &value);
+  TEST_ASSERT_EQUAL_UINT8(0, field);
+  TEST_ASSERT_EQUAL_INT16(42, value);
+  p.value(1, &field, &value);
+  TEST_ASSERT_EQUAL_UINT8(1, field);
+  TEST_ASSERT_EQUAL_INT16(-5, value);
+}
+
+void test_damaged_layout_leaves_no_layout() {
+  const uint8_t good[] = {0xF4, 0x01, 3, 1, 0, 0, 0x03, 1, 'x'};
+  uint8_t frame[32];
+  size_t n = buildBinary(FrameParser::TYPE_LAYOUT, good, sizeof(good), frame);
+  Panel::Buffer stage(arena);
+  FrameParser p(stage);
+  feedAll(p, frame, n);
+  TEST_ASSERT_TRUE(p.layout().matches(3));
+  frame[5] ^= 0x01;  // layout id 3 -> 2, CRC no longer matches
+  TEST_ASSERT_EQUAL(FrameParser::Result::Corrupt, feedAll(p, frame, n));
+  TEST_ASSERT_FALSE(p.layout().matches(3));
+  TEST_ASSERT_FALSE(p.layout().matches(2));
+  // A values record cut short is a layout error too.
+  const uint8_t cut[] = {0xF4, 0x01, 3, 0, 42};
+  n = buildBinary(FrameParser::TYPE_VALUES, cut, sizeof(cut), frame);
+  TEST_ASSERT_EQUAL(FrameParser::Result::Corrupt, feedAll(p, frame, n));
+}
+
+void test_binary_baud_carries_rate_not_interval() {
+  const uint8_t rate[] = {0x40, 0x42, 0x0F, 0x00};  // 1000000
+  uint8_t frame[32];
+  size_t n = buildBinary(FrameParser::TYPE_BAUD, rate, sizeof(rate), frame);
+  Panel::Buffer stage(arena);
+  FrameParser p(stage);
+  TEST_ASSERT_EQUAL(FrameParser::Result::Frame, feedAll(p, frame, n));
+  TEST_ASSERT_EQUAL(FrameKind::Baud, p.kind());
+  TEST_ASSERT_EQUAL_UINT32(1000000, p.baud());
+  TEST_ASSERT_EQUAL_UINT32(0, p.intervalMs());
+  // A rate cut short is a layout error.
+  n = buildBinary(FrameParser::TYPE_BAUD, rate, 3, frame);
+  TEST_ASSERT_EQUAL(FrameParser::Result::Corrupt, feedAll(p, frame, n));
+}
+
+void test_stats_request_and_truncation_count() {
+  Panel::Buffer stage(arena);
+  FrameParser p(stage);
+  TEST_ASSERT_EQUAL(FrameParser::Result::Frame, feedText(p, "REQ STATS\n\n"));
+  TEST_ASSERT_EQUAL(FrameKind::Stats, p.kind());
+  TEST_ASSERT_EQUAL_UINT(0, p.lineCount());
+  TEST_ASSERT_EQUAL_UINT16(0, p.truncated());
+  // Two command lines, 3 and 1 characters past the panel width.
+  TEST_ASSERT_EQUAL(FrameParser::Result::Frame,
+                    feedText(p, "COMMANDS v1\n0123456789abcdefghijXYZ\n0123456789abcdefghij!\n\n"));
+  TEST_ASSERT_EQUAL_STRING("0123456789abcdefghij", p.line(0));
+  TEST_ASSERT_EQUAL_UINT16(4, p.truncated());
+  p.reset();
+  TEST_ASSERT_EQUAL_UINT16(4, p.truncated());
+}
+
+void test_telemetry_lines_continue_past_the_panel() {
+  Panel::Buffer stage(arena);
+  FrameParser p(stage);
+  // 45 characters: 20 on the panel, 20 in the continuation, 5 cut.
+  feedText(p, "META interval=1\nshort\n0123456789abcdefghijKLMNOPQRSTklmnopqrst+++++\n\n");
+  TEST_ASSERT_EQUAL_MEMORY("0123456789abcdefghij", p.line(1), FrameParser::kLineWidth);
+  TEST_ASSERT_EQUAL_UINT16(5, p.truncated());
+  stage.swap(p.lineCount());
+  TEST_ASSERT_EQUAL_STRING("", stage.tail(0));
+  TEST_ASSERT_EQUAL_STRING("KLMNOPQRSTklmnopqrst", stage.tail(1));
+  // Binary delta lines continue the same way.
+  uint8_t payload[27] = {0xE8, 0x03, 2, 0, 22};
+  memcpy(&payload[5], "0123456789abcdefghijXY", 22);
+  uint8_t frame[48];
+  size_t n = buildBinary(FrameParser::TYPE_DELTA, payload, sizeof(payload), frame);
+  TEST_ASSERT_EQUAL(FrameParser::Result::Frame, feedAll(p, frame, n));
+  stage.adoptStaged();
+  TEST_ASSERT_EQUAL_STRING("XY", stage.tail(0));
+}
+
+void test_command_pages_text_and_binary() {
+  Panel::Buffer stage(arena);
+  FrameParser p(stage);
+  TEST_ASSERT_EQUAL(FrameParser::Result::Frame,
+                    feedText(p, "PAGE 3 1 16 300\nrb Reboot\n@4 Disks\n\n"));
+  TEST_ASSERT_EQUAL(FrameKind::Page, p.kind());
+  TEST_ASSERT_EQUAL_UINT(3, p.menu());
+  TEST_ASSERT_EQUAL_UINT(1, p.parent());
+  TEST_ASSERT_EQUAL_UINT16(16, p.pageOffset());
+  TEST_ASSERT_EQUAL_UINT16(300, p.pageTotal());
+  TEST_ASSERT_EQUAL_UINT16(0, p.pageDigest());  // the daemon sent none
+  TEST_ASSERT_EQUAL_UINT(2, p.lineCount());
+  TEST_ASSERT_EQUAL_STRING("@4 Disks", p.line(1));
+  // The digest alone: the menu the device holds is still current.
+  TEST_ASSERT_EQUAL(FrameParser::Result::Frame, feedText(p, "PAGE 0 0 0 3 51966\n\n"));
+  TEST_ASSERT_EQUAL_UINT16(51966, p.pageDigest());
+  TEST_ASSERT_EQUAL_UINT(0, p.lineCount());
+
+  const uint8_t payload[] = {4, 3, 0x08, 0x00, 0x2C, 0x01, 0xFE, 0xCA, 4, 's', 'd', ' ', 'a'};
+  uint8_t frame[32];
+  size_t n = buildBinary(FrameParser::TYPE_PAGE, payload, sizeof(payload), frame);
+  TEST_ASSERT_EQUAL(FrameParser::Result::Frame, feedAll(p, frame, n));
+  TEST_ASSERT_EQUAL(FrameKind::Page, p.kind());
+  TEST_ASSERT_EQUAL_UINT(4, p.menu());
+  TEST_ASSERT_EQUAL_UINT(3, p.parent());
+  TEST_ASSERT_EQUAL_UINT16(8, p.pageOffset());
+  TEST_ASSERT_EQUAL_UINT16(300, p.pageTotal());
+  TEST_ASSERT_EQUAL_UINT16(0xCAFE, p.pageDigest());
+  TEST_ASSERT_EQUAL_STRING("sd a", p.line(0));
+  // A header cut short is a layout error.
+  n = buildBinary(FrameParser::TYPE_PAGE, payload, 7, frame);
+  TEST_ASSERT_EQUAL(FrameParser::Result::Corrupt, feedAll(p, frame, n));
+}
+
+void setup() {
+  UNITY_BEGIN();
+  RUN_TEST(test_crc_check_value);
+  RUN_TEST(test_text_telemetry_with_meta);
+  RUN_TEST(test_text_meta_only_is_keepalive);
+  RUN_TEST(test_text_delta_and_commands);
+  RUN_TEST(test_binary_delta_roundtrip);
+  RUN_TEST(test_binary_bad_crc_is_rejected);
+  RUN_TEST(test_mark_corrupt_drops_frame);
+  RUN_TEST(test_frame_without_a_slot_is_not_an_overrun);
+  RUN_TEST(test_full_frame_lands_in_back_bank);
+  RUN_TEST(test_long_meta_keys_do_not_reach_slots);
+  RUN_TEST(test_binary_layout_installs_fields);
+  RUN_TEST(test_binary_values_are_staged);
+  RUN_TEST(test_damaged_layout_leaves_no_layout);
+  RUN_TEST(test_binary_baud_carries_rate_not_interval);
+  RUN_TEST(test_stats_request_and_truncation_count);
+  RUN_TEST(test_command_pages_text_and_binary);
+  RUN_TEST(test_telemetry_lines_continue_past_the_panel);
+  RUN_TEST(test_meta_keys_are_matched_as_they_stream);
+  UNITY_END();
+}
+
+void loop() {}
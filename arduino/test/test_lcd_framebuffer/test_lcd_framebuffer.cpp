@@ -0,0 +1,113 @@
+#include <Arduino.h>
+#include <unity.h>
+#include "LcdFramebuffer.h"
+
+// Records bus traffic instead of driving a panel.
+struct FakeDisplay {
+  uint8_t cursorCalls = 0;
+  uint8_t dataWrites = 0;
+  void setCursor(uint8_t, uint8_t) { ++cursorCalls; }
+  size_t write(uint8_t) {
+    ++dataWrites;
+    return 1;
+  }
+};
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_first_flush_after_invalidate_writes_everything() {
+  LcdFramebuffer fb;
+  FakeDisplay lcd;
+  FlushStats s = fb.flush(lcd);
+  TEST_ASSERT_EQUAL_UINT(LcdFramebuffer::kCols * LcdFramebuffer::kRows, s.cells);
+  TEST_ASSERT_EQUAL_UINT(LcdFramebuffer::kRows, s.commands);
+  TEST_ASSERT_EQUAL_UINT(lcd.dataWrites, s.cells);
+}
+
+void test_unchanged_frame_writes_nothing() {
+  LcdFramebuffer fb;
+  FakeDisplay lcd;
+  fb.markCleared();
+  fb.print(0, 0, "CPU  12%", LcdFramebuffer::kCols);
+  fb.flush(lcd);
+  fb.clear();
+  fb.print(0, 0, "CPU  12%", LcdFramebuffer::kCols);
+  FlushStats s = fb.flush(lcd);
+  TEST_ASSERT_EQUAL_UINT(0, s.busWrites());
+}
+
+void test_single_digit_change_costs_one_cursor_and_one_cell() {
+  LcdFramebuffer fb;
+  FakeDisplay lcd;
+  fb.markCleared();
+  fb.print(0, 1, "CPU  12%", LcdFramebuffer::kCols);
+  fb.flush(lcd);
+  fb.print(0, 1, "CPU  13%", LcdFramebuffer::kCols);
+  FlushStats s = fb.flush(lcd);
+  TEST_ASSERT_EQUAL_UINT(1, s.cells);
+  TEST_ASSERT_EQUAL_UINT(1, s.commands);
+}
+
+void test_print_pads_and_truncates() {
+  LcdFramebuffer fb;
+  fb.markCleared();
+  fb.print(0, 0, "XXXXXXXXXXXXXXXXXXXXYY", LcdFramebuffer::kCols);
+  fb.print(2, 0, "ab", 4);
+  TEST_ASSERT_EQUAL_CHAR('X', fb.cell(1, 0));
+  TEST_ASSERT_EQUAL_CHAR('b', fb.cell(3, 0));
+  TEST_ASSERT_EQUAL_CHAR(' ', fb.cell(5, 0));
+  TEST_ASSERT_EQUAL_CHAR('X', fb.cell(6, 0));
+  TEST_ASSERT_EQUAL_CHAR('X', fb.cell(LcdFramebuffer::kCols - 1, 0));
+  // The flash variant pads and cuts the same way.
+  fb.print(0, 1, "XXXXXXXX", 8);
+  fb.printP(0, 1, PSTR("Exit"), 6);
+  fb.printP(6, 1, PSTR("Back"), 1);
+  TEST_ASSERT_EQUAL_CHAR('t', fb.cell(3, 1));
+  TEST_ASSERT_EQUAL_CHAR(' ', fb.cell(5, 1));
+  TEST_ASSERT_EQUAL_CHAR('B', fb.cell(6, 1));
+  TEST_ASSERT_EQUAL_CHAR('X', fb.cell(7, 1));
+}
+
+void test_cells_left_undrawn_are_blanked() {
+  LcdFramebuffer fb;
+  FakeDisplay lcd;
+  fb.markCleared();
+  fb.print(0, 0, "abc", 3);
+  fb.flush(lcd);
+  fb.clear();
+  fb.putChar(0, 0, 'a');
+  TEST_ASSERT_EQUAL_CHAR(' ', fb.cell(1, 0));
+  FlushStats s = fb.flush(lcd);
+  TEST_ASSERT_EQUAL_UINT(2, s.cells);  // "bc" blanked, "a" left alone
+  TEST_ASSERT_EQUAL_UINT(1, s.commands);
+}
+
+void test_budget_splits_flush_and_resumes() {
+  LcdFramebuffer fb;
+  FakeDisplay lcd;
+  fb.markCleared();
+  fb.print(0, 0, "abcdef", 6);
+  fb.print(0, 2, "xyz", 3);
+  FlushStats first = fb.flush(lcd, 5);
+  TEST_ASSERT_FALSE(first.complete);
+  TEST_ASSERT_EQUAL_UINT(5, first.busWrites());
+  FlushStats rest = fb.flush(lcd);
+  TEST_ASSERT_TRUE(rest.complete);
+  TEST_ASSERT_EQUAL_UINT(9, first.cells + rest.cells);
+  // Resuming mid-row costs one extra cursor command.
+  TEST_ASSERT_EQUAL_UINT(3, first.commands + rest.commands);
+}
+
+void setup() {
+  UNITY_BEGIN();
+  RUN_TEST(test_first_flush_after_invalidate_writes_everything);
+  RUN_TEST(test_unchanged_frame_writes_nothing);
+  RUN_TEST(test_single_digit_change_costs_one_cursor_and_one_cell);
+  RUN_TEST(test_print_pads_and_truncates);
+  RUN_TEST(test_cells_left_undrawn_are_blanked);
+  RUN_TEST(test_budget_splits_flush_and_resumes);
+  UNITY_END();
+}
+
+void loop() {}
@@ -0,0 +1,111 @@
+#include <Arduino.h>
+#include <unity.h>
+#include "LcdGlyphs.h"
+#include "MetricHistory.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// CPU load (history), RAM (none), temperature (history) in one line.
+static NumericLayout layoutOf() {
+  NumericLayout layout;
+  layout.add(0, 4, 0x43);
+  layout.add(0, 9, 0x03);
+  layout.add(0, 14, 0x43);
+  layout.activate(5);
+  return layout;
+}
+
+void test_tracks_flagged_fields_only() {
+  MetricHistory h;
+  h.track(layoutOf(), 5);
+  TEST_ASSERT_EQUAL_UINT8(2, h.metrics());
+  TEST_ASSERT_EQUAL_UINT8(0, h.field(0));
+  TEST_ASSERT_EQUAL_UINT8(2, h.field(1));
+  TEST_ASSERT_EQUAL_UINT8(0, h.size());
+}
+
+void test_levels_quantise_and_clamp() {
+  TEST_ASSERT_EQUAL_UINT8(0, MetricHistory::levelOf(-5));
+  TEST_ASSERT_EQUAL_UINT8(0, MetricHistory::levelOf(3));
+  TEST_ASSERT_EQUAL_UINT8(8, MetricHistory::levelOf(50));
+  TEST_ASSERT_EQUAL_UINT8(15, MetricHistory::levelOf(100));
+  TEST_ASSERT_EQUAL_UINT8(15, MetricHistory::levelOf(250));
+}
+
+void test_ring_keeps_newest_depth_samples() {
+  MetricHistory h;
+  h.track(layoutOf(), 5);
+  for (int16_t i = 0; i < MetricHistory::kDepth + 4; ++i) {
+    h.record(0, static_cast<int16_t>(i * 5));
+    h.record(1, 100);
+    h.commit();
+  }
+  TEST_ASSERT_EQUAL_UINT8(MetricHistory::kDepth, h.size());
+  TEST_ASSERT_EQUAL_UINT8(MetricHistory::levelOf(95), h.level(0, 0));
+  TEST_ASSERT_EQUAL_UINT8(MetricHistory::levelOf(90), h.level(0, 1));
+  TEST_ASSERT_EQUAL_UINT8(MetricHistory::levelOf(20), h.level(0, MetricHistory::kDepth - 1));
+  TEST_ASSERT_EQUAL_UINT8(15, h.level(1, 3));  // neighbouring nibbles untouched
+}
+
+void test_same_layout_keeps_samples_new_one_resets() {
+  MetricHistory h;
+  NumericLayout layout = layoutOf();
+  h.track(layout, 5);
+  h.record(0, 50);
+  h.record(1, 50);
+  h.commit();
+  h.track(layout, 5);
+  TEST_ASSERT_EQUAL_UINT8(1, h.size());
+  h.track(layout, 6);
+  TEST_ASSERT_EQUAL_UINT8(0, h.size());
+}
+
+void test_glyph_rows() {
+  TEST_ASSERT_EQUAL_HEX8(0x00, LcdGlyphs::row(GlyphSet::Spark, 0, 6));
+  TEST_ASSERT_EQUAL_HEX8(0x1F, LcdGlyphs::row(GlyphSet::Spark, 0, 7));
+  TEST_ASSERT_EQUAL_HEX8(0x1F, LcdGlyphs::row(GlyphSet::Spark, 7, 0));
+  TEST_ASSERT_EQUAL_HEX8(0x10, LcdGlyphs::row(GlyphSet::Bar, 0, 3));
+  TEST_ASSERT_EQUAL_HEX8(0x1F, LcdGlyphs::row(GlyphSet::Bar, 4, 3));
+  TEST_ASSERT_EQUAL_HEX8(0x00, LcdGlyphs::row(GlyphSet::Bar, 4, 0));
+  TEST_ASSERT_EQUAL_HEX8(0x00, LcdGlyphs::row(GlyphSet::Bar, 6, 3));
+  TEST_ASSERT_EQUAL_INT(8, LcdGlyphs::spark(0));
+  TEST_ASSERT_EQUAL_INT(12, LcdGlyphs::bar(5));
+}
+
+struct FakeLcd {
+  int addresses = 0;
+  int writes = 0;
+  void setCgramAddress(uint8_t) { ++addresses; }
+  void write(uint8_t) { ++writes; }
+};
+
+void test_glyph_upload_resumes_and_is_cached() {
+  LcdGlyphs g;
+  FakeLcd lcd;
+  TEST_ASSERT_TRUE(g.ready());
+  g.want(GlyphSet::Spark);
+  TEST_ASSERT_EQUAL_UINT8(31, g.upload(lcd, 31));
+  TEST_ASSERT_FALSE(g.ready());
+  while (!g.ready()) g.upload(lcd, 31);
+  TEST_ASSERT_EQUAL_INT(LcdGlyphs::kBytes, lcd.writes);
+  TEST_ASSERT_EQUAL_INT(3, lcd.addresses);
+  g.want(GlyphSet::Spark);
+  TEST_ASSERT_EQUAL_UINT8(0, g.upload(lcd, 31));
+  g.want(GlyphSet::Bar);
+  TEST_ASSERT_FALSE(g.ready());
+  TEST_ASSERT_EQUAL_UINT8(0, g.upload(lcd, 1));  // no room for address plus a byte
+}
+
+void setup() {
+  UNITY_BEGIN();
+  RUN_TEST(test_tracks_flagged_fields_only);
+  RUN_TEST(test_levels_quantise_and_clamp);
+  RUN_TEST(test_ring_keeps_newest_depth_samples);
+  RUN_TEST(test_same_layout_keeps_samples_new_one_resets);
+  RUN_TEST(test_glyph_rows);
+  RUN_TEST(test_glyph_upload_resumes_and_is_cached);
+  UNITY_END();
+}
+
+void loop() {}
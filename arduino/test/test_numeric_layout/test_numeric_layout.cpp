@@ -0,0 +1,93 @@
+#include <Arduino.h>
+#include <unity.h>
+#include "NumericLayout.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static const char* fmt(int16_t value, uint8_t format) {
+  static char out[16];
+  memset(out, 0, sizeof(out));
+  NumericLayout::format(value, format, out);
+  return out;
+}
+
+void test_format_right_aligns_integers() {
+  TEST_ASSERT_EQUAL_STRING("  7", fmt(7, 0x03));
+  TEST_ASSERT_EQUAL_STRING("100", fmt(100, 0x03));
+  TEST_ASSERT_EQUAL_STRING(" -4", fmt(-4, 0x03));
+  TEST_ASSERT_EQUAL_STRING("    0", fmt(0, 0x05));
+}
+
+void test_format_implied_decimals() {
+  TEST_ASSERT_EQUAL_STRING("12.3", fmt(123, 0x14));
+  TEST_ASSERT_EQUAL_STRING(" 0.5", fmt(5, 0x14));
+  TEST_ASSERT_EQUAL_STRING("-0.05", fmt(-5, 0x25));
+  TEST_ASSERT_EQUAL_STRING("-327.68", fmt(-32768, 0x27));
+}
+
+void test_format_overflow_fills_hashes() {
+  TEST_ASSERT_EQUAL_STRING("###", fmt(1000, 0x03));
+  TEST_ASSERT_EQUAL_STRING("##", fmt(-10, 0x02));
+}
+
+void test_patch_replaces_cells_in_place() {
+  char line[21] = "CPU  12%  40C";
+  NumericLayout::Entry e = {0, 4, 0x03};
+  NumericLayout::patch(line, 20, e, 7);
+  TEST_ASSERT_EQUAL_STRING("CPU   7%  40C", line);
+}
+
+void test_patch_pads_short_line_and_skips_overhang() {
+  char line[21] = "T";
+  NumericLayout::Entry e = {0, 4, 0x03};
+  NumericLayout::patch(line, 20, e, 55);
+  TEST_ASSERT_EQUAL_STRING("T    55", line);
+  NumericLayout::Entry edge = {0, 18, 0x04};
+  NumericLayout::patch(line, 20, edge, 1234);
+  TEST_ASSERT_EQUAL_STRING("T    55", line);
+}
+
+void test_layout_entries_and_ids() {
+  NumericLayout layout;
+  TEST_ASSERT_FALSE(layout.matches(NumericLayout::kNone));
+  layout.add(0, 4, 0x03);
+  layout.add(1, 0, 0x00);  // zero width: placeholder, never patched
+  layout.add(1, 6, 0x13);
+  TEST_ASSERT_FALSE(layout.matches(5));
+  layout.activate(5);
+  TEST_ASSERT_TRUE(layout.matches(5));
+  TEST_ASSERT_NOT_NULL(layout.entry(0));
+  TEST_ASSERT_NULL(layout.entry(1));
+  TEST_ASSERT_EQUAL_UINT8(6, layout.entry(2)->col);
+  TEST_ASSERT_NULL(layout.entry(3));
+  layout.clear();
+  TEST_ASSERT_FALSE(layout.matches(5));
+  TEST_ASSERT_NULL(layout.entry(0));
+}
+
+void test_parse_reads_back_printed_value() {
+  NumericLayout::Entry load = {0, 4, 0x03};
+  NumericLayout::Entry temp = {0, 8, 0x45};  // one decimal, history flag
+  TEST_ASSERT_TRUE(NumericLayout::historyOf(temp.fmt));
+  TEST_ASSERT_EQUAL_UINT8(5, NumericLayout::widthOf(temp.fmt));
+  TEST_ASSERT_EQUAL_INT16(42, NumericLayout::parse("CPU  42% 40.5C", load));
+  TEST_ASSERT_EQUAL_INT16(40, NumericLayout::parse("CPU  42% 40.5C", temp));
+  TEST_ASSERT_EQUAL_INT16(-4, NumericLayout::parse("CPU  -4%", load));
+  TEST_ASSERT_EQUAL_INT16(0, NumericLayout::parse("CPU ###%", load));
+  TEST_ASSERT_EQUAL_INT16(0, NumericLayout::parse("CPU", load));
+}
+
+void setup() {
+  UNITY_BEGIN();
+  RUN_TEST(test_format_right_aligns_integers);
+  RUN_TEST(test_format_implied_decimals);
+  RUN_TEST(test_format_overflow_fills_hashes);
+  RUN_TEST(test_patch_replaces_cells_in_place);
+  RUN_TEST(test_patch_pads_short_line_and_skips_overhang);
+  RUN_TEST(test_layout_entries_and_ids);
+  RUN_TEST(test_parse_reads_back_printed_value);
+  UNITY_END();
+}
+
+void loop() {}
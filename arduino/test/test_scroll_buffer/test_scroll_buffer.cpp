@@ -2,11 +2,17 @@
 #include <unity.h>
 #include "ScrollBuffer.h"
 
-void setUp(void) {}
+// The 20x4 default; test_scroll_buffer_<panel> cover the other geometries.
+using Buffer = ScrollBuffer<20, 32>;
+using Arena = Buffer::Arena;
+
+static Arena arena;
+
+void setUp(void) { arena.reset(); }
 void tearDown(void) {}
 
 void test_push_and_size() {
-  ScrollBuffer b;
+  Buffer b(arena);
   TEST_ASSERT_EQUAL_UINT(0, b.size());
   b.push("hello");
   b.push("world");
@@ -14,33 +20,216 @@ void test_push_and_size() {
 }
 
 void test_truncation_and_get() {
-  ScrollBuffer b;
+  Buffer b(arena);
   b.push("12345678901234567890OK"); // > 20
-  char out[ScrollBuffer::kWidth + 1];
+  char out[Buffer::kWidth + 1];
   b.get(0, out);
   TEST_ASSERT_EQUAL_UINT(20, strlen(out));
   TEST_ASSERT_EQUAL_CHAR('0', out[19]);
 }
 
 void test_ring_wrap() {
-  ScrollBuffer b;
-  for (int i = 0; i < (int)ScrollBuffer::kCapacity + 5; ++i) {
+  Buffer b(arena);
+  for (int i = 0; i < (int)Buffer::kCapacity + 5; ++i) {
     char msg[21];
     snprintf(msg, sizeof(msg), "L%02d", i);
     b.push(msg);
   }
-  TEST_ASSERT_EQUAL_UINT(ScrollBuffer::kCapacity, b.size());
-  char out[ScrollBuffer::kWidth + 1];
+  TEST_ASSERT_EQUAL_UINT(Buffer::kCapacity, b.size());
+  char out[Buffer::kWidth + 1];
   b.get(0, out);
   // After overflow, first should be L05
   TEST_ASSERT_EQUAL_STRING("L05", out);
 }
 
+void test_set_patches_line_in_place() {
+  Buffer b(arena);
+  b.push("a");
+  b.push("b");
+  b.push("c");
+  b.set(1, "B");
+  b.set(7, "ignored");
+  char out[Buffer::kWidth + 1];
+  b.get(1, out);
+  TEST_ASSERT_EQUAL_STRING("B", out);
+  TEST_ASSERT_EQUAL_UINT(3, b.size());
+}
+
+void test_resize_after_wrap_keeps_oldest() {
+  Buffer b(arena);
+  for (int i = 0; i < (int)Buffer::kCapacity + 3; ++i) {
+    char msg[21];
+    snprintf(msg, sizeof(msg), "L%02d", i);
+    b.push(msg);
+  }
+  b.resize(2);
+  TEST_ASSERT_EQUAL_UINT(2, b.size());
+  char out[Buffer::kWidth + 1];
+  b.get(0, out);
+  TEST_ASSERT_EQUAL_STRING("L03", out);
+  b.resize(4);
+  b.get(1, out);
+  TEST_ASSERT_EQUAL_STRING("L04", out);
+  b.get(3, out);
+  TEST_ASSERT_EQUAL_STRING("", out);
+}
+
+void test_swap_shows_back_bank() {
+  Buffer b(arena);
+  b.push("front");
+  strcpy(b.backSlot(0), "back 0");
+  strcpy(b.backSlot(1), "back 1");
+  TEST_ASSERT_NULL(b.backSlot(Buffer::kCapacity));
+  b.swap(2);
+  TEST_ASSERT_EQUAL_UINT(2, b.size());
+  char out[Buffer::kWidth + 1];
+  b.get(0, out);
+  TEST_ASSERT_EQUAL_STRING("back 0", out);
+  b.push("next");
+  b.get(2, out);
+  TEST_ASSERT_EQUAL_STRING("next", out);
+}
+
+void test_arena_exhaustion_and_release() {
+  Arena a;
+  uint8_t slots[Arena::kSlots];
+  for (uint8_t i = 0; i < Arena::kSlots; ++i) {
+    slots[i] = a.alloc();
+    TEST_ASSERT_NOT_EQUAL(Arena::kNone, slots[i]);
+  }
+  TEST_ASSERT_EQUAL_UINT8(Arena::kNone, a.alloc());
+  a.release(slots[17]);
+  a.release(slots[17]);  // double release is ignored
+  TEST_ASSERT_EQUAL_UINT8(1, a.available());
+  TEST_ASSERT_EQUAL_UINT8(slots[17], a.alloc());
+}
+
+void test_full_ring_still_stages_guaranteed_lines() {
+  Buffer b(arena);
+  for (size_t i = 0; i < Buffer::kCapacity; ++i) b.push("line");
+  for (size_t i = 0; i < Buffer::kStageGuarantee; ++i) {
+    TEST_ASSERT_NOT_NULL(b.backSlot(i));
+  }
+  TEST_ASSERT_NULL(b.backSlot(Buffer::kStageGuarantee));
+  b.discardBack();
+  TEST_ASSERT_EQUAL_UINT8(Buffer::kStageGuarantee, arena.available());
+}
+
+void test_blank_lines_take_no_slots() {
+  Buffer b(arena);
+  b.push("a");
+  b.resize(Buffer::kCapacity);
+  TEST_ASSERT_EQUAL_UINT(Buffer::kCapacity, b.size());
+  TEST_ASSERT_EQUAL_UINT8(Arena::kSlots - 1, arena.available());
+  b.set(20, "x");
+  TEST_ASSERT_EQUAL_UINT8(Arena::kSlots - 2, arena.available());
+  b.resize(1);
+  TEST_ASSERT_EQUAL_UINT8(Arena::kSlots - 1, arena.available());
+}
+
+void test_adopt_back_moves_slot_without_copy() {
+  Buffer b(arena);
+  b.push("old 0");
+  b.push("old 1");
+  strcpy(b.backSlot(0), "new 1");
+  b.adoptBack(1, 0);
+  char out[Buffer::kWidth + 1];
+  b.get(1, out);
+  TEST_ASSERT_EQUAL_STRING("new 1", out);
+  TEST_ASSERT_EQUAL_STRING("old 1", b.backLine(0));  // displaced line waits in staging
+  b.discardBack();
+  TEST_ASSERT_EQUAL_UINT8(Arena::kSlots - 2, arena.available());
+}
+
+void test_take_back_hands_slot_to_caller() {
+  Buffer b(arena);
+  strcpy(b.backSlot(0), "7 Reboot");
+  uint8_t slot = b.takeBack(0);
+  b.discardBack();
+  TEST_ASSERT_EQUAL_STRING("7 Reboot", arena.line(slot));
+  b.clear();
+  TEST_ASSERT_EQUAL_UINT8(Arena::kSlots - 1, arena.available());
+  arena.release(slot);
+  TEST_ASSERT_EQUAL_UINT8(Arena::kSlots, arena.available());
+}
+
+void test_non_power_of_two_capacity_wraps() {
+  using Odd = ScrollBuffer<20, 12>;
+  static Odd::Arena oddArena;
+  Odd b(oddArena);
+  for (int i = 0; i < (int)Odd::kCapacity * 2 + 5; ++i) {
+    char msg[21];
+    snprintf(msg, sizeof(msg), "L%02d", i);
+    b.push(msg);
+  }
+  TEST_ASSERT_EQUAL_UINT(Odd::kCapacity, b.size());
+  char out[Odd::kWidth + 1];
+  b.get(0, out);
+  TEST_ASSERT_EQUAL_STRING("L17", out);
+  b.get(Odd::kCapacity - 1, out);
+  TEST_ASSERT_EQUAL_STRING("L28", out);
+  b.resize(3);
+  b.resize(5);
+  b.get(2, out);
+  TEST_ASSERT_EQUAL_STRING("L19", out);
+  b.get(3, out);
+  TEST_ASSERT_EQUAL_STRING("", out);
+}
+
+void test_long_line_tail_follows_its_slot() {
+  Buffer b(arena);
+  b.resize(2);
+  strcpy(b.backSlot(0), "12345678901234567890");
+  strcpy(b.backTail(0, 0), "tail");
+  // No tail when it would eat into the slots the frame still needs.
+  b.backSlot(1);
+  TEST_ASSERT_NULL(b.backTail(1, arena.available()));
+  uint8_t before = arena.available();
+  b.adoptBack(1, 0);
+  TEST_ASSERT_EQUAL_STRING("tail", b.tail(1));
+  TEST_ASSERT_EQUAL_STRING("", b.tail(0));
+  char out[Buffer::kWidth + 1];
+  b.get(1, out);  // the link in the slot's last byte stays out of the text
+  TEST_ASSERT_EQUAL_STRING("12345678901234567890", out);
+  // Rewriting the line, or releasing it, frees the continuation too.
+  b.set(1, "short");
+  TEST_ASSERT_EQUAL_STRING("", b.tail(1));
+  TEST_ASSERT_EQUAL_UINT(before + 1, arena.available());
+  b.clear();
+  b.discardBack();
+  TEST_ASSERT_EQUAL_UINT(Arena::kSlots, arena.available());
+}
+
+void test_fit_tails_keeps_the_stage_guarantee() {
+  Buffer b(arena);
+  const size_t n = Buffer::kCapacity - 2;
+  for (size_t i = 0; i < n; ++i) strcpy(b.backSlot(i), "12345678901234567890");
+  for (size_t i = 0; i < 4; ++i) strcpy(b.backTail(i, 0), "tail");
+  b.swap(n);
+  // 30 lines and 4 tails: the two newest tails go, 8 chars in all.
+  TEST_ASSERT_EQUAL_UINT(8, b.fitTails());
+  TEST_ASSERT_EQUAL_UINT(Buffer::kStageGuarantee, arena.available());
+  TEST_ASSERT_EQUAL_STRING("tail", b.tail(1));
+  TEST_ASSERT_EQUAL_STRING("", b.tail(2));
+  TEST_ASSERT_EQUAL_UINT(0, b.fitTails());
+}
+
 void setup() {
   UNITY_BEGIN();
   RUN_TEST(test_push_and_size);
   RUN_TEST(test_truncation_and_get);
   RUN_TEST(test_ring_wrap);
+  RUN_TEST(test_set_patches_line_in_place);
+  RUN_TEST(test_resize_after_wrap_keeps_oldest);
+  RUN_TEST(test_swap_shows_back_bank);
+  RUN_TEST(test_arena_exhaustion_and_release);
+  RUN_TEST(test_full_ring_still_stages_guaranteed_lines);
+  RUN_TEST(test_blank_lines_take_no_slots);
+  RUN_TEST(test_adopt_back_moves_slot_without_copy);
+  RUN_TEST(test_take_back_hands_slot_to_caller);
+  RUN_TEST(test_non_power_of_two_capacity_wraps);
+  RUN_TEST(test_long_line_tail_follows_its_slot);
+  RUN_TEST(test_fit_tails_keeps_the_stage_guarantee);
   UNITY_END();
 }
 
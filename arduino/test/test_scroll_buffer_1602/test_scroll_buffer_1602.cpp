@@ -0,0 +1,63 @@
+// Built by env:nano_1602 (-DLCDMON_PANEL_1602).
+#include <Arduino.h>
+#include <unity.h>
+#include "DisplayGeometry.h"
+#include "LcdFramebuffer.h"
+
+static_assert(Panel::kCols == 16 && Panel::kRows == 2, "env must select the 16x2 panel");
+
+static Panel::Arena arena;
+
+void setUp(void) { arena.reset(); }
+void tearDown(void) {}
+
+void test_lines_truncate_at_panel_width() {
+  Panel::Buffer b(arena);
+  b.push("1234567890123456OK");
+  char out[Panel::Buffer::kWidth + 1];
+  b.get(0, out);
+  TEST_ASSERT_EQUAL_STRING("1234567890123456", out);
+}
+
+void test_ring_wraps_at_capacity() {
+  Panel::Buffer b(arena);
+  for (int i = 0; i < (int)Panel::kLines + 7; ++i) {
+    char msg[17];
+    snprintf(msg, sizeof(msg), "L%02d", i);
+    b.push(msg);
+  }
+  TEST_ASSERT_EQUAL_UINT(Panel::kLines, b.size());
+  char out[Panel::Buffer::kWidth + 1];
+  b.get(0, out);
+  TEST_ASSERT_EQUAL_STRING("L07", out);
+}
+
+void test_full_ring_still_stages_guaranteed_lines() {
+  Panel::Buffer b(arena);
+  for (size_t i = 0; i < Panel::kLines; ++i) b.push("line");
+  TEST_ASSERT_EQUAL_UINT(8, Panel::Buffer::kStageGuarantee);
+  for (size_t i = 0; i < Panel::Buffer::kStageGuarantee; ++i) {
+    TEST_ASSERT_NOT_NULL(b.backSlot(i));
+  }
+  TEST_ASSERT_NULL(b.backSlot(Panel::Buffer::kStageGuarantee));
+}
+
+void test_framebuffer_matches_panel() {
+  LcdFramebuffer fb;
+  TEST_ASSERT_EQUAL_UINT8(16, LcdFramebuffer::kCols);
+  TEST_ASSERT_EQUAL_UINT8(2, LcdFramebuffer::kRows);
+  fb.print(10, 1, "overflowing", 20);
+  TEST_ASSERT_EQUAL_CHAR('o', fb.cell(10, 1));
+  TEST_ASSERT_EQUAL_CHAR('l', fb.cell(15, 1));
+}
+
+void setup() {
+  UNITY_BEGIN();
+  RUN_TEST(test_lines_truncate_at_panel_width);
+  RUN_TEST(test_ring_wraps_at_capacity);
+  RUN_TEST(test_full_ring_still_stages_guaranteed_lines);
+  RUN_TEST(test_framebuffer_matches_panel);
+  UNITY_END();
+}
+
+void loop() {}
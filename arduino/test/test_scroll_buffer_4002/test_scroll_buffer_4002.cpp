@@ -0,0 +1,66 @@
+// Built by env:nano_4002 (-DLCDMON_PANEL_4002).
+#include <Arduino.h>
+#include <unity.h>
+#include "DisplayGeometry.h"
+#include "LcdFramebuffer.h"
+
+static_assert(Panel::kCols == 40 && Panel::kRows == 2, "env must select the 40x2 panel");
+
+static Panel::Arena arena;
+
+void setUp(void) { arena.reset(); }
+void tearDown(void) {}
+
+void test_lines_truncate_at_panel_width() {
+  Panel::Buffer b(arena);
+  b.push("1234567890123456789012345678901234567890OK");
+  char out[Panel::Buffer::kWidth + 1];
+  b.get(0, out);
+  TEST_ASSERT_EQUAL_UINT(40, strlen(out));
+  TEST_ASSERT_EQUAL_CHAR('0', out[39]);
+}
+
+void test_ring_wraps_at_capacity() {
+  Panel::Buffer b(arena);
+  for (int i = 0; i < (int)Panel::kLines + 3; ++i) {
+    char msg[41];
+    snprintf(msg, sizeof(msg), "L%02d", i);
+    b.push(msg);
+  }
+  TEST_ASSERT_EQUAL_UINT(Panel::kLines, b.size());
+  char out[Panel::Buffer::kWidth + 1];
+  b.get(0, out);
+  TEST_ASSERT_EQUAL_STRING("L03", out);
+  b.get(Panel::kLines - 1, out);
+  TEST_ASSERT_EQUAL_STRING("L18", out);
+}
+
+void test_full_ring_still_stages_guaranteed_lines() {
+  Panel::Buffer b(arena);
+  for (size_t i = 0; i < Panel::kLines; ++i) b.push("line");
+  TEST_ASSERT_EQUAL_UINT(4, Panel::Buffer::kStageGuarantee);
+  for (size_t i = 0; i < Panel::Buffer::kStageGuarantee; ++i) {
+    TEST_ASSERT_NOT_NULL(b.backSlot(i));
+  }
+  TEST_ASSERT_NULL(b.backSlot(Panel::Buffer::kStageGuarantee));
+}
+
+void test_framebuffer_matches_panel() {
+  LcdFramebuffer fb;
+  TEST_ASSERT_EQUAL_UINT8(40, LcdFramebuffer::kCols);
+  TEST_ASSERT_EQUAL_UINT8(2, LcdFramebuffer::kRows);
+  fb.print(30, 1, "wide panel tail", 20);
+  TEST_ASSERT_EQUAL_CHAR('w', fb.cell(30, 1));
+  TEST_ASSERT_EQUAL_CHAR('l', fb.cell(39, 1));
+}
+
+void setup() {
+  UNITY_BEGIN();
+  RUN_TEST(test_lines_truncate_at_panel_width);
+  RUN_TEST(test_ring_wraps_at_capacity);
+  RUN_TEST(test_full_ring_still_stages_guaranteed_lines);
+  RUN_TEST(test_framebuffer_matches_panel);
+  UNITY_END();
+}
+
+void loop() {}
@@ -0,0 +1,736 @@
+// Runs the real sketch on the native simulator (env:native only).
+#include <Crc16.h>
+#include <DisplayGeometry.h>
+#include <LcdDriver.h>
+#include <ScreenSnapshot.h>
+#include <SerialLink.h>
+#include <Sim.h>
+#include <unity.h>
+
+#include <string>
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static std::string lcdRow(uint8_t row) {
+  char text[Hd44780::kDdramSize + 1];
+  sim::lcd().row(row, text);
+  return text;
+}
+
+// Device output minus the flow-control "ACK <n>" lines.
+static std::string takeReplies() {
+  std::string tx = sim::takeTx();
+  std::string out;
+  size_t pos = 0;
+  while (pos < tx.size()) {
+    size_t end = tx.find('\n', pos);
+    end = (end == std::string::npos) ? tx.size() : end + 1;
+    if (tx.compare(pos, 4, "ACK ") != 0) out += tx.substr(pos, end - pos);
+    pos = end;
+  }
+  return out;
+}
+
+static void assertRowStartsWith(const char* prefix, uint8_t row) {
+  std::string text = lcdRow(row);
+  TEST_ASSERT_EQUAL_STRING(prefix, text.substr(0, strlen(prefix)).c_str());
+}
+
+void test_boot_announces_caps_and_waits() {
+  setup();
+  sim::drainLcd();
+  std::string tx = takeReplies();
+  TEST_ASSERT_NOT_EQUAL(std::string::npos, tx.find("CAPS delta bin num stats menuhash lines=32 "
+                                                   "stage=8 cols=20 fields=12 credits=2 "
+                                                   "baud=1000000 wide=40\r\n"));
+  assertRowStartsWith("Waiting for data", 0);
+}
+
+void test_frames_are_acked_once_displayed() {
+  takeReplies();
+  sim::serialRx("META interval=1\nAAAAAAAAAAAAAAAAAAAA\nBBBBBBBBBBBBBBBBBBBB\n"
+                "CCCCCCCCCCCCCCCCCCCC\nDDDDDDDDDDDDDDDDDDDD\n\n");
+  sim::serialRx("META interval=1\n\n");  // keepalive
+  loop();
+  // 80 changed cells do not fit the LCD ring in one pass: no credit back yet.
+  TEST_ASSERT_FALSE(LcdDriver::idle());
+  TEST_ASSERT_EQUAL_STRING("", sim::takeTx().c_str());
+  sim::drainLcd();
+  TEST_ASSERT_EQUAL_STRING("ACK 2\r\n", sim::takeTx().c_str());
+}
+
+void test_full_frame_renders_lines() {
+  sim::serialRx("META interval=1\nCPU 12%\nRAM 40%\nGPU 3%\nDISK 71%\nNET 2M\n\n");
+  sim::lcd().resetStats();
+  sim::drainLcd();
+  TEST_ASSERT_EQUAL_STRING("CPU 12%             ", lcdRow(0).c_str());
+  TEST_ASSERT_EQUAL_STRING("DISK 71%            ", lcdRow(3).c_str());
+  TEST_ASSERT_TRUE(sim::lcd().stats().data > 0);
+}
+
+void test_delta_touches_only_changed_cells() {
+  sim::lcd().resetStats();
+  sim::serialRx("DELTA 5\n0 CPU 13%\n\n");
+  sim::drainLcd();
+  assertRowStartsWith("CPU 13%", 0);
+  // One changed digit: one cursor move plus one data byte.
+  TEST_ASSERT_EQUAL_UINT32(1, sim::lcd().stats().data);
+  TEST_ASSERT_EQUAL_UINT32(1, sim::lcd().stats().commands);
+}
+
+void test_encoder_scrolls_telemetry() {
+  sim::turnEncoder(1);
+  sim::drainLcd();
+  assertRowStartsWith("RAM 40%", 0);
+  assertRowStartsWith("NET 2M", 3);
+  sim::turnEncoder(-1);
+  sim::drainLcd();
+  assertRowStartsWith("CPU 13%", 0);
+}
+
+void test_render_does_not_wait_for_the_bus() {
+  sim::serialRx("CPU 14% 52C\nRAM 41% 6.2G\nGPU 4% 40C\nDISK 72% /\nNET 3M/1M\n\n");
+  uint64_t start = sim::nowMicros();
+  loop();
+  // One pass queues what fits and sleeps until the next tick; the rest of the
+  // repaint is paced out by the Timer2 ISR.
+  TEST_ASSERT_TRUE(sim::nowMicros() - start <= 1000);
+  TEST_ASSERT_FALSE(LcdDriver::idle());
+  sim::drainLcd();
+  assertRowStartsWith("DISK 72% /", 3);
+}
+
+void test_input_burst_coalesces_into_one_update() {
+  sim::lcd().resetStats();
+  sim::serialRx("DELTA 5\n0 CPU 15% 53C\n\n");
+  sim::turnEncoder(1);
+  sim::turnEncoder(1);
+  sim::turnEncoder(-1);
+  sim::drainLcd();
+  assertRowStartsWith("RAM 41% 6.2G", 0);
+  // Frame plus three detents: at most one repaint of the 4x20 panel.
+  TEST_ASSERT_TRUE(sim::lcd().stats().data <= 80);
+  TEST_ASSERT_TRUE(sim::lcd().stats().commands <= 8);
+}
+
+void test_watchdog_times_out_on_virtual_clock() {
+  sim::runFor(9000);
+  assertRowStartsWith("RAM 41%", 0);
+  sim::runFor(2000);  // past 10x the 1 s interval
+  assertRowStartsWith("Waiting for data", 0);
+}
+
+void test_long_press_fires_while_held() {
+  takeReplies();
+  sim::setPin(sim::kPinButton, LOW);
+  sim::runFor(750);
+  TEST_ASSERT_EQUAL_STRING("REQ COMMANDS 0 0 8\r\n", takeReplies().c_str());
+  sim::setPin(sim::kPinButton, HIGH);
+  sim::runFor(50);
+  TEST_ASSERT_EQUAL_STRING("", takeReplies().c_str());
+}
+
+void test_commands_frame_switches_view() {
+  sim::serialRx("PAGE 0 0 0 10\n0 Cmd0\n1 Cmd1\n2 Cmd2\n3 Cmd3\n4 Cmd4\n5 Cmd5\n"
+                "6 Cmd6\n7 Cmd7\n\n");
+  sim::drainLcd();
+  assertRowStartsWith(">Cmd0", 0);
+  // The window fits the first page, so the next one is fetched ahead of the cursor.
+  TEST_ASSERT_EQUAL_STRING("REQ COMMANDS 0 8 8\r\n", takeReplies().c_str());
+}
+
+static int selectedCommand() {
+  for (uint8_t r = 0; r < 4; ++r) {
+    std::string text = lcdRow(r);
+    if (text[0] == '>' && text.compare(1, 3, "Cmd") == 0) return text[4] - '0';
+  }
+  return -1;
+}
+
+void test_fast_spin_accelerates_cursor() {
+  sim::serialRx("PAGE 0 0 8 10\n8 Cmd8\n9 Cmd9\n\n");
+  sim::drainLcd();
+  sim::runFor(200);
+  TEST_ASSERT_EQUAL_INT(0, selectedCommand());
+  // Slow detents move one line each.
+  sim::turnEncoder(1);
+  sim::runFor(200);
+  sim::turnEncoder(1);
+  sim::drainLcd();
+  TEST_ASSERT_EQUAL_INT(2, selectedCommand());
+  // Detents a few ms apart move several.
+  sim::runFor(200);
+  for (int i = 0; i < 3; ++i) {
+    sim::turnEncoder(1);
+    sim::runFor(4);
+  }
+  sim::drainLcd();
+  TEST_ASSERT_EQUAL_INT(9, selectedCommand());
+}
+
+void test_menu_borrows_the_telemetry_arena() {
+  takeReplies();
+  // Telemetry arriving while the menu is loaded is not kept or asked for...
+  sim::serialRx("META interval=1\nCPU 99%\n\n");
+  sim::drainLcd();
+  TEST_ASSERT_EQUAL_INT(9, selectedCommand());
+  TEST_ASSERT_EQUAL_STRING("", takeReplies().c_str());
+  // ...until the menu closes and gives its slots back.
+  sim::setPin(sim::kPinButton, LOW);
+  sim::runFor(750);
+  sim::setPin(sim::kPinButton, HIGH);
+  sim::runFor(50);
+  TEST_ASSERT_EQUAL_STRING("REQ FULL\r\n", takeReplies().c_str());
+}
+
+void test_full_capacity_frame_scrolls_to_last_line() {
+  std::string text = "META interval=1\n";
+  for (size_t i = 0; i < Panel::Buffer::kCapacity; ++i) text += "Line " + std::to_string(i) + "\n";
+  text += "\n";
+  sim::serialStream(text.c_str());
+  sim::drainLcd();
+  assertRowStartsWith("Line 0 ", 0);
+  sim::turnEncoder(static_cast<int>(Panel::Buffer::kCapacity));
+  sim::drainLcd();
+  assertRowStartsWith("Line 31", 3);
+  TEST_ASSERT_EQUAL_STRING("", takeReplies().c_str());  // nothing overran
+}
+
+void test_menu_larger_than_stage_fits_after_full_telemetry() {
+  takeReplies();
+  sim::setPin(sim::kPinButton, LOW);
+  sim::runFor(750);
+  sim::setPin(sim::kPinButton, HIGH);
+  sim::runFor(50);
+  TEST_ASSERT_EQUAL_STRING("REQ COMMANDS 0 0 8\r\n", takeReplies().c_str());
+  std::string text = "PAGE 0 0 0 12\n";
+  for (char c = 'A'; c < 'A' + 8; ++c) text += std::to_string(c - 'A') + " Item " + c + "\n";
+  sim::serialStream((text + "\n").c_str());
+  sim::drainLcd();
+  assertRowStartsWith(">Item A", 0);
+  TEST_ASSERT_EQUAL_STRING("REQ COMMANDS 0 8 8\r\n", takeReplies().c_str());
+  text = "PAGE 0 0 8 12\n";
+  for (char c = 'I'; c < 'A' + 12; ++c) text += std::to_string(c - 'A') + " Item " + c + "\n";
+  sim::serialStream((text + "\n").c_str());
+  sim::turnEncoder(20);
+  sim::drainLcd();
+  assertRowStartsWith(" Item L", 2);
+  assertRowStartsWith(">Exit", 3);
+}
+
+static std::string binaryFrame(char type, const std::string& payload) {
+  std::string body(1, type);
+  body += static_cast<char>(payload.size() & 0xFF);
+  body += static_cast<char>(payload.size() >> 8);
+  body += payload;
+  uint16_t crc = CRC16_INIT;
+  for (char c : body) crc = crc16Update(crc, static_cast<uint8_t>(c));
+  return "\x02" + body + static_cast<char>(crc >> 8) + static_cast<char>(crc & 0xFF) + "\x03";
+}
+
+static void sendBinary(char type, const std::string& payload) {
+  std::string frame = binaryFrame(type, payload);
+  sim::serialRx(reinterpret_cast<const uint8_t*>(frame.data()), frame.size());
+}
+
+void test_values_frame_patches_layout_fields() {
+  // Long press leaves the menu.
+  sim::setPin(sim::kPinButton, LOW);
+  sim::runFor(750);
+  sim::setPin(sim::kPinButton, HIGH);
+  sim::runFor(50);
+  TEST_ASSERT_EQUAL_STRING("REQ FULL\r\n", takeReplies().c_str());
+  // Layout 9: CPU load at (0,4) width 3, temperature at (1,4) "%4.1f".
+  const char layout[] = "\xE8\x03\x09\x02"
+                        "\x00\x04\x03"
+                        "\x01\x04\x14"
+                        "\x08" "CPU   5%"
+                        "\x09" "TMP 40.5C";
+  sendBinary('L', std::string(layout, sizeof(layout) - 1));
+  sim::drainLcd();
+  assertRowStartsWith("CPU   5%", 0);
+  assertRowStartsWith("TMP 40.5C", 1);
+
+  sim::lcd().resetStats();
+  sendBinary('V', std::string("\xE8\x03\x09" "\x00\x2A\x00" "\x01\x9A\x01", 9));
+  sim::drainLcd();
+  assertRowStartsWith("CPU  42%", 0);
+  assertRowStartsWith("TMP 41.0C", 1);
+  TEST_ASSERT_EQUAL_UINT32(4, sim::lcd().stats().data);  // only the changed digits
+  TEST_ASSERT_EQUAL_STRING("", takeReplies().c_str());
+}
+
+void test_values_for_unknown_layout_request_full() {
+  sendBinary('V', std::string("\xE8\x03\x08" "\x00\x07\x00", 6));
+  sim::drainLcd();
+  assertRowStartsWith("CPU  42%", 0);
+  TEST_ASSERT_EQUAL_STRING("REQ FULL\r\n", takeReplies().c_str());
+  // A text frame replaces the lines and retires the layout.
+  sim::serialRx("META interval=1\nCPU   1%\n\n");
+  sendBinary('V', std::string("\xE8\x03\x09" "\x00\x07\x00", 6));
+  sim::drainLcd();
+  assertRowStartsWith("CPU   1%", 0);
+  TEST_ASSERT_EQUAL_STRING("REQ FULL\r\n", takeReplies().c_str());
+}
+
+static void doublePress() {
+  sim::runFor(400);  // not chained to an earlier press
+  for (int i = 0; i < 2; ++i) {
+    sim::setPin(sim::kPinButton, LOW);
+    sim::runFor(50);
+    sim::setPin(sim::kPinButton, HIGH);
+    sim::runFor(50);
+  }
+}
+
+void test_history_view_draws_sparkline_from_cgram() {
+  // Layout 10: CPU load and temperature flagged for history (fmt bit 6).
+  const char layout[] = "\xE8\x03\x0A\x02"
+                        "\x00\x04\x43"
+                        "\x00\x09\x43"
+                        "\x0D" "CPU   0%  20C";
+  sendBinary('L', std::string(layout, sizeof(layout) - 1));
+  sendBinary('V', std::string("\xE8\x03\x0A" "\x00\x32\x00", 6));
+  sendBinary('V', std::string("\xE8\x03\x0A" "\x00\x64\x00", 6));
+  sim::drainLcd();
+  TEST_ASSERT_EQUAL_STRING("", takeReplies().c_str());
+
+  doublePress();
+  sim::drainLcd();
+  std::string row0 = lcdRow(0);
+  std::string row1 = lcdRow(1);
+  TEST_ASSERT_EQUAL_STRING("CPU%", row0.substr(0, 4).c_str());
+  TEST_ASSERT_EQUAL_STRING("CPUC", row1.substr(0, 4).c_str());
+  // Samples 0%, 50%, 100%: newest at the right edge, eight-step columns.
+  TEST_ASSERT_EQUAL_INT(8 + 7, row0[19]);
+  TEST_ASSERT_EQUAL_INT(8 + 4, row0[18]);
+  TEST_ASSERT_EQUAL_INT(8 + 0, row0[17]);
+  TEST_ASSERT_EQUAL_INT(' ', row0[16]);
+  TEST_ASSERT_EQUAL_HEX8(0x1F, sim::lcd().glyphRow(row0[19], 0));
+  TEST_ASSERT_EQUAL_HEX8(0x00, sim::lcd().glyphRow(row0[17], 6));
+
+  // New samples repaint cells only; the glyph set is already in CGRAM.
+  sim::lcd().resetStats();
+  sendBinary('V', std::string("\xE8\x03\x0A" "\x00\x00\x00", 6));
+  sim::drainLcd();
+  TEST_ASSERT_TRUE(sim::lcd().stats().data <= 2 * 4);
+  TEST_ASSERT_EQUAL_INT(8 + 0, lcdRow(0)[19]);
+}
+
+void test_history_bars_then_back_to_telemetry() {
+  sim::turnEncoder(1);
+  sim::drainLcd();
+  // 0% CPU: no bar; 20C: 20% of 16 cells x 5 pixels = 3 full cells and one column.
+  std::string row1 = lcdRow(1);
+  TEST_ASSERT_EQUAL_INT(' ', lcdRow(0)[4]);
+  TEST_ASSERT_EQUAL_INT(8 + 4, row1[4]);
+  TEST_ASSERT_EQUAL_INT(8 + 4, row1[6]);
+  TEST_ASSERT_EQUAL_INT(8 + 0, row1[7]);
+  TEST_ASSERT_EQUAL_INT(' ', row1[8]);
+  TEST_ASSERT_EQUAL_HEX8(0x10, sim::lcd().glyphRow(row1[7], 3));
+  doublePress();
+  sim::drainLcd();
+  assertRowStartsWith("CPU   0%  20C", 0);
+}
+
+void test_encoder_scrolls_past_the_last_line_into_history() {
+  // One line on screen, so it is also the last: the next detent opens History.
+  sim::turnEncoder(1);
+  sim::drainLcd();
+  TEST_ASSERT_EQUAL_STRING("CPU%", lcdRow(0).substr(0, 4).c_str());
+  sim::turnEncoder(1);  // bars
+  sim::drainLcd();
+  TEST_ASSERT_EQUAL_INT(8 + 4, lcdRow(1)[4]);
+  sim::turnEncoder(-1);  // sparklines
+  sim::drainLcd();
+  TEST_ASSERT_EQUAL_INT(' ', lcdRow(1)[4]);
+  sim::turnEncoder(-1);  // above the first page: back to the lines
+  sim::drainLcd();
+  assertRowStartsWith("CPU   0%  20C", 0);
+}
+
+static std::string rate32(uint32_t rate) {
+  std::string out;
+  for (int i = 0; i < 4; ++i) out += static_cast<char>((rate >> (8 * i)) & 0xFF);
+  return out;
+}
+
+void test_unconfirmed_baud_falls_back_after_probation() {
+  takeReplies();
+  sendBinary('B', rate32(300000));  // no exact U2X divisor at 16 MHz
+  sim::runFor(1);
+  TEST_ASSERT_EQUAL_STRING("BAUD 115200\r\n", takeReplies().c_str());
+  TEST_ASSERT_EQUAL_UINT32(115200, sim::deviceBaud());
+
+  sendBinary('B', rate32(1000000));
+  sim::runFor(1);
+  TEST_ASSERT_EQUAL_STRING("BAUD 1000000\r\n", takeReplies().c_str());
+  TEST_ASSERT_EQUAL_UINT32(1000000, sim::deviceBaud());
+  // The host stayed at 115200: its hello arrives garbled and is not a frame.
+  sim::serialRx("META interval=1 hello=1\n\n");
+  sim::runFor(999);
+  TEST_ASSERT_EQUAL_UINT32(1000000, sim::deviceBaud());
+  sim::runFor(1);
+  TEST_ASSERT_EQUAL_UINT32(115200, sim::deviceBaud());
+  sim::serialRx("META interval=1 hello=1\n\n");
+  sim::runFor(1);
+  TEST_ASSERT_NOT_EQUAL(std::string::npos, takeReplies().find("CAPS delta"));
+}
+
+void test_confirmed_baud_holds_until_frames_go_bad() {
+  sendBinary('B', rate32(500000));
+  sim::runFor(1);
+  TEST_ASSERT_EQUAL_STRING("BAUD 500000\r\n", takeReplies().c_str());
+  sim::setHostBaud(500000);
+  sim::serialRx("META interval=1 hello=1\n\n");
+  sim::runFor(1500);  // past the probation
+  TEST_ASSERT_EQUAL_UINT32(500000, sim::deviceBaud());
+  TEST_ASSERT_NOT_EQUAL(std::string::npos, takeReplies().find("CAPS delta"));
+
+  std::string bad = binaryFrame('K', std::string("\xE8\x03", 2));
+  bad[bad.size() - 2] ^= 0x01;  // CRC
+  for (int i = 0; i < 2; ++i) {
+    sim::serialRx(reinterpret_cast<const uint8_t*>(bad.data()), bad.size());
+  }
+  sim::runFor(1);
+  TEST_ASSERT_EQUAL_UINT32(500000, sim::deviceBaud());
+  sim::serialRx(reinterpret_cast<const uint8_t*>(bad.data()), bad.size());
+  sim::runFor(1);
+  TEST_ASSERT_EQUAL_UINT32(115200, sim::deviceBaud());  // third in a row
+  TEST_ASSERT_NOT_EQUAL(std::string::npos, takeReplies().find("BADFRAME "));
+  sim::setHostBaud(115200);
+}
+
+// Value of `key=` in a STATS reply, -1 when absent.
+static long statValue(const std::string& reply, const char* key) {
+  std::string needle = std::string(" ") + key + "=";
+  size_t pos = reply.find(needle);
+  if (pos == std::string::npos) return -1;
+  return strtol(reply.c_str() + pos + needle.size(), nullptr, 10);
+}
+
+static std::string requestStats() {
+  sim::serialRx("REQ STATS\n\n");
+  sim::runFor(1);
+  return takeReplies();
+}
+
+void test_stats_request_reports_counters() {
+  takeReplies();
+  std::string before = requestStats();
+  TEST_ASSERT_EQUAL_STRING("STATS rx=", before.substr(0, 9).c_str());
+  const char* keys[] = {"ok",      "bad",     "lost", "ovr", "trunc", "draws",
+                        "draw_us", "loop_us", "enc",  "free"};
+  for (const char* key : keys) TEST_ASSERT_TRUE(statValue(before, key) >= 0);
+
+  // 44 chars: 40 fit, the first 20 on screen and the rest in the marquee.
+  sim::serialRx("META interval=1\nCPU 12% 3.4GHz 61C fans 1200rpm pump 2400rpm\nRAM 40%\n\n");
+  sim::drainLcd();
+  sim::turnEncoder(1);
+  sim::drainLcd();
+  std::string after = requestStats();
+  TEST_ASSERT_EQUAL(2, statValue(after, "rx") - statValue(before, "rx"));  // frame + request
+  TEST_ASSERT_EQUAL(1, statValue(after, "ok") - statValue(before, "ok"));
+  TEST_ASSERT_EQUAL(4, statValue(after, "trunc") - statValue(before, "trunc"));
+  TEST_ASSERT_EQUAL(4, statValue(after, "enc") - statValue(before, "enc"));  // edges
+  TEST_ASSERT_TRUE(statValue(after, "draws") > statValue(before, "draws"));
+  TEST_ASSERT_EQUAL(0, statValue(after, "free"));  // nothing to measure on the host
+}
+
+static void turnSlowly(int detents) {
+  for (int i = 0; i < detents; ++i) {
+    sim::turnEncoder(1);
+    sim::runFor(200);  // no acceleration: one entry per detent
+  }
+  sim::drainLcd();
+}
+
+static std::string toolLine(int i) {
+  return "t" + std::to_string(i) + " Tool " + std::to_string(i) + "\n";
+}
+
+void test_menu_pages_follow_the_cursor() {
+  takeReplies();
+  sim::setPin(sim::kPinButton, LOW);
+  sim::runFor(750);
+  sim::setPin(sim::kPinButton, HIGH);
+  sim::runFor(50);
+  TEST_ASSERT_EQUAL_STRING("REQ COMMANDS 0 0 8\r\n", takeReplies().c_str());
+  sim::serialRx("PAGE 0 0 0 3\n@1 Tools\nrb Reboot\nhalt Halt\n\n");
+  sim::drainLcd();
+  assertRowStartsWith(">Tools", 0);
+  assertRowStartsWith(" Exit", 3);
+  TEST_ASSERT_EQUAL_STRING("", takeReplies().c_str());  // one page holds the menu
+
+  doublePress();  // "@1": open submenu 1
+  TEST_ASSERT_EQUAL_STRING("REQ COMMANDS 1 0 8\r\n", takeReplies().c_str());
+  std::string text = "PAGE 1 0 0 20\n";
+  for (int i = 0; i < 8; ++i) text += toolLine(i);
+  sim::serialRx((text + "\n").c_str());
+  sim::drainLcd();
+  assertRowStartsWith(">Tool 0", 0);
+  TEST_ASSERT_EQUAL_STRING("REQ COMMANDS 1 8 8\r\n", takeReplies().c_str());
+  // A stale reply for a page nobody asked for is ignored.
+  sim::serialRx("PAGE 1 0 16 20\nt16 Stale\n\n");
+  text = "PAGE 1 0 8 20\n";
+  for (int i = 8; i < 16; ++i) text += toolLine(i);
+  sim::serialRx((text + "\n").c_str());
+
+  // While the window straddles two pages nothing more is fetched; once it
+  // leaves the first, the page after the second is requested.
+  turnSlowly(10);
+  assertRowStartsWith(">Tool 10", 3);
+  TEST_ASSERT_EQUAL_STRING("", takeReplies().c_str());
+  turnSlowly(1);
+  assertRowStartsWith(" Tool 8", 0);
+  TEST_ASSERT_EQUAL_STRING("REQ COMMANDS 1 16 8\r\n", takeReplies().c_str());
+  turnSlowly(5);
+  assertRowStartsWith(">...", 3);  // cursor got there before the page
+  sim::serialRx("PAGE 1 0 16 20\nt16 Tool 16\nt17 Tool 17\nt18 Tool 18\nt19 Tool 19\n\n");
+  sim::drainLcd();
+  assertRowStartsWith(">Tool 16", 3);
+}
+
+void test_submenu_back_restores_the_parent_cursor() {
+  turnSlowly(4);
+  assertRowStartsWith(">Back", 3);
+  doublePress();
+  TEST_ASSERT_EQUAL_STRING("REQ COMMANDS 0 0 8\r\n", takeReplies().c_str());
+  sim::serialRx("PAGE 0 0 0 3\n@1 Tools\nrb Reboot\nhalt Halt\n\n");
+  sim::drainLcd();
+  assertRowStartsWith(">Tools", 0);
+  turnSlowly(1);
+  doublePress();
+  TEST_ASSERT_EQUAL_STRING("SELECT rb\r\n", takeReplies().c_str());
+  turnSlowly(2);
+  assertRowStartsWith(">Exit", 3);
+  doublePress();
+  TEST_ASSERT_EQUAL_STRING("REQ FULL\r\n", takeReplies().c_str());
+}
+
+void test_long_line_scrolls_on_its_own_row() {
+  sim::serialRx("META interval=1\nCPU 12%\nhost: build-server-07.lab.example\nRAM 40%\n\n");
+  sim::drainLcd();
+  assertRowStartsWith("host: build-server-0", 1);
+  // Four steps resting on the start, then one column per step.
+  sim::lcd().resetStats();
+  sim::runFor(5 * 350 + 100);
+  sim::drainLcd();
+  assertRowStartsWith("ost: build-server-07", 1);
+  assertRowStartsWith("CPU 12%", 0);
+  assertRowStartsWith("RAM 40%", 2);
+  TEST_ASSERT_TRUE(sim::lcd().stats().data > 0);
+  TEST_ASSERT_TRUE(sim::lcd().stats().data <= 20);  // one row, moved once
+  // Once the line fits again the row stops moving.
+  sim::serialRx("DELTA 3\n1 host: nas\n\n");
+  sim::drainLcd();
+  assertRowStartsWith("host: nas ", 1);
+  sim::lcd().resetStats();
+  sim::runFor(2000);
+  TEST_ASSERT_EQUAL_UINT32(0, sim::lcd().stats().data);
+}
+
+// "Long line <i> " padded with letters to twice the panel width.
+static std::string longLine(size_t i) {
+  std::string s = "Long line " + std::to_string(i) + " ";
+  while (s.size() < Panel::Buffer::kLongWidth) s += static_cast<char>('a' + s.size() % 26);
+  return s;
+}
+
+void test_wide_lines_leave_room_for_the_next_frame() {
+  const size_t lines = Panel::Buffer::kCapacity;
+  const size_t stage = Panel::Buffer::kStageGuarantee;
+  takeReplies();
+  long trunc = statValue(requestStats(), "trunc");
+  // More heads and tails than the ring's share of the arena.
+  std::string text = "META interval=1\n";
+  const size_t shown = 3 * lines / 4;
+  for (size_t i = 0; i < shown; ++i) text += longLine(i) + "\n";
+  sim::serialStream((text + "\n").c_str());
+  sim::drainLcd();
+  assertRowStartsWith("Long line 0 ", 0);
+  sim::serialStream(("META interval=1\nDELTA " + std::to_string(shown) + "\n0 Short\n\n").c_str());
+  sim::drainLcd();
+  assertRowStartsWith("Short ", 0);
+  TEST_ASSERT_EQUAL_STRING("", takeReplies().c_str());  // nothing dropped
+
+  // A stage of wide lines, then deltas growing the screen to capacity.
+  for (size_t first = 0; first < lines; first += stage) {
+    text = first == 0 ? "META interval=1\n" : "META interval=1\nDELTA " +
+                                                   std::to_string(first + stage) + "\n";
+    for (size_t i = first; i < first + stage; ++i) {
+      text += (first == 0 ? "" : std::to_string(i) + " ") + longLine(i) + "\n";
+    }
+    sim::serialStream((text + "\n").c_str());
+    sim::drainLcd();
+  }
+  sim::turnEncoder(static_cast<int>(lines));
+  sim::drainLcd();
+  assertRowStartsWith(longLine(lines - 1).substr(0, Panel::kCols).c_str(), 3);
+  std::string stats = requestStats();
+  TEST_ASSERT_EQUAL_STRING("STATS ", stats.substr(0, 6).c_str());  // no REQ FULL, no RXOVR
+  TEST_ASSERT_TRUE(statValue(stats, "trunc") > trunc);  // tails gave way to lines
+}
+
+void test_stalled_loop_holds_a_whole_frame_then_reports_overrun() {
+  const size_t lines = Panel::Buffer::kCapacity;
+  const size_t stage = Panel::Buffer::kStageGuarantee;
+  takeReplies();
+  // The daemon's largest frame: a delta filling the stage with panel-wide lines.
+  std::string text = "META interval=1.000\nDELTA " + std::to_string(lines) + "\n";
+  for (size_t i = lines - stage; i < lines; ++i) {
+    text += std::to_string(i) + " " + std::string(Panel::kCols, static_cast<char>('A' + i % 26)) +
+            "\n";
+  }
+  text += "\n";
+  TEST_ASSERT_TRUE(text.size() < SerialLink::kRxCapacity);
+  sim::serialRx(text.c_str());  // all of it lands before loop() runs
+  sim::runFor(1);
+  TEST_ASSERT_EQUAL_STRING("", takeReplies().c_str());
+
+  // A burst past the ring loses its end, terminator included: the frame
+  // that follows closes it, and the device reports the loss.
+  std::string burst = "META interval=1\n" + std::string(SerialLink::kRxCapacity, 'x') + "\n\n";
+  sim::serialRx(burst.c_str());
+  sim::runFor(1);
+  sim::serialRx("META interval=1\nLost\n\n");
+  sim::runFor(1);
+  TEST_ASSERT_EQUAL_STRING("RXOVR ", takeReplies().substr(0, 6).c_str());
+  sim::serialRx("META interval=1\nAfter\n\n");
+  sim::drainLcd();
+  assertRowStartsWith("After ", 0);
+}
+
+void test_reset_shows_the_saved_screen_until_data_arrives() {
+  sim::serialRx("META interval=2\nSAVED 1\nSAVED 2\n\n");
+  sim::drainLcd();
+  // Saves are at least 10 minutes apart; keep the link up until one is due.
+  for (int i = 0; i < 11 * 60 / 5; ++i) {
+    sim::serialRx("META interval=2\n\n");
+    sim::runFor(5000);
+  }
+  // Cells past the text are stored as NULs, blank rows included.
+  ScreenSnapshot saved;
+  TEST_ASSERT_TRUE(saved.load());
+  char text[ScreenSnapshot::kCols + 1];
+  saved.row(1, text);
+  TEST_ASSERT_EQUAL_STRING("SAVED 2", text);
+  for (uint8_t row = 1; row < ScreenSnapshot::kRows; ++row) {
+    saved.row(row, text);
+    for (size_t col = (row == 1) ? 7 : 0; col < ScreenSnapshot::kCols; ++col) {
+      TEST_ASSERT_EQUAL_CHAR('\0', text[col]);
+    }
+  }
+  sim::runFor(21000);  // daemon gone: the watchdog clears the screen
+  assertRowStartsWith("Waiting for data", 0);
+
+  setup();  // reset; the sim's EEPROM keeps its contents
+  sim::drainLcd();
+  std::string top = lcdRow(0);
+  assertRowStartsWith("SAVED 1", 0);
+  assertRowStartsWith("SAVED 2", 1);
+  TEST_ASSERT_NOT_EQUAL(std::string::npos, std::string("|/-\\").find(top[19]));  // stale mark
+  // A keepalive cannot refresh the rows: still stale, and a full frame is asked for.
+  takeReplies();
+  sim::serialRx("META interval=2\n\n");
+  sim::drainLcd();
+  TEST_ASSERT_EQUAL_STRING("REQ FULL\r\n", takeReplies().c_str());
+  TEST_ASSERT_EQUAL_STRING(top.c_str(), lcdRow(0).c_str());
+  sim::serialRx("META interval=2\nFRESH\n\n");
+  sim::drainLcd();
+  TEST_ASSERT_EQUAL_STRING("FRESH               ", lcdRow(0).c_str());
+  TEST_ASSERT_EQUAL_STRING("                    ", lcdRow(1).c_str());
+}
+
+static void longPress() {
+  sim::setPin(sim::kPinButton, LOW);
+  sim::runFor(750);
+  sim::setPin(sim::kPinButton, HIGH);
+  sim::runFor(50);
+  sim::drainLcd();
+}
+
+void test_kept_top_menu_opens_at_once_until_telemetry_needs_it() {
+  takeReplies();
+  longPress();
+  TEST_ASSERT_EQUAL_STRING("REQ COMMANDS 0 0 8\r\n", takeReplies().c_str());
+  sim::serialRx("PAGE 0 0 0 3 4660\n@1 Tools\nrb Reboot\nhalt Halt\n\n");
+  longPress();  // back to telemetry; the top page stays
+  TEST_ASSERT_EQUAL_STRING("REQ FULL\r\n", takeReplies().c_str());
+  sim::serialRx("META interval=2\nBACK\n\n");
+
+  longPress();
+  assertRowStartsWith(">Tools", 0);  // before the daemon has answered
+  TEST_ASSERT_EQUAL_STRING("REQ COMMANDS 0 0 8 have=4660\r\n", takeReplies().c_str());
+  sim::serialRx("PAGE 0 0 0 3 4660\n\n");  // unchanged: the header alone
+  sim::drainLcd();
+  assertRowStartsWith(" Reboot", 1);
+
+  // A changed menu replaces the kept page.
+  longPress();
+  sim::serialRx("META interval=2\nBACK\n\n");
+  takeReplies();
+  longPress();
+  TEST_ASSERT_EQUAL_STRING("REQ COMMANDS 0 0 8 have=4660\r\n", takeReplies().c_str());
+  sim::serialRx("PAGE 0 0 0 2 4661\nrb Reboot\nup Update\n\n");
+  sim::drainLcd();
+  assertRowStartsWith(">Reboot", 0);
+  assertRowStartsWith(" Update", 1);
+  assertRowStartsWith(" Exit", 2);
+
+  // Telemetry growing to capacity, a stage at a time, takes the slots back.
+  longPress();
+  takeReplies();
+  const size_t stage = Panel::Buffer::kStageGuarantee;
+  const size_t lines = Panel::Buffer::kCapacity;
+  for (size_t first = 0; first < lines; first += stage) {
+    std::string text = first == 0 ? "META interval=2\n" : "DELTA " + std::to_string(lines) + "\n";
+    for (size_t i = first; i < first + stage; ++i) {
+      text += (first == 0 ? "" : std::to_string(i) + " ") + "Line " + std::to_string(i) + "\n";
+    }
+    sim::serialRx((text + "\n").c_str());
+    sim::runFor(10);
+  }
+  sim::turnEncoder(static_cast<int>(lines));
+  sim::drainLcd();
+  assertRowStartsWith("Line 31", 3);
+  TEST_ASSERT_EQUAL_STRING("", takeReplies().c_str());  // every delta applied
+  longPress();
+  TEST_ASSERT_EQUAL_STRING("REQ COMMANDS 0 0 8\r\n", takeReplies().c_str());
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  // Scenario order: the sketch keeps its state between tests.
+  RUN_TEST(test_boot_announces_caps_and_waits);
+  RUN_TEST(test_frames_are_acked_once_displayed);
+  RUN_TEST(test_full_frame_renders_lines);
+  RUN_TEST(test_delta_touches_only_changed_cells);
+  RUN_TEST(test_encoder_scrolls_telemetry);
+  RUN_TEST(test_render_does_not_wait_for_the_bus);
+  RUN_TEST(test_input_burst_coalesces_into_one_update);
+  RUN_TEST(test_watchdog_times_out_on_virtual_clock);
+  RUN_TEST(test_long_press_fires_while_held);
+  RUN_TEST(test_commands_frame_switches_view);
+  RUN_TEST(test_fast_spin_accelerates_cursor);
+  RUN_TEST(test_menu_borrows_the_telemetry_arena);
+  RUN_TEST(test_full_capacity_frame_scrolls_to_last_line);
+  RUN_TEST(test_menu_larger_than_stage_fits_after_full_telemetry);
+  RUN_TEST(test_values_frame_patches_layout_fields);
+  RUN_TEST(test_values_for_unknown_layout_request_full);
+  RUN_TEST(test_history_view_draws_sparkline_from_cgram);
+  RUN_TEST(test_history_bars_then_back_to_telemetry);
+  RUN_TEST(test_encoder_scrolls_past_the_last_line_into_history);
+  RUN_TEST(test_unconfirmed_baud_falls_back_after_probation);
+  RUN_TEST(test_confirmed_baud_holds_until_frames_go_bad);
+  RUN_TEST(test_stats_request_reports_counters);
+  RUN_TEST(test_menu_pages_follow_the_cursor);
+  RUN_TEST(test_submenu_back_restores_the_parent_cursor);
+  RUN_TEST(test_long_line_scrolls_on_its_own_row);
+  RUN_TEST(test_wide_lines_leave_room_for_the_next_frame);
+  RUN_TEST(test_stalled_loop_holds_a_whole_frame_then_reports_overrun);
+  RUN_TEST(test_reset_shows_the_saved_screen_until_data_arrives);
+  RUN_TEST(test_kept_top_menu_opens_at_once_until_telemetry_needs_it);
+  return UNITY_END();
+}
@@ -0,0 +1,44 @@
+#include <Arduino.h>
+#include <unity.h>
+#include "TextFormat.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_write_unsigned_digits() {
+  char out[TextFormat::kMaxDigits];
+  TEST_ASSERT_EQUAL_UINT(1, TextFormat::writeUnsigned(out, 0));
+  TEST_ASSERT_EQUAL_CHAR('0', out[0]);
+  TEST_ASSERT_EQUAL_UINT(10, TextFormat::writeUnsigned(out, 4294967295UL));
+  TEST_ASSERT_EQUAL_CHAR('4', out[0]);
+  TEST_ASSERT_EQUAL_CHAR('5', out[9]);
+}
+
+void test_append_builds_a_line() {
+  char line[21];
+  uint8_t len = TextFormat::appendP(line, 0, 20, PSTR("Timeout: "));
+  len = TextFormat::appendUnsigned(line, len, 20, 30);
+  len = TextFormat::appendChar(line, len, 20, 's');
+  TEST_ASSERT_EQUAL_UINT(12, len);
+  TEST_ASSERT_EQUAL_STRING("Timeout: 30s", line);
+}
+
+void test_append_cuts_at_capacity() {
+  char line[9];
+  uint8_t len = TextFormat::appendP(line, 0, 8, PSTR("Waiting for data"));
+  TEST_ASSERT_EQUAL_STRING("Waiting ", line);
+  TEST_ASSERT_EQUAL_UINT(8, TextFormat::appendChar(line, len, 8, '|'));
+  len = TextFormat::appendP(line, 0, 8, PSTR("ACK "));
+  TEST_ASSERT_EQUAL_UINT(8, TextFormat::appendUnsigned(line, len, 8, 123456));
+  TEST_ASSERT_EQUAL_STRING("ACK 1234", line);
+}
+
+void setup() {
+  UNITY_BEGIN();
+  RUN_TEST(test_write_unsigned_digits);
+  RUN_TEST(test_append_builds_a_line);
+  RUN_TEST(test_append_cuts_at_capacity);
+  UNITY_END();
+}
+
+void loop() {}
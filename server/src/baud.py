@@ -0,0 +1,222 @@
+"""Runtime link-rate negotiation.
+
+The firmware boots at `serial.baud` (115200) and announces the fastest rate it
+accepts with `baud=<max>` in CAPS. BaudNegotiator then tries the BAUD_LADDER
+rates both sides allow, fastest first:
+
+1. telemetry is held back (see `ready`);
+2. a `B` frame names the rate; the device answers `BAUD <rate>` at the old
+   rate and switches (a refusal names the rate it stays at);
+3. the port switches and sends `META hello=1`; a `CAPS` reply at the new rate
+   confirms it.
+
+A rate that is refused, or not confirmed within BAUD_CONFIRM_TIMEOUT, takes a
+strike and the port goes back to the boot rate. The device goes back on its
+own when its probation runs out, and the next rate is tried once it has.
+Once switched, BAUD_MAX_BAD link errors in a row (BADFRAME, RXOVR, lines that
+make no sense, credits that never come back) send both ends back to the boot
+rate, which also costs the rate a strike. A rate with BAUD_MAX_STRIKES
+strikes is not tried again.
+"""
+
+from __future__ import annotations
+
+import logging
+import threading
+from typing import Dict, List, Optional, Protocol
+
+from .protocol import encode_baud
+from .transmit import Priority, Transmitter
+
+# Rates tried above the boot rate. At 16 MHz the AVR's U2X divisor hits each
+# exactly; 115200 is 2.1 % off, which is fine at that speed but not above it.
+BAUD_LADDER = (1000000, 500000, 250000)
+
+BAUD_REPLY_TIMEOUT = 1.0
+# Well inside the firmware's probation (1 s), so the device is still waiting
+# for the hello when the port gives up.
+BAUD_CONFIRM_TIMEOUT = 0.5
+# After a failed attempt: long enough for the device's probation to run out.
+BAUD_SETTLE = 1.0
+BAUD_MAX_BAD = 3
+BAUD_MAX_STRIKES = 2
+
+
+class Port(Protocol):
+    baudrate: int
+
+
+class LinkState(Protocol):
+    def request_full(self) -> None: ...
+
+
+class BaudNegotiator:
+    def __init__(
+        self,
+        port: Port,
+        tx: Transmitter,
+        link: LinkState,
+        boot: int,
+        max_baud: int,
+        hello: bytes,
+    ) -> None:
+        self._port = port
+        self._tx = tx
+        self._link = link
+        self._boot = boot
+        self._max = max_baud
+        self._hello = hello
+        self._lock = threading.Lock()
+        self._rate = boot
+        self._device_max = 0
+        self._strikes: Dict[int, int] = {}
+        self._bad = 0
+        self._holding = False
+        self._trying: Optional[int] = None
+        self._reply: Optional[int] = None
+        self._replied = threading.Event()
+        self._confirmed = threading.Event()
+        self._stop = threading.Event()
+        self._thread: Optional[threading.Thread] = None
+        self._log = logging.getLogger(__name__)
+
+    @property
+    def rate(self) -> int:
+        with self._lock:
+            return self._rate
+
+    @property
+    def negotiating(self) -> bool:
+        with self._lock:
+            return self._thread is not None and self._thread.is_alive()
+
+    def ready(self) -> bool:
+        """False while a switch is in progress: telemetry must wait."""
+        with self._lock:
+            return not self._holding
+
+    def stop(self, timeout: float = 1.0) -> None:
+        self._stop.set()
+        self._replied.set()
+        self._confirmed.set()
+        thread = self._thread
+        if thread is not None:
+            thread.join(timeout=timeout)
+
+    def candidates(self) -> List[int]:
+        with self._lock:
+            top = min(self._max, self._device_max)
+            return [
+                r
+                for r in BAUD_LADDER
+                if self._boot < r <= top and self._strikes.get(r, 0) < BAUD_MAX_STRIKES
+            ]
+
+    # --- Events from the reader thread ---
+
+    def on_caps(self, device_max: int | None) -> None:
+        with self._lock:
+            self._device_max = device_max or 0
+            self._bad = 0
+            if self._trying is not None:
+                self._confirmed.set()
+                return
+            busy = self._thread is not None and self._thread.is_alive()
+            if busy or self._rate != self._boot or self._stop.is_set():
+                return
+        if not self.candidates():
+            return
+        thread = threading.Thread(target=self._negotiate, name="baud", daemon=True)
+        with self._lock:
+            self._thread = thread
+        thread.start()
+
+    def on_reply(self, rate: int) -> None:
+        with self._lock:
+            self._reply = rate
+        self._replied.set()
+
+    def on_link_ok(self) -> None:
+        with self._lock:
+            self._bad = 0
+
+    def on_link_error(self) -> None:
+        with self._lock:
+            if self._rate == self._boot or self._trying is not None:
+                return
+            self._bad += 1
+            if self._bad < BAUD_MAX_BAD:
+                return
+            rate = self._rate
+            self._strike(rate)
+            self._rate = self._boot
+            self._bad = 0
+        self._log.warning("link errors at %d baud; back to %d", rate, self._boot)
+        self._port.baudrate = self._boot
+        # Whatever was in flight is gone; the hello brings back CAPS, which
+        # tries again from the rates that are left.
+        self._link.request_full()
+        self._tx.submit(self._hello, Priority.INTERACTIVE)
+
+    # --- Negotiation thread ---
+
+    def _strike(self, rate: int) -> None:
+        self._strikes[rate] = self._strikes.get(rate, 0) + 1
+
+    def _negotiate(self) -> None:
+        for rate in self.candidates():
+            if self._attempt(rate):
+                return
+            if self._stop.wait(BAUD_SETTLE):
+                return
+        self._log.info("link stays at %d baud", self._boot)
+
+    def _attempt(self, rate: int) -> bool:
+        with self._lock:
+            self._holding = True
+            self._trying = rate
+            self._reply = None
+        self._replied.clear()
+        try:
+            self._tx.submit(encode_baud(rate), Priority.INTERACTIVE)
+            self._replied.wait(BAUD_REPLY_TIMEOUT)
+            with self._lock:
+                reply = self._reply
+            if self._stop.is_set():
+                return False
+            if reply != rate:
+                self._log.info("device refused %d baud (reply %s)", rate, reply)
+                with self._lock:
+                    self._strike(rate)
+                return False
+            try:
+                self._port.baudrate = rate
+            except (OSError, ValueError) as e:
+                # The device switched anyway and drops back after its probation.
+                self._log.warning("port cannot do %d baud: %s", rate, e)
+                with self._lock:
+                    self._strikes[rate] = BAUD_MAX_STRIKES
+                return False
+            self._confirmed.clear()  # only a CAPS at the new rate counts
+            self._tx.submit(self._hello, Priority.INTERACTIVE)
+            if self._confirmed.wait(BAUD_CONFIRM_TIMEOUT) and not self._stop.is_set():
+                with self._lock:
+                    self._rate = rate
+                self._log.info("link switched to %d baud", rate)
+                return True
+            self._port.baudrate = self._boot
+            self._log.warning("no answer at %d baud; back to %d", rate, self._boot)
+            with self._lock:
+                self._strike(rate)
+            return False
+        finally:
+            with self._lock:
+                self._holding = False
+                self._trying = None
+            self._tx.wake()
+
+
+def hello_frame(interval: float) -> bytes:
+    """A keepalive that asks the device to announce CAPS."""
+    return f"META interval={interval:.3f} hello=1\n\n".encode()
+
@@ -10,7 +10,13 @@ import yaml
 @dataclass
 class SerialConfig:
     port: str = "/dev/ttyUSB0"
-    baud: int = 115200
+    baud: int = 115200  # the rate the firmware boots at
+    # Fastest rate to negotiate once the firmware announces baud=; 0 keeps `baud`
+    max_baud: int = 1000000
+    # Seconds between REQ STATS polls of firmware announcing "stats"; 0 turns them off
+    stats_interval: float = 60.0
+    # auto: binary STX/ETX frames once the firmware announces "bin"; text: always line mode
+    framing: str = "auto"
 
 
 @dataclass
@@ -18,6 +24,8 @@ class CommandConfig:
     id: str
     label: str
     exec: str | None = None
+    # A submenu when non-empty; it has no exec of its own (see menus.py)
+    commands: list["CommandConfig"] = field(default_factory=list)
 
 
 @dataclass
@@ -27,6 +35,8 @@ class SensorConfig:
     enabled: bool = True
     format: str | None = None  # reserved for future use
     params: dict[str, Any] = field(default_factory=dict)
+    # Seconds between reads on the sensor's own worker; None: the frame interval
+    interval: float | None = None
     join: list["SensorConfig"] = field(default_factory=list)
 
 
@@ -39,7 +49,17 @@ class AppConfig:
     commands: List[CommandConfig] = field(default_factory=list)
 
 
+# Telemetry lines the firmware can hold (ScrollBuffer::kCapacity); older
+# sketches keep 12 and announce their own limit in CAPS, if at all.
+MAX_LINES = 32
+
+# Menus are numbered with one byte on the wire; ids of submenu entries are
+# sent as "@<menu>" (see menus.py).
+MAX_MENUS = 256
+SUBMENU_PREFIX = "@"
+
 _ALLOWED_PROVIDERS = {"cpu", "gpu", "temp", "join"}
+_ALLOWED_FRAMING = {"auto", "text"}
 
 
 def _as_int(val: Any, default: int) -> int:
@@ -56,11 +76,32 @@ def _as_float(val: Any, default: float) -> float:
         return default
 
 
+def _as_interval(val: Any) -> float | None:
+    return None if val is None else _as_float(val, 0.0)
+
+
 def _load_yaml(path: Path) -> dict[str, Any]:
     data = yaml.safe_load(path.read_text())
     return data or {}
 
 
+def _load_commands(items: Any) -> list[CommandConfig]:
+    commands: list[CommandConfig] = []
+    for item in items or []:
+        if not isinstance(item, dict):
+            continue
+        cid = str(item.get("id", "")).strip()
+        label = str(item.get("label", "")).strip()
+        if not cid or not label:
+            continue
+        exec_cmd_raw = item.get("exec")
+        exec_cmd = str(exec_cmd_raw).strip() if isinstance(exec_cmd_raw, str) else None
+        children_raw = item.get("commands")
+        children = _load_commands(children_raw) if isinstance(children_raw, list) else []
+        commands.append(CommandConfig(id=cid, label=label, exec=exec_cmd, commands=children))
+    return commands
+
+
 def load_config(path: str | Path) -> AppConfig:
     p = Path(path)
     data = _load_yaml(p)
@@ -70,6 +111,14 @@ def load_config(path: str | Path) -> AppConfig:
     serial = SerialConfig(
         port=str(serial_raw.get("port", SerialConfig.port)),
         baud=_as_int(serial_raw.get("baud", SerialConfig.baud), SerialConfig.baud),
+        max_baud=_as_int(
+            serial_raw.get("max_baud", SerialConfig.max_baud), SerialConfig.max_baud
+        ),
+        framing=str(serial_raw.get("framing", SerialConfig.framing)),
+        stats_interval=_as_float(
+            serial_raw.get("stats_interval", SerialConfig.stats_interval),
+            SerialConfig.stats_interval,
+        ),
     )
 
     # basics
@@ -121,6 +170,7 @@ def load_config(path: str | Path) -> AppConfig:
                         enabled=sub_enabled,
                         format=sub_fmt,  # type: ignore[arg-type]
                         params=sub_params,
+                        interval=_as_interval(sub.get("interval")),
                     )
                 )
 
@@ -132,21 +182,12 @@ def load_config(path: str | Path) -> AppConfig:
                 format=fmt,
                 params=params,
                 join=join_list,
+                interval=_as_interval(item.get("interval")),
             )
         )
 
     # commands (Phase 6)
-    commands: list[CommandConfig] = []
-    for item in data.get("commands", []) or []:
-        if not isinstance(item, dict):
-            continue
-        cid = str(item.get("id", "")).strip()
-        label = str(item.get("label", "")).strip()
-        if not cid or not label:
-            continue
-        exec_cmd_raw = item.get("exec")
-        exec_cmd = str(exec_cmd_raw).strip() if isinstance(exec_cmd_raw, str) else None
-        commands.append(CommandConfig(id=cid, label=label, exec=exec_cmd))
+    commands = _load_commands(data.get("commands", []))
 
     return AppConfig(
         interval=interval, serial=serial, max_lines=max_lines, sensors=sensors, commands=commands
@@ -156,16 +197,24 @@ def load_config(path: str | Path) -> AppConfig:
 def validate_config(cfg: AppConfig) -> None:
     if cfg.interval <= 0:
         raise ValueError("interval must be > 0")
-    if cfg.max_lines <= 0 or cfg.max_lines > 12:
-        raise ValueError("max_lines must be between 1 and 12")
+    if cfg.max_lines <= 0 or cfg.max_lines > MAX_LINES:
+        raise ValueError(f"max_lines must be between 1 and {MAX_LINES}")
     if not cfg.serial.port:
         raise ValueError("serial.port must be a non-empty string")
     if cfg.serial.baud <= 0:
         raise ValueError("serial.baud must be > 0")
+    if cfg.serial.max_baud < 0:
+        raise ValueError("serial.max_baud must be >= 0")
+    if cfg.serial.stats_interval < 0:
+        raise ValueError("serial.stats_interval must be >= 0")
+    if cfg.serial.framing not in _ALLOWED_FRAMING:
+        raise ValueError(f"serial.framing must be one of {sorted(_ALLOWED_FRAMING)}")
 
     for i, s in enumerate(cfg.sensors):
         if s.provider not in _ALLOWED_PROVIDERS:
             raise ValueError(f"sensors[{i}] '{s.name}': unknown provider '{s.provider}'")
+        if s.interval is not None and s.interval <= 0:
+            raise ValueError(f"sensors[{i}] '{s.name}': interval must be > 0")
         if s.provider == "join":
             if not s.join:
                 raise ValueError(f"sensors[{i}] '{s.name}': join must contain at least one child")
@@ -174,20 +223,38 @@ def validate_config(cfg: AppConfig) -> None:
                     raise ValueError(
                         f"sensors[{i}].join[{j}] '{c.name}': invalid provider '{c.provider}'"
                     )
+                if c.interval is not None and c.interval <= 0:
+                    raise ValueError(f"sensors[{i}].join[{j}] '{c.name}': interval must be > 0")
+
+    # commands: ensure unique ids across every submenu
+    _validate_commands(cfg.commands, "commands", set())
+    if count_menus(cfg.commands) > MAX_MENUS:
+        raise ValueError(f"commands: at most {MAX_MENUS} menus including the top one")
 
-    # commands: ensure unique ids
-    seen: set[str] = set()
-    for j, c in enumerate(cfg.commands):
+
+def _validate_commands(commands: list[CommandConfig], where: str, seen: set[str]) -> None:
+    for j, c in enumerate(commands):
         if not c.id:
-            raise ValueError(f"commands[{j}]: id must be non-empty")
+            raise ValueError(f"{where}[{j}]: id must be non-empty")
         if not c.label:
-            raise ValueError(f"commands[{j}]: label must be non-empty")
+            raise ValueError(f"{where}[{j}]: label must be non-empty")
+        if c.id.startswith(SUBMENU_PREFIX):
+            raise ValueError(f"{where}[{j}]: id must not start with '{SUBMENU_PREFIX}'")
         if c.id in seen:
-            raise ValueError(f"commands[{j}]: duplicate id '{c.id}'")
+            raise ValueError(f"{where}[{j}]: duplicate id '{c.id}'")
         seen.add(c.id)
         # exec can be None for placeholder items; when present, require non-empty
         if c.exec is not None and not c.exec.strip():
-            raise ValueError(f"commands[{j}]: exec must be non-empty when provided")
+            raise ValueError(f"{where}[{j}]: exec must be non-empty when provided")
+        if c.commands:
+            if c.exec is not None:
+                raise ValueError(f"{where}[{j}]: a submenu cannot have exec")
+            _validate_commands(c.commands, f"{where}[{j}].commands", seen)
+
+
+def count_menus(commands: list[CommandConfig]) -> int:
+    """The top menu plus every submenu below it."""
+    return 1 + sum(count_menus(c.commands) for c in commands if c.commands)
 
 
 def load_and_validate_config(path: str | Path) -> AppConfig:
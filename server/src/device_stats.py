@@ -0,0 +1,96 @@
+"""Runtime counters reported by the firmware.
+
+Firmware announcing `stats` in CAPS answers a `REQ STATS` text frame with
+one line:
+
+    STATS rx=.. ok=.. bad=.. lost=.. ovr=.. trunc=.. draws=.. draw_us=..
+          loop_us=.. enc=.. free=..
+
+The counters (frames parsed/applied/rejected/dropped, overrun bytes,
+truncated characters, screens drawn, encoder interrupts) count from boot and
+wrap at 16 bits, so DeviceStats reports what changed between two replies.
+`draw_us` and `loop_us` are the longest display and loop() passes since the
+previous reply; `free` is the least SRAM left free since boot (0 on the
+native simulator).
+"""
+
+from __future__ import annotations
+
+import threading
+from typing import Dict, List, Optional
+
+STATS_REQUEST = b"REQ STATS\n\n"
+
+COUNTERS = ("rx", "ok", "bad", "lost", "ovr", "trunc", "draws", "enc")
+# Any of these growing between two replies means frames or text were lost.
+TROUBLE = ("bad", "lost", "ovr", "trunc")
+# Less free SRAM than this and the next stack spike may corrupt statics.
+LOW_FREE_SRAM = 64
+
+
+def parse_stats(msg: str) -> Optional[Dict[str, int]]:
+    """The key=value pairs of a `STATS` line; None when it is not one."""
+    words = msg.split()
+    if not words or words[0] != "STATS":
+        return None
+    values: Dict[str, int] = {}
+    for word in words[1:]:
+        key, sep, value = word.partition("=")
+        if sep and value.isdigit():
+            values[key] = int(value)
+    return values
+
+
+class DeviceStats:
+    """The latest STATS reply, and how the counters moved since the one before."""
+
+    def __init__(self) -> None:
+        self._lock = threading.Lock()
+        self._last: Optional[Dict[str, int]] = None
+        self._delta: Dict[str, int] = {}
+
+    def reset(self) -> None:
+        """The device restarted: its counters start again from zero."""
+        with self._lock:
+            self._last = None
+            self._delta = {}
+
+    def update(self, values: Dict[str, int]) -> Dict[str, int]:
+        """Record a reply; returns the counter deltas (empty for the first)."""
+        with self._lock:
+            last = self._last
+            self._last = dict(values)
+            if last is None:
+                self._delta = {}
+            else:
+                self._delta = {
+                    k: (values[k] - last[k]) & 0xFFFF
+                    for k in COUNTERS
+                    if k in values and k in last
+                }
+            return dict(self._delta)
+
+    @property
+    def latest(self) -> Dict[str, int]:
+        with self._lock:
+            return dict(self._last or {})
+
+    def trouble(self) -> List[str]:
+        """Why the last reply looks unhealthy, one reason per entry."""
+        with self._lock:
+            reasons = [f"{k}+{self._delta[k]}" for k in TROUBLE if self._delta.get(k)]
+            free = (self._last or {}).get("free")
+        if free is not None and 0 < free < LOW_FREE_SRAM:
+            reasons.append(f"free={free}")
+        return reasons
+
+    def summary(self) -> str:
+        """Counter deltas as `key+n`, then the maxima and free SRAM as reported."""
+        with self._lock:
+            last = dict(self._last or {})
+            delta = dict(self._delta)
+        parts = [f"{k}+{delta[k]}" for k in COUNTERS if k in delta]
+        if not delta:
+            parts = [f"{k}={last[k]}" for k in COUNTERS if k in last]
+        parts += [f"{k}={last[k]}" for k in ("draw_us", "loop_us", "free") if k in last]
+        return " ".join(parts)
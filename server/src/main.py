@@ -5,14 +5,28 @@ import logging
 import sys
 import threading
 import time
-from typing import List, Optional
+from typing import Callable, List, Optional, Sequence
 
 import serial
 import subprocess
 
+from .baud import BaudNegotiator, hello_frame
 from .config import AppConfig, CommandConfig, SensorConfig, load_and_validate_config
-from .metrics import cpu_summary, gpu_summary, temp_summary
-from .protocol import Outbound
+from .device_stats import STATS_REQUEST, DeviceStats, parse_stats
+from .menus import PAGE_REQUEST, MenuTree, entry_line, parse_page_request
+from .metrics import cpu_fields, gpu_fields, temp_fields
+from .protocol import (
+    LCD_WIDTH,
+    DeltaEncoder,
+    Line,
+    NumericEncoder,
+    Outbound,
+    encode_commands_binary,
+    encode_telemetry,
+    render_line,
+)
+from .sampler import Reader, Sampler
+from .transmit import Priority, SerialLike, Transmitter
 
 
 def parse_args(argv: list[str]) -> argparse.Namespace:
@@ -52,15 +66,194 @@ def parse_args(argv: list[str]) -> argparse.Namespace:
     return p.parse_args(argv)
 
 
-def _encode_commands_frame(cmds: list[CommandConfig]) -> bytes:
-    lines = ["COMMANDS v1"]
-    for c in cmds:
-        # Format: "<id> <label>", truncate to LCD width
-        # Ensure no newlines sneak in
-        lid = str(c.id).replace("\n", " ").strip()
-        lbl = str(c.label).replace("\n", " ").strip()
-        lines.append(f"{lid} {lbl}"[:20])
-    return Outbound(lines=lines).encode()
+# Credits not returned within this long are assumed lost (a garbled ACK line).
+CREDIT_TIMEOUT = 2.0
+
+
+class DeviceLink:
+    """What the firmware told us about itself, shared by the reader and sender.
+
+    The firmware announces `CAPS <feature> ... [<limit>=<n> ...]` at boot and
+    whenever a META line carries `hello=1`; older sketches never answer, so they
+    keep receiving plain full text frames. Limits: `lines` is how many telemetry
+    lines the device keeps, `stage` how many one frame may carry, `cols` the
+    panel's line length (20 when not announced), `wide` the longest telemetry
+    line it keeps, scrolling whatever is past `cols`, `fields` how many numeric
+    fields a layout may have, `credits` how many telemetry frames may be in
+    flight, `baud` the fastest link rate (see baud.py). Firmware announcing
+    `num` (with `bin`) gets numeric telemetry as a layout plus values frames.
+
+    Flow control: with `credits` announced, each telemetry frame takes a
+    credit and the device returns them with `ACK <n>` once the frame is on
+    its display. Without credit the transmit queue holds the newest frame
+    back; after CREDIT_TIMEOUT without an ACK the credits are assumed lost.
+
+    Firmware announcing `stats` answers `REQ STATS`; the replies land in
+    `stats` (see device_stats.py).
+
+    Firmware announcing `menuhash` gets the menu digest in page frames and
+    may ask for a page it already shows with `have=` (see menus.py).
+    """
+
+    def __init__(
+        self,
+        framing: str = "auto",
+        clock: Callable[[], float] = time.monotonic,
+    ) -> None:
+        self._lock = threading.Lock()
+        self._caps: frozenset[str] | None = None
+        self._limits: dict[str, int] = {}
+        self._delta = DeltaEncoder()
+        self._numeric = NumericEncoder()
+        self._framing = framing
+        self._clock = clock
+        self._credits: int | None = None  # None: device without flow control
+        self._last_send = 0.0
+        self.stats = DeviceStats()
+        self._log = logging.getLogger(__name__)
+        self.on_credit: Callable[[], None] | None = None  # wakes the transmit queue
+        self.on_lost_credit: Callable[[], None] | None = None  # counts as a link error
+
+    @property
+    def caps_known(self) -> bool:
+        with self._lock:
+            return self._caps is not None
+
+    def has(self, cap: str) -> bool:
+        with self._lock:
+            return self._caps is not None and cap in self._caps
+
+    def limit(self, name: str) -> int | None:
+        with self._lock:
+            return self._limits.get(name)
+
+    @property
+    def width(self) -> int:
+        return self.limit("cols") or LCD_WIDTH
+
+    @property
+    def line_width(self) -> int:
+        """Longest telemetry line worth sending; menus stay within `width`."""
+        return self.limit("wide") or self.width
+
+    def set_caps(self, caps: list[str]) -> None:
+        features: list[str] = []
+        limits: dict[str, int] = {}
+        for cap in caps:
+            key, sep, value = cap.partition("=")
+            if not sep:
+                features.append(cap)
+            elif value.isdigit():
+                limits[key] = int(value)
+        with self._lock:
+            self._caps = frozenset(features)
+            self._limits = limits
+            cols = limits.get("cols") or LCD_WIDTH
+            self._delta.width = limits.get("wide") or cols
+            self._numeric.width = self._delta.width
+            self._numeric.cols = cols
+            self._numeric.max_fields = limits.get("fields", 0)
+            # A CAPS announcement means the device (re)started with a blank screen.
+            self._delta.reset()
+            self._numeric.reset()
+            self._credits = limits.get("credits")
+        self.stats.reset()
+        self._notify_credit()
+
+    @property
+    def binary(self) -> bool:
+        return self._framing == "auto" and self.has("bin")
+
+    def request_full(self) -> None:
+        with self._lock:
+            self._delta.reset()
+            self._numeric.reset()
+
+    def take_credit(self) -> bool:
+        """Spend a credit on the telemetry frame about to be written."""
+        lost = False
+        with self._lock:
+            if self._credits is None:
+                return True
+            now = self._clock()
+            if self._credits == 0:
+                if now - self._last_send < CREDIT_TIMEOUT:
+                    return False
+                self._log.warning(
+                    "no ACK from device for %.1fs; assuming lost credits", CREDIT_TIMEOUT
+                )
+                self._credits = self._limits.get("credits", 1)
+                lost = True
+            self._credits -= 1
+            self._last_send = now
+        if lost and self.on_lost_credit is not None:
+            self.on_lost_credit()
+        return True
+
+    def give_credits(self, n: int) -> None:
+        """Credits back from `ACK <n>`, or for a frame the device dropped."""
+        with self._lock:
+            if self._credits is None:
+                return
+            self._credits = min(self._credits + n, self._limits.get("credits", 1))
+        self._notify_credit()
+
+    @property
+    def credits(self) -> int | None:
+        with self._lock:
+            return self._credits
+
+    def _notify_credit(self) -> None:
+        if self.on_credit is not None:
+            self.on_credit()
+
+    def meta_line(self, cfg: AppConfig) -> str:
+        meta = f"META interval={cfg.interval:.3f}"
+        if not self.caps_known:
+            meta += " hello=1"
+        return meta
+
+    def encode_telemetry(self, cfg: AppConfig, lines: Sequence[str | Line]) -> bytes:
+        return b"".join(self.encode_telemetry_frames(cfg, lines))
+
+    def encode_telemetry_frames(
+        self, cfg: AppConfig, lines: Sequence[str | Line]
+    ) -> list[bytes]:
+        """The frames for one telemetry update; each spends a credit."""
+        binary = self.binary
+        meta = self.meta_line(cfg)
+        fields = [line if isinstance(line, list) else [line] for line in lines]
+        with self._lock:
+            capacity = self._limits.get("lines")
+            if capacity:
+                fields = fields[:capacity]
+            if binary and "num" in (self._caps or ()):
+                frames = self._numeric.encode_frames(
+                    cfg.interval, fields, self._limits.get("stage", 0)
+                )
+                if frames is not None:
+                    self._delta.reset()  # the screen moved on without it
+                    return frames
+                self._numeric.reset()
+            lines = [render_line(line) for line in fields]
+            if self._caps is not None and "delta" in self._caps:
+                update = self._delta.diff(lines)
+                parts = update.split(
+                    self._limits.get("stage", 0), self._limits.get("cols") or LCD_WIDTH
+                )
+                if binary:
+                    return [p.encode_binary(cfg.interval) for p in parts]
+                return [p.encode_text(meta) for p in parts]
+        return [encode_telemetry(meta, lines, self.line_width)]
+
+
+def _encode_commands_frame(
+    cmds: list[CommandConfig], binary: bool = False, width: int = LCD_WIDTH
+) -> bytes:
+    lines = [entry_line(c, width=width) for c in cmds]
+    if binary:
+        return encode_commands_binary(lines, width)
+    return Outbound(lines=["COMMANDS v1", *lines], width=width).encode()
 
 
 def _start_via_systemd(
@@ -113,15 +306,48 @@ def _maybe_execute(cmd: CommandConfig, allow: bool, driver: str, log: logging.Lo
 
 def _handle_incoming_line(
     line: str,
-    ser: serial.Serial,
+    ser: SerialLike,
     cfg: AppConfig,
     log: logging.Logger,
     allow_exec: bool = False,
     exec_driver: str = "shell",
+    link: DeviceLink | None = None,
+    baud: BaudNegotiator | None = None,
 ) -> None:
     msg = line.strip()
-    if msg == "REQ COMMANDS":
-        payload = _encode_commands_frame(cfg.commands)
+    if msg == "CAPS" or msg.startswith("CAPS "):
+        caps = msg.split()[1:]
+        log.info("device capabilities: %s", " ".join(caps) or "(none)")
+        if link is not None:
+            link.set_caps(caps)
+        if baud is not None:
+            rate = next((c[len("baud=") :] for c in caps if c.startswith("baud=")), "")
+            baud.on_caps(int(rate) if rate.isdigit() else None)
+        return
+    if msg.startswith("BAUD "):
+        rate = msg[len("BAUD ") :].strip()
+        if baud is not None and rate.isdigit():
+            baud.on_reply(int(rate))
+        return
+    if msg == "REQ FULL":
+        log.debug("device requested a full telemetry frame")
+        if link is not None:
+            link.request_full()
+        return
+    if msg == "REQ COMMANDS" or msg.startswith(PAGE_REQUEST):
+        tree = MenuTree(cfg.commands)
+        binary = link.binary if link is not None else False
+        width = link.width if link is not None else LCD_WIDTH
+        window = parse_page_request(msg)
+        if window is not None:
+            hashed = link is not None and link.has("menuhash")
+            payload = tree.encode_page(*window, binary=binary, width=width, hashed=hashed)
+        elif msg == "REQ COMMANDS":
+            # Firmware without paging takes every command in one flat list.
+            payload = _encode_commands_frame(tree.leaves(), binary=binary, width=width)
+        else:
+            log.debug("ignoring malformed request %r", msg)
+            return
         try:
             ser.write(payload)
             ser.flush()
@@ -130,20 +356,75 @@ def _handle_incoming_line(
         return
     if msg.startswith("SELECT "):
         sel = msg[len("SELECT ") :].strip()
-        cmd = next((c for c in cfg.commands if str(c.id) == sel), None)
+        cmd = MenuTree(cfg.commands).find(sel)
         label = cmd.label if cmd else ""
         log.info("selected id=%s label=%s", sel, label)
         if cmd is not None:
             _maybe_execute(cmd, allow_exec, exec_driver, log)
+        return
+    if msg.startswith("ACK "):
+        n = msg[len("ACK ") :].strip()
+        if link is not None and n.isdigit():
+            link.give_credits(int(n))
+        if baud is not None:
+            baud.on_link_ok()
+        return
+    if msg.startswith("RXOVR "):
+        lost = msg[len("RXOVR ") :].strip()
+        log.warning("device dropped a frame after RX overrun (lost bytes total=%s)", lost)
+        if link is not None:
+            link.request_full()
+            link.give_credits(1)  # the dropped frame is never acked
+        if baud is not None:
+            baud.on_link_error()
+        return
+    if msg == "NOSLOT":
+        # Its line arena was full, not the link: resend, but no strike on the rate.
+        log.info("device had no line slot for a frame; resending in full")
+        if link is not None:
+            link.request_full()
+            link.give_credits(1)
+        return
+    if msg.startswith("STATS "):
+        values = parse_stats(msg)
+        if link is None or values is None:
+            return
+        link.stats.update(values)
+        trouble = link.stats.trouble()
+        if trouble:
+            log.warning("device struggling (%s): %s", ", ".join(trouble), link.stats.summary())
+        else:
+            log.info("device stats: %s", link.stats.summary())
+        return
+    if msg.startswith("BADFRAME "):
+        count = msg[len("BADFRAME ") :].strip()
+        log.warning("device rejected a corrupted frame (total=%s)", count)
+        if link is not None:
+            link.request_full()
+            link.give_credits(1)
+        if baud is not None:
+            baud.on_link_error()
+        return
+    # The firmware only prints ASCII text. Bytes that did not decode (U+FFFD)
+    # or are not printable mean the rates disagree; anything else is just a
+    # line this daemon has no use for, like "Starting up" or FLUSH traces.
+    if msg.isascii() and msg.isprintable():
+        log.debug("ignored device line: %s", msg)
+        return
+    if baud is not None:
+        baud.on_link_error()
 
 
 def _reader(
     ser: serial.Serial,
+    out: SerialLike,
     stop: threading.Event,
     cfg: AppConfig,
     log: logging.Logger,
     allow_exec: bool,
     exec_driver: str,
+    link: DeviceLink,
+    baud: BaudNegotiator | None = None,
 ) -> None:  # pragma: no cover
     while not stop.is_set():
         try:
@@ -153,7 +434,14 @@ def _reader(
                     text = line.decode(errors="replace").rstrip()
                     log.debug("arduino line: %s", text)
                     _handle_incoming_line(
-                        text, ser, cfg, log, allow_exec=allow_exec, exec_driver=exec_driver
+                        text,
+                        out,
+                        cfg,
+                        log,
+                        allow_exec=allow_exec,
+                        exec_driver=exec_driver,
+                        link=link,
+                        baud=baud,
                     )
                 except Exception:
                     log.debug("arduino raw bytes: %r", line)
@@ -162,54 +450,83 @@ def _reader(
             break
 
 
-def _sensor_text(s: SensorConfig) -> Optional[str]:
+def _sensor_fields(s: SensorConfig) -> Optional[Line]:
     if not s.enabled:
         return None
     if s.provider == "cpu":
-        return cpu_summary()
+        return cpu_fields()
     if s.provider == "gpu":
-        return gpu_summary()
+        return gpu_fields()
     if s.provider == "temp":
         chip = str(s.params.get("chip")) if s.params.get("chip") is not None else None
         label = str(s.params.get("label")) if s.params.get("label") is not None else None
-        return temp_summary(chip=chip, label=label)
+        return temp_fields(chip=chip, label=label)
     return None
 
 
-def _collect_lines(cfg: AppConfig) -> List[str]:
-    lines: List[str] = []
+def _collect_lines(cfg: AppConfig, width: int = LCD_WIDTH) -> List[str]:
+    return [render_line(line)[:width] for line in _collect_fields(cfg)]
+
+
+def _collect_fields(cfg: AppConfig, read: Reader = _sensor_fields) -> List[Line]:
+    """Sensor lines with their numbers kept as Fields; the encoder cuts them to width.
+
+    `read` yields one sensor's fields: a direct read, or Sampler.get for the
+    cached value while the daemon runs.
+    """
+    lines: List[Line] = []
     limit = cfg.max_lines - 1 if cfg.max_lines > 1 else 1
     for s in cfg.sensors:
         if not s.enabled:
             continue
         # Join mode: combine child sensors into one line
         if s.provider == "join" or s.join:
-            parts: list[str] = []
+            line: Line = []
             for child in s.join:
-                t = _sensor_text(child)
-                if t is None:
+                part = read(child)
+                if part is None:
                     continue
-                part = t
+                if line:
+                    line.append(" ")
                 if child.name:
-                    part = f"{child.name} {part}"
-                parts.append(part)
-            if not parts:
+                    line.append(f"{child.name} ")
+                line.extend(part)
+            if not line:
                 continue
-            text = " ".join(parts)
             if s.name:
-                text = f"{s.name} {text}"
+                line.insert(0, f"{s.name} ")
         else:
-            text = _sensor_text(s)
-            if text is None:
+            fields = read(s)
+            if fields is None:
                 continue
-            text = f"{s.name} {text}"
-        # Truncate to LCD width here already
-        lines.append(text[:20])
+            line = [f"{s.name} ", *fields]
+        lines.append(line)
         if len(lines) >= limit:
             break
     return lines
 
 
+# How often the transmit queue's depth and wait times are logged (INFO).
+TX_STATS_PERIOD = 60.0
+TX_DRAIN_TIMEOUT = 5.0
+
+
+def _telemetry_job(
+    link: DeviceLink, cfg: AppConfig, lines: List[Line], log: logging.Logger
+) -> Callable[[], list[bytes]]:
+    def encode() -> list[bytes]:
+        frames = link.encode_telemetry_frames(cfg, lines)
+        log.debug(
+            "encoded %d line(s) as %d frame(s), %d byte(s)",
+            len(lines),
+            len(frames),
+            sum(len(f) for f in frames),
+        )
+        return frames
+
+    return encode
+
+
 def main(argv: list[str]) -> int:
     args = parse_args(argv)
     # Logging: minimal by default (ERROR). --verbose switches to INFO unless --log-level overrides.
@@ -256,6 +573,23 @@ def main(argv: list[str]) -> int:
     if ser is None:
         return 3
 
+    link = DeviceLink(framing=cfg.serial.framing)
+    sampler = Sampler(cfg, _sensor_fields)
+    sampler.start()
+    baud: BaudNegotiator | None = None
+
+    def gate() -> bool:
+        # A rate switch holds telemetry back before it can spend a credit.
+        return (baud is None or baud.ready()) and link.take_credit()
+
+    tx = Transmitter(ser, gate=gate)
+    link.on_credit = tx.wake
+    if cfg.serial.max_baud > cfg.serial.baud:
+        baud = BaudNegotiator(
+            ser, tx, link, cfg.serial.baud, cfg.serial.max_baud, hello_frame(cfg.interval)
+        )
+        link.on_lost_credit = baud.on_link_error
+    tx.start()
     try:
         reader_stop = threading.Event()
         reader_thread: threading.Thread | None = None
@@ -264,29 +598,54 @@ def main(argv: list[str]) -> int:
                 target=_reader,
                 args=(
                     ser,
+                    tx,
                     reader_stop,
                     cfg,
                     log,
                     bool(args.allow_exec),
                     str(args.exec_driver),
+                    link,
+                    baud,
                 ),
                 daemon=True,
             )
             reader_thread.start()
+        # Frames only read the sampler's cache; give the first reads one
+        # interval to land, then keep a fixed cadence.
+        sampler.wait_ready(cfg.interval)
+        next_at = time.monotonic()
+        stats_at = next_at + TX_STATS_PERIOD
+        poll_at = next_at + cfg.serial.stats_interval
         while True:
-            lines = _collect_lines(cfg)
-            lines.insert(0, f"META interval={cfg.interval:.3f}")
-            payload = Outbound(lines=lines).encode()
-            ser.write(payload)
-            ser.flush()
-            if log.isEnabledFor(logging.INFO):
-                log.debug("sent %d line(s)", len(lines))
+            tx.raise_if_failed()
+            lines = _collect_fields(cfg, sampler.get)
+            # Encoded by the writer when it goes out; a frame still waiting
+            # then is replaced by this one.
+            tx.submit(_telemetry_job(link, cfg, lines, log), Priority.TELEMETRY, key="telemetry")
             if args.once:
+                tx.drain(TX_DRAIN_TIMEOUT)
+                tx.raise_if_failed()
                 return 0
-            time.sleep(cfg.interval)
+            if time.monotonic() >= stats_at:
+                log.info("tx queue: %s", tx.stats().summary())
+                stats_at += TX_STATS_PERIOD
+            if cfg.serial.stats_interval > 0 and time.monotonic() >= poll_at:
+                # Not during a rate switch: the request would cross garbled.
+                if link.has("stats") and (baud is None or baud.ready()):
+                    tx.submit(STATS_REQUEST, Priority.INTERACTIVE, key="stats")
+                poll_at += cfg.serial.stats_interval
+            next_at += cfg.interval
+            now = time.monotonic()
+            if next_at < now:
+                next_at = now  # a stalled write; do not burst to catch up
+            time.sleep(next_at - now)
     except KeyboardInterrupt:
         return 0
     finally:
+        sampler.stop()
+        if baud is not None:
+            baud.stop()
+        tx.stop()
         try:
             try:
                 reader_stop.set()
@@ -0,0 +1,142 @@
+"""Command menus served to the firmware a page at a time.
+
+`commands` in the config is a tree: an entry with `commands` of its own is a
+submenu. Menus are numbered depth-first with the top menu as 0, so the
+numbers stay the same for as long as the config does. The firmware asks for
+a window of one menu,
+
+    REQ COMMANDS <menu> <offset> <count>
+
+and gets a page frame back: `PAGE <menu> <parent> <offset> <total>`, then an
+`<id> <label>` line per entry (binary 'P', see docs/adr/0001-protocol.md). A
+submenu entry's id is `@<menu>`, `parent` is the menu Back returns to and
+`total` the number of entries, so the device only ever holds the entries it
+shows. An unknown menu gets an empty page with parent 0, which sends the
+device back to the top.
+
+Firmware announcing `menuhash` in CAPS gets the tree's digest after `total`
+and keeps the top menu's first page when the menu closes. Opening it again
+shows that page at once and asks `REQ COMMANDS 0 0 <count> have=<digest>`;
+while the digest still matches, the answer is the page header alone.
+"""
+
+from __future__ import annotations
+
+from dataclasses import dataclass
+from typing import NamedTuple
+
+from .config import SUBMENU_PREFIX, CommandConfig
+from .protocol import LCD_WIDTH, crc16_ccitt, encode_page
+
+PAGE_REQUEST = "REQ COMMANDS "
+HAVE_PREFIX = "have="
+
+
+@dataclass
+class Menu:
+    parent: int
+    entries: list[CommandConfig]
+
+
+def entry_line(entry: CommandConfig, menu: int | None = None, width: int = LCD_WIDTH) -> str:
+    """`<id> <label>`, or `@<menu> <label>` for a submenu, cut to `width`."""
+    cid = f"{SUBMENU_PREFIX}{menu}" if menu is not None else str(entry.id)
+    # Ensure no newlines sneak in
+    lid = cid.replace("\n", " ").strip()
+    lbl = str(entry.label).replace("\n", " ").strip()
+    return f"{lid} {lbl}"[:width]
+
+
+class PageRequest(NamedTuple):
+    menu: int
+    offset: int
+    count: int
+    have: int | None = None  # digest of the page the device already shows
+
+
+def parse_page_request(msg: str) -> PageRequest | None:
+    """The window a paged `REQ COMMANDS` asks for; None for anything else."""
+    if not msg.startswith(PAGE_REQUEST):
+        return None
+    words = msg[len(PAGE_REQUEST) :].split()
+    have = None
+    if len(words) == 4 and words[3].startswith(HAVE_PREFIX):
+        digest = words.pop()[len(HAVE_PREFIX) :]
+        if not digest.isdigit():
+            return None
+        have = int(digest)
+    if len(words) != 3 or not all(w.isdigit() for w in words):
+        return None
+    menu, offset, count = (int(w) for w in words)
+    return PageRequest(menu, offset, count, have)
+
+
+class MenuTree:
+    """The config's command tree, numbered for the wire."""
+
+    def __init__(self, commands: list[CommandConfig]) -> None:
+        self.menus: list[Menu] = []
+        self._numbers: dict[int, int] = {}  # id() of a submenu entry -> its menu
+        self._add(commands, 0)
+
+    def _add(self, entries: list[CommandConfig], parent: int) -> int:
+        number = len(self.menus)
+        self.menus.append(Menu(parent=parent, entries=entries))
+        for entry in entries:
+            if entry.commands:
+                self._numbers[id(entry)] = self._add(entry.commands, number)
+        return number
+
+    def submenu(self, entry: CommandConfig) -> int | None:
+        """Menu number an entry opens; None for a command."""
+        return self._numbers.get(id(entry))
+
+    def leaves(self) -> list[CommandConfig]:
+        """Every command that can be selected, depth-first."""
+        out: list[CommandConfig] = []
+
+        def walk(entries: list[CommandConfig]) -> None:
+            for entry in entries:
+                if entry.commands:
+                    walk(entry.commands)
+                else:
+                    out.append(entry)
+
+        walk(self.menus[0].entries)
+        return out
+
+    def find(self, cid: str) -> CommandConfig | None:
+        return next((c for c in self.leaves() if str(c.id) == cid), None)
+
+    def digest(self) -> int:
+        """16-bit hash of every menu as the device would show it; never 0."""
+        text = "\n".join(
+            f"{m.parent}:" + "|".join(entry_line(e, self.submenu(e), width=255) for e in m.entries)
+            for m in self.menus
+        )
+        return crc16_ccitt(text.encode()) or 1
+
+    def encode_page(
+        self,
+        menu: int,
+        offset: int,
+        count: int,
+        have: int | None = None,
+        binary: bool = False,
+        width: int = LCD_WIDTH,
+        hashed: bool = False,
+    ) -> bytes:
+        """Entries [offset, offset + count) of `menu` as a page frame.
+
+        With `hashed` the frame carries digest(); when `have` equals it the
+        device's copy is current and the entries are left out.
+        """
+        digest = self.digest() if hashed else None
+        if menu >= len(self.menus):
+            return encode_page(menu & 0xFF, 0, min(offset, 0xFFFF), 0, [], binary, width, digest)
+        m = self.menus[menu]
+        lines = [entry_line(e, self.submenu(e), width) for e in m.entries[offset : offset + count]]
+        if digest is not None and have == digest:
+            lines = []
+        total = min(len(m.entries), 0xFFFF)
+        return encode_page(menu, m.parent, min(offset, 0xFFFF), total, lines, binary, width, digest)
@@ -4,10 +4,7 @@ import subprocess
 import psutil
 from typing import Optional, Iterable, Any
 
-
-def _pad3(n: int) -> str:
-    # Right-align in width 3
-    return f"{n:>3d}"
+from .protocol import Field, Line, render_line
 
 
 def _prefer_coretemp_package(temps: dict[str, Iterable[Any]]) -> Optional[int]:
@@ -27,6 +24,11 @@ def _prefer_coretemp_package(temps: dict[str, Iterable[Any]]) -> Optional[int]:
 
 
 def cpu_summary() -> str:
+    return render_line(cpu_fields())
+
+
+def cpu_fields() -> Line:
+    """CPU load, memory use and package temperature: "cpu% mem% tempC"."""
     temp_val: Optional[int] = None
     try:
         temps = psutil.sensors_temperatures(fahrenheit=False)
@@ -45,10 +47,10 @@ def cpu_summary() -> str:
         cpu = int(round(psutil.cpu_percent(interval=None)))
     except Exception:
         cpu = 0
-    parts = [f"{_pad3(cpu)}%", f"{_pad3(mem)}%"]
+    parts: Line = [Field(cpu, history=True), "% ", Field(mem), "%"]
     if temp_val is not None:
-        parts.append(f"{_pad3(temp_val)}C")
-    return " ".join(parts)
+        parts += [" ", Field(temp_val, history=True), "C"]
+    return parts
 
 
 def _load_nvml():
@@ -74,12 +76,22 @@ def _load_nvml():
         return None
 
 
+def _gpu_line(util: int, mem_pct: int, temp: int) -> Line:
+    return [Field(util, history=True), "% ", Field(mem_pct), "% ", Field(temp), "C"]
+
+
 def gpu_summary() -> Optional[str]:
     """Return GPU summary using NVML, with nvidia-smi fallback.
 
     Output format: "gpu% mem% tempC" (each right-aligned to width 3).
     Returns None if no GPU metrics are available.
     """
+    line = gpu_fields()
+    return None if line is None else render_line(line)
+
+
+def gpu_fields() -> Optional[Line]:
+    """gpu_summary() as a line with numeric fields."""
     nvml = _load_nvml()
     if nvml is not None:
         try:
@@ -94,7 +106,7 @@ def gpu_summary() -> Optional[str]:
                     mem_pct = int(round((mem.used / mem.total) * 100))
             except Exception:
                 mem_pct = 0
-            return f"{_pad3(int(util.gpu))}% {_pad3(mem_pct)}% {_pad3(int(temp))}C"
+            return _gpu_line(int(util.gpu), mem_pct, int(temp))
         except Exception:
             pass
         finally:
@@ -107,10 +119,14 @@ def gpu_summary() -> Optional[str]:
     return _gpu_summary_nvidia_smi()
 
 
-def _gpu_summary_nvidia_smi() -> Optional[str]:
+# A wedged driver can hang nvidia-smi; give up and report no GPU for this read.
+NVIDIA_SMI_TIMEOUT = 5.0
+
+
+def _gpu_summary_nvidia_smi() -> Optional[Line]:
     """Query nvidia-smi for utilization, memory and temperature.
 
-    Returns formatted string or None if nvidia-smi is not available or parsing fails.
+    Returns the line or None if nvidia-smi is not available or parsing fails.
     """
     try:
         # Query without units, CSV no header: util.gpu, mem.used, mem.total, temp.gpu
@@ -123,6 +139,7 @@ def _gpu_summary_nvidia_smi() -> Optional[str]:
             capture_output=True,
             text=True,
             check=True,
+            timeout=NVIDIA_SMI_TIMEOUT,
         )
         line = res.stdout.strip().splitlines()[0]
         parts = [p.strip() for p in line.split(",")]
@@ -133,7 +150,7 @@ def _gpu_summary_nvidia_smi() -> Optional[str]:
         mem_total = float(parts[2])
         temp = int(round(float(parts[3])))
         mem_pct = int(round((mem_used / mem_total) * 100)) if mem_total else 0
-        return f"{_pad3(gpu_util)}% {_pad3(mem_pct)}% {_pad3(temp)}C"
+        return _gpu_line(gpu_util, mem_pct, temp)
     except Exception:
         return None
 
@@ -153,6 +170,12 @@ def temp_summary(chip: Optional[str] = None, label: Optional[str] = None) -> Opt
     - chip: substring to match chip key (e.g., "coretemp", "nvme").
     - label: exact label match within that chip (e.g., "Package id 0", "Composite").
     """
+    line = temp_fields(chip, label)
+    return None if line is None else render_line(line)
+
+
+def temp_fields(chip: Optional[str] = None, label: Optional[str] = None) -> Optional[Line]:
+    """temp_summary() as a line with a numeric field."""
     temps = psutil.sensors_temperatures(fahrenheit=False)
     items = temps.items()
     for key, arr in items:
@@ -163,9 +186,9 @@ def temp_summary(chip: Optional[str] = None, label: Optional[str] = None) -> Opt
             if labeled:
                 val = _pick_temp_entry(labeled)
                 if val is not None:
-                    return f"{_pad3(val)}C"
+                    return [Field(val, history=True), "C"]
             # fall through to try any entry if no exact label found
         val = _pick_temp_entry(arr)
         if val is not None:
-            return f"{_pad3(val)}C"
+            return [Field(val, history=True), "C"]
     return None
@@ -1,16 +1,366 @@
-from dataclasses import dataclass
+import binascii
+from dataclasses import dataclass, field
+from typing import Union
 
-START = b"\x02"  # optional if you later want binary framing
-END = b"\x03"  # not used in line mode yet
+# Binary framing: STX type len(u16 LE) payload CRC16(BE) ETX, see docs/adr/0001-protocol.md
+START = b"\x02"
+END = b"\x03"
 
-# Start with simple line mode: join lines with "\n" and end with an extra blank line
+FRAME_TELEMETRY = ord("T")
+FRAME_DELTA = ord("D")
+FRAME_KEEPALIVE = ord("K")
+FRAME_COMMANDS = ord("C")
+FRAME_PAGE = ord("P")
+FRAME_LAYOUT = ord("L")
+FRAME_VALUES = ord("V")
+FRAME_BAUD = ord("B")
+
+LCD_WIDTH = 20
+DELTA_HEADER = "DELTA"
+PAGE_HEADER = "PAGE"
+
+# Text mode: join lines with "\n" and end with an extra blank line
 
 
 @dataclass
 class Outbound:
     lines: list[str]
+    width: int = LCD_WIDTH
 
     def encode(self) -> bytes:
-        # Truncate to 20 chars per LCD line
-        norm = [(s[:20] if len(s) > 20 else s) for s in self.lines]
+        # Truncate to the LCD line width
+        norm = [s[: self.width] for s in self.lines]
         return ("\n".join(norm) + "\n\n").encode()
+
+
+def encode_telemetry(meta: str, lines: list[str], width: int = LCD_WIDTH) -> bytes:
+    """Frame a META line plus LCD lines of at most `width` chars.
+
+    META is never displayed, so it is exempt from the line width; firmware
+    that only understands `interval=` ignores keys past the first 20 chars.
+    """
+    body = [meta, *(s[:width] for s in lines)]
+    return ("\n".join(body) + "\n\n").encode()
+
+
+def crc16_ccitt(data: bytes) -> int:
+    """CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF); matches arduino/include/Crc16.h."""
+    return binascii.crc_hqx(data, 0xFFFF)
+
+
+def encode_binary(frame_type: int, payload: bytes) -> bytes:
+    header = bytes([frame_type]) + len(payload).to_bytes(2, "little")
+    crc = crc16_ccitt(header + payload)
+    return START + header + payload + crc.to_bytes(2, "big") + END
+
+
+def _binary_text(text: str, width: int = LCD_WIDTH) -> bytes:
+    raw = text[:width].encode()[:width]
+    return bytes([len(raw)]) + raw
+
+
+def _interval_ms(interval: float) -> bytes:
+    ms = max(0, min(int(round(interval * 1000)), 0xFFFF))
+    return ms.to_bytes(2, "little")
+
+
+def encode_baud(rate: int) -> bytes:
+    """Ask the device to move the link to `rate`; it answers `BAUD <rate>` first."""
+    return encode_binary(FRAME_BAUD, rate.to_bytes(4, "little"))
+
+
+def encode_commands_binary(lines: list[str], width: int = LCD_WIDTH) -> bytes:
+    return encode_binary(FRAME_COMMANDS, b"".join(_binary_text(s, width) for s in lines))
+
+
+def encode_page(
+    menu: int,
+    parent: int,
+    offset: int,
+    total: int,
+    lines: list[str],
+    binary: bool = False,
+    width: int = LCD_WIDTH,
+    digest: int | None = None,
+) -> bytes:
+    """One window of a command menu (see menus.py).
+
+    `digest` (the menu tree's hash) goes after `total` for firmware that
+    caches the menu. The text header is not shown but is read into a line
+    slot, so it has to fit in `width` chars like any line; a digest that
+    would not fit is left off and the device caches nothing.
+    """
+    if binary:
+        head = bytes([menu, parent]) + offset.to_bytes(2, "little") + total.to_bytes(2, "little")
+        if digest is not None:
+            head += digest.to_bytes(2, "little")
+        body = b"".join(_binary_text(s, width) for s in lines)
+        return encode_binary(FRAME_PAGE, head + body)
+    header = f"{PAGE_HEADER} {menu} {parent} {offset} {total}"
+    if digest is not None and len(header) + 1 + len(str(digest)) <= width:
+        header += f" {digest}"
+    body = [header, *(s[:width] for s in lines)]
+    return ("\n".join(body) + "\n\n").encode()
+
+
+def _stage_chunks(
+    changes: list[tuple[int, str]], stage: int, cols: int
+) -> list[list[tuple[int, str]]]:
+    """Group lines into runs that fit `stage` arena slots of `cols` chars."""
+    if stage <= 0 or not changes:
+        return [changes]
+    chunks: list[list[tuple[int, str]]] = []
+    used = 0
+    for change in changes:
+        need = max(1, -(-len(change[1]) // cols)) if cols > 0 else 1
+        if chunks and used + need <= stage:
+            chunks[-1].append(change)
+            used += need
+        else:
+            chunks.append([change])
+            used = need
+    return chunks
+
+
+@dataclass
+class TelemetryUpdate:
+    """What changed between the device's screen and the new lines."""
+
+    full: bool
+    total: int
+    changes: list[tuple[int, str]]  # (index, text); every line when full
+    resized: bool = False  # line count differs from the device's screen
+    resync: bool = True  # full frame because the device's screen is unknown
+    width: int = LCD_WIDTH  # the device's line length (`cols=` in CAPS)
+
+    def split(self, stage: int, cols: int = 0) -> list["TelemetryUpdate"]:
+        """Break the update into frames that fit `stage` slots of `cols` chars.
+
+        The firmware stages a frame's lines in free slots of a shared arena and
+        advertises how many it can always hold (`stage=` in CAPS); a line
+        longer than `cols` takes a slot per `cols` chars. A resync becomes a
+        full frame of the first lines that fit plus deltas for the rest; a
+        periodic refresh of a synced screen goes out as deltas only, so the
+        device never shrinks what it shows. `cols` 0 counts one slot per line.
+        """
+        chunks = _stage_chunks(self.changes, stage, cols)
+        if len(chunks) <= 1:
+            return [self]
+        parts: list[TelemetryUpdate] = []
+        if self.full and self.resync:
+            head = chunks.pop(0)
+            parts.append(
+                TelemetryUpdate(full=True, total=len(head), changes=head, width=self.width)
+            )
+        parts.extend(
+            TelemetryUpdate(
+                full=False, total=self.total, changes=chunk, resized=True, width=self.width
+            )
+            for chunk in chunks
+        )
+        return parts
+
+    def encode_text(self, meta: str) -> bytes:
+        if self.full:
+            return encode_telemetry(meta, [text for _, text in self.changes], self.width)
+        if not self.changes and not self.resized:
+            return encode_telemetry(meta, [])
+        out = [meta, f"{DELTA_HEADER} {self.total}"]
+        # Delta lines carry an index prefix on top of the LCD chars.
+        out.extend(f"{i} {text}" for i, text in self.changes)
+        return ("\n".join(out) + "\n\n").encode()
+
+    def encode_binary(self, interval: float) -> bytes:
+        head = _interval_ms(interval)
+        if self.full:
+            body = b"".join(_binary_text(text, self.width) for _, text in self.changes)
+            return encode_binary(FRAME_TELEMETRY, head + body)
+        if not self.changes and not self.resized:
+            return encode_binary(FRAME_KEEPALIVE, head)
+        body = b"".join(bytes([i]) + _binary_text(text, self.width) for i, text in self.changes)
+        return encode_binary(FRAME_DELTA, head + bytes([self.total]) + body)
+
+
+@dataclass
+class DeltaEncoder:
+    """Send only the telemetry lines that changed since the device's last screen.
+
+    Text frame layout (after the META line):
+      DELTA <total>
+      <index> <text>   (one per changed line; index is 0-based)
+
+    `total` lets the device grow or shrink its buffer. With no changes only the
+    META keepalive is sent. A full frame goes out first, after reset() (device
+    asked for it or lost bytes), and every `refresh_every` frames as a safety net.
+    Lines are cut to `width`, the device's line length.
+    """
+
+    refresh_every: int = 60
+    width: int = LCD_WIDTH
+    _shown: list[str] | None = field(default=None, init=False, repr=False)
+    _since_full: int = field(default=0, init=False, repr=False)
+
+    def reset(self) -> None:
+        self._shown = None
+
+    def diff(self, lines: list[str]) -> TelemetryUpdate:
+        norm = [s[: self.width] for s in lines]
+        shown = self._shown
+        self._shown = norm
+        if shown is None or self._since_full >= self.refresh_every:
+            self._since_full = 0
+            return TelemetryUpdate(
+                full=True,
+                total=len(norm),
+                changes=list(enumerate(norm)),
+                resync=shown is None,
+                width=self.width,
+            )
+
+        self._since_full += 1
+        changes = [
+            (i, text) for i, text in enumerate(norm) if i >= len(shown) or shown[i] != text
+        ]
+        return TelemetryUpdate(
+            full=False,
+            total=len(norm),
+            changes=changes,
+            resized=len(norm) != len(shown),
+            width=self.width,
+        )
+
+    def encode(self, meta: str, lines: list[str]) -> bytes:
+        return self.diff(lines).encode_text(meta)
+
+
+@dataclass(frozen=True)
+class Field:
+    """A number the firmware can print itself (see arduino/include/NumericLayout.h).
+
+    `value` is sent as int16 with `decimals` implied decimal places and printed
+    right-aligned in `width` chars; one that does not fit shows as '#'s.
+    `history` asks the firmware to keep recent samples for its history view
+    (arduino/include/MetricHistory.h; the first three flagged fields count).
+    """
+
+    value: int
+    width: int = 3
+    decimals: int = 0
+    history: bool = False
+
+    @property
+    def fmt(self) -> int:
+        flags = 0x40 if self.history else 0
+        return (self.width & 0x0F) | ((self.decimals & 0x03) << 4) | flags
+
+    def render(self) -> str:
+        v = max(-0x8000, min(int(self.value), 0x7FFF))
+        digits = str(abs(v))
+        if self.decimals:
+            digits = digits.rjust(self.decimals + 1, "0")
+            digits = f"{digits[: -self.decimals]}.{digits[-self.decimals :]}"
+        text = f"-{digits}" if v < 0 else digits
+        return "#" * self.width if len(text) > self.width else text.rjust(self.width)
+
+
+# One LCD line: literal text (labels, units) and numeric fields.
+Line = list[Union[str, Field]]
+
+
+def render_line(line: Line) -> str:
+    return "".join(seg if isinstance(seg, str) else seg.render() for seg in line)
+
+
+@dataclass
+class NumericEncoder:
+    """Send numeric telemetry as a cached layout plus (field, value) pairs.
+
+    The layout frame carries the rendered lines and where each Field sits
+    (line, column, format); the firmware keeps the positions. While the text
+    around the fields stays the same, each interval only sends a values frame
+    with the fields that changed: 3 bytes per metric. A new layout id goes out
+    whenever the literal text or the field positions change, after reset(),
+    and every `refresh_every` frames the current layout is resent.
+
+    Lines are cut at `width`; fields must also fit within the panel's `cols`
+    (the device scrolls anything past it) or are rendered into the layout
+    text instead.
+    encode() returns None when more than `max_fields` fields remain; the
+    caller then falls back to text frames.
+    """
+
+    refresh_every: int = 60
+    width: int = LCD_WIDTH
+    cols: int = LCD_WIDTH
+    max_fields: int = 0
+    _key: tuple[object, ...] | None = field(default=None, init=False, repr=False)
+    _id: int = field(default=0, init=False, repr=False)
+    _values: list[int] = field(default_factory=list, init=False, repr=False)
+    _since_full: int = field(default=0, init=False, repr=False)
+
+    def reset(self) -> None:
+        self._key = None
+
+    def _layout(self, lines: list[Line]) -> tuple[list[str], list[tuple[int, int, Field]]]:
+        texts: list[str] = []
+        fields: list[tuple[int, int, Field]] = []
+        room = min(self.width, self.cols)
+        for index, line in enumerate(lines):
+            text = ""
+            for seg in line:
+                if isinstance(seg, Field) and len(text) + seg.width <= room:
+                    fields.append((index, len(text), seg))
+                    text += seg.render()
+                else:
+                    text += seg if isinstance(seg, str) else seg.render()
+            texts.append(text[: self.width])
+        return texts, fields
+
+    def encode(self, interval: float, lines: list[Line], stage: int = 0) -> bytes | None:
+        frames = self.encode_frames(interval, lines, stage)
+        return None if frames is None else b"".join(frames)
+
+    def encode_frames(
+        self, interval: float, lines: list[Line], stage: int = 0
+    ) -> list[bytes] | None:
+        """encode(), one entry per frame: each spends a device credit."""
+        texts, fields = self._layout(lines)
+        if len(fields) > self.max_fields:
+            return None
+        values = [max(-0x8000, min(f.value, 0x7FFF)) for _, _, f in fields]
+        # What the device keeps: the text with every field blanked, and where they sit.
+        blanked = list(texts)
+        for line, col, f in fields:
+            text = blanked[line]
+            blanked[line] = text[:col] + "\0" * f.width + text[col + f.width :]
+        key = (tuple(blanked), tuple((line, col, f.fmt) for line, col, f in fields))
+        head = _interval_ms(interval)
+        if key != self._key or self._since_full >= self.refresh_every:
+            if key != self._key:
+                self._id = self._id % 255 + 1
+            self._key = key
+            self._values = values
+            self._since_full = 0
+            return self._encode_layout(head, texts, fields, stage)
+
+        self._since_full += 1
+        changed = [(i, v) for i, v in enumerate(values) if v != self._values[i]]
+        self._values = values
+        body = b"".join(bytes([i]) + (v & 0xFFFF).to_bytes(2, "little") for i, v in changed)
+        return [encode_binary(FRAME_VALUES, head + bytes([self._id]) + body)]
+
+    def _encode_layout(
+        self, head: bytes, texts: list[str], fields: list[tuple[int, int, Field]], stage: int
+    ) -> list[bytes]:
+        # Lines past the stage follow as deltas, as TelemetryUpdate.split() does.
+        count = len(_stage_chunks(list(enumerate(texts)), stage, self.cols)[0])
+        table = b"".join(bytes([line, col, f.fmt]) for line, col, f in fields)
+        body = b"".join(_binary_text(t, self.width) for t in texts[:count])
+        out = [encode_binary(FRAME_LAYOUT, head + bytes([self._id, len(fields)]) + table + body)]
+        rest = list(enumerate(texts))[count:]
+        if rest:
+            tail = TelemetryUpdate(
+                full=False, total=len(texts), changes=rest, resized=True, width=self.width
+            )
+            out.extend(p.encode_binary(0) for p in tail.split(stage, self.cols))
+        return out
@@ -0,0 +1,118 @@
+"""Background sensor sampling with a last-value cache.
+
+Every leaf sensor (a top-level sensor or a join child) gets its own worker
+thread that reads it every `interval` seconds (the sensor's own, else the
+frame interval) and stores the result. The frame loop only reads the cache,
+so a slow NVML call, an `nvidia-smi` fork or a sluggish hwmon read delays
+that sensor's next value, never the frame.
+"""
+
+from __future__ import annotations
+
+import logging
+import threading
+import time
+from typing import Callable, Dict, List, Optional, Tuple
+
+from .config import AppConfig, SensorConfig
+from .protocol import Line
+
+Reader = Callable[[SensorConfig], Optional[Line]]
+
+# A cached value older than this many of its sensor's intervals is dropped,
+# so a wedged sensor disappears from the screen instead of freezing on it.
+STALE_INTERVALS = 3.0
+
+
+def leaf_sensors(cfg: AppConfig) -> List[SensorConfig]:
+    """The sensors that are actually read: enabled top-level ones and join children."""
+    leaves: List[SensorConfig] = []
+    for s in cfg.sensors:
+        if not s.enabled:
+            continue
+        if s.provider == "join" or s.join:
+            leaves.extend(c for c in s.join if c.enabled)
+        else:
+            leaves.append(s)
+    return leaves
+
+
+class Sampler:
+    """Per-sensor worker threads feeding a last-value cache.
+
+    `get` has the signature of the direct reader, so the frame builder takes
+    either one.
+    """
+
+    def __init__(
+        self,
+        cfg: AppConfig,
+        read: Reader,
+        clock: Callable[[], float] = time.monotonic,
+    ) -> None:
+        self._read = read
+        self._clock = clock
+        self._lock = threading.Lock()
+        self._stop = threading.Event()
+        self._sensors = leaf_sensors(cfg)
+        self._intervals = {id(s): s.interval or cfg.interval for s in self._sensors}
+        self._cache: Dict[int, Tuple[float, Optional[Line]]] = {}
+        self._threads: List[threading.Thread] = []
+        self._log = logging.getLogger(__name__)
+
+    def start(self) -> None:
+        for s in self._sensors:
+            t = threading.Thread(
+                target=self._run, args=(s,), name=f"sensor-{s.name or s.provider}", daemon=True
+            )
+            t.start()
+            self._threads.append(t)
+
+    def stop(self, timeout: float = 1.0) -> None:
+        self._stop.set()
+        for t in self._threads:
+            t.join(timeout=timeout)
+
+    def wait_ready(self, timeout: float) -> bool:
+        """Block until every sensor reported once (or timeout); True if all did."""
+        deadline = self._clock() + timeout
+        while True:
+            with self._lock:
+                if len(self._cache) >= len(self._sensors):
+                    return True
+            if self._clock() >= deadline or self._stop.wait(0.01):
+                return False
+
+    def sample(self, s: SensorConfig) -> None:
+        """Read sensor s once and cache the result (the worker's loop body)."""
+        try:
+            value = self._read(s)
+        except Exception as e:
+            self._log.debug("sensor %s failed: %s", s.name or s.provider, e)
+            value = None
+        with self._lock:
+            self._cache[id(s)] = (self._clock(), value)
+
+    def get(self, s: SensorConfig) -> Optional[Line]:
+        with self._lock:
+            entry = self._cache.get(id(s))
+        if entry is None:
+            return None
+        taken, value = entry
+        interval = self._intervals.get(id(s), 0.0)
+        if interval and self._clock() - taken > STALE_INTERVALS * interval:
+            return None
+        return value
+
+    def _run(self, s: SensorConfig) -> None:
+        interval = self._intervals[id(s)]
+        next_at = self._clock()
+        while not self._stop.is_set():
+            self.sample(s)
+            # Fixed cadence: a slow read shortens the wait instead of shifting it.
+            next_at += interval
+            now = self._clock()
+            if next_at < now:
+                next_at = now
+            if self._stop.wait(next_at - now):
+                return
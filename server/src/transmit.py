@@ -0,0 +1,235 @@
+"""Single-writer transmit queue for the serial port.
+
+One thread owns `ser.write()`. Everything else submits payloads with a
+priority: interactive replies (the commands frame) go out ahead of periodic
+telemetry, and a payload submitted with a `key` replaces the one with the
+same key that is still waiting, so a late telemetry frame is superseded
+rather than queued behind its successor.
+
+A payload may be a callable; it is encoded on the writer thread just before
+it goes out. Telemetry uses this so the delta/numeric encoders only ever
+diff against frames that were actually written. A payload (or what the
+callable returns) may also be a list of frames: the first is written and the
+rest go back to the head of their priority, so each frame passes the gate on
+its own and none of them can be superseded.
+
+An optional gate holds telemetry back while the device has no credit (see
+DeviceLink); interactive replies are never gated. While telemetry waits, newer
+frames keep superseding it, so the device gets the latest state once it
+catches up.
+"""
+
+from __future__ import annotations
+
+import heapq
+import logging
+import threading
+import time
+from dataclasses import dataclass, field
+from enum import IntEnum
+from typing import Callable, List, Optional, Protocol, Union
+
+Frames = Union[bytes, List[bytes]]
+Payload = Union[Frames, Callable[[], Frames]]
+
+
+class SerialLike(Protocol):
+    def write(self, data: bytes) -> Optional[int]: ...
+
+    def flush(self) -> None: ...
+
+
+class Priority(IntEnum):
+    INTERACTIVE = 0  # replies to the device: commands frame, toasts
+    TELEMETRY = 1
+
+
+@dataclass
+class TxStats:
+    """Counters since start; waits are submit-to-dequeue times in seconds."""
+
+    sent: int = 0
+    superseded: int = 0
+    gated: int = 0  # telemetry frames that had to wait for device credit
+    depth: int = 0
+    max_depth: int = 0
+    total_wait: float = 0.0
+    max_wait: float = 0.0
+
+    @property
+    def mean_wait(self) -> float:
+        return self.total_wait / self.sent if self.sent else 0.0
+
+    def summary(self) -> str:
+        return (
+            f"sent={self.sent} superseded={self.superseded} gated={self.gated} "
+            f"depth={self.depth} "
+            f"max_depth={self.max_depth} wait_ms avg={self.mean_wait * 1000:.1f} "
+            f"max={self.max_wait * 1000:.1f}"
+        )
+
+
+@dataclass(order=True)
+class _Entry:
+    priority: int
+    seq: int
+    queued_at: float = field(compare=False)
+    payload: Payload = field(compare=False)
+    key: Optional[str] = field(compare=False, default=None)
+    dropped: bool = field(compare=False, default=False)
+    gated: bool = field(compare=False, default=False)
+
+
+# While gated, re-ask the gate this often in case a wake-up was missed.
+GATE_POLL = 0.05
+
+
+class Transmitter:
+    def __init__(
+        self,
+        ser: SerialLike,
+        clock: Callable[[], float] = time.monotonic,
+        gate: Optional[Callable[[], bool]] = None,
+    ) -> None:
+        self._ser = ser
+        self._clock = clock
+        self._gate = gate
+        self._cond = threading.Condition()
+        self._heap: List[_Entry] = []
+        self._keyed: dict[str, _Entry] = {}
+        self._seq = 0
+        self._busy = False
+        self._stopped = False
+        self._error: Optional[BaseException] = None
+        self._stats = TxStats()
+        self._thread: Optional[threading.Thread] = None
+        self._log = logging.getLogger(__name__)
+
+    def start(self) -> None:
+        self._thread = threading.Thread(target=self._run, name="serial-tx", daemon=True)
+        self._thread.start()
+
+    def stop(self, timeout: float = 1.0) -> None:
+        with self._cond:
+            self._stopped = True
+            self._cond.notify_all()
+        if self._thread is not None:
+            self._thread.join(timeout=timeout)
+
+    def submit(self, payload: Payload, priority: Priority, key: Optional[str] = None) -> None:
+        with self._cond:
+            if key is not None:
+                old = self._keyed.pop(key, None)
+                if old is not None:
+                    old.dropped = True
+                    self._stats.superseded += 1
+                    self._stats.depth -= 1
+            self._seq += 1
+            entry = _Entry(int(priority), self._seq, self._clock(), payload, key)
+            heapq.heappush(self._heap, entry)
+            if key is not None:
+                self._keyed[key] = entry
+            self._stats.depth += 1
+            self._stats.max_depth = max(self._stats.max_depth, self._stats.depth)
+            self._cond.notify_all()
+
+    # serial.Serial-shaped entry point for reply paths: queue as interactive.
+    def write(self, data: bytes) -> int:
+        self.submit(data, Priority.INTERACTIVE)
+        return len(data)
+
+    def flush(self) -> None:
+        pass
+
+    def wake(self) -> None:
+        """Re-check the gate now (the device returned credit)."""
+        with self._cond:
+            self._cond.notify_all()
+
+    def drain(self, timeout: float) -> bool:
+        """Wait until everything submitted so far is written; False on timeout or error."""
+        deadline = self._clock() + timeout
+        with self._cond:
+            while self._stats.depth > 0 or self._busy:
+                remaining = deadline - self._clock()
+                if remaining <= 0 or self._error is not None:
+                    return False
+                self._cond.wait(remaining)
+            return self._error is None
+
+    def stats(self) -> TxStats:
+        with self._cond:
+            return TxStats(**vars(self._stats))
+
+    def raise_if_failed(self) -> None:
+        """Re-raise the write error that stopped the writer thread, if any."""
+        with self._cond:
+            error = self._error
+        if error is not None:
+            raise error
+
+    def _next(self) -> Optional[_Entry]:
+        with self._cond:
+            while True:
+                while self._heap and self._heap[0].dropped:
+                    heapq.heappop(self._heap)
+                top = self._heap[0] if self._heap else None
+                if (
+                    top is not None
+                    and top.priority >= Priority.TELEMETRY
+                    and self._gate is not None
+                    and not self._gate()
+                ):
+                    if not top.gated:
+                        top.gated = True
+                        self._stats.gated += 1
+                    if self._stopped:
+                        return None
+                    self._cond.wait(GATE_POLL)
+                    continue
+                if top is not None:
+                    entry = heapq.heappop(self._heap)
+                    if entry.key is not None:
+                        self._keyed.pop(entry.key, None)
+                    self._stats.depth -= 1
+                    wait = self._clock() - entry.queued_at
+                    self._stats.total_wait += wait
+                    self._stats.max_wait = max(self._stats.max_wait, wait)
+                    self._busy = True
+                    return entry
+                if self._stopped:
+                    return None
+                self._cond.wait()
+
+    def _requeue(self, entry: _Entry, rest: List[bytes]) -> None:
+        # Same priority and sequence number: ahead of anything submitted since.
+        with self._cond:
+            heapq.heappush(self._heap, _Entry(entry.priority, entry.seq, self._clock(), rest))
+            self._stats.depth += 1
+            self._stats.max_depth = max(self._stats.max_depth, self._stats.depth)
+
+    def _run(self) -> None:
+        while True:
+            entry = self._next()
+            if entry is None:
+                return
+            try:
+                data = entry.payload() if callable(entry.payload) else entry.payload
+                if isinstance(data, list):
+                    data, rest = (data[0], data[1:]) if data else (b"", [])
+                    if rest:
+                        self._requeue(entry, rest)
+                if data:
+                    self._ser.write(data)
+                    self._ser.flush()
+            except Exception as e:
+                self._log.error("serial write failed: %s", e)
+                with self._cond:
+                    self._error = e
+                    self._busy = False
+                    self._cond.notify_all()
+                return
+            with self._cond:
+                self._busy = False
+                self._stats.sent += 1
+                self._cond.notify_all()
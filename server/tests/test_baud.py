@@ -0,0 +1,212 @@
+from __future__ import annotations
+
+import logging
+import time
+from typing import Callable
+
+import src.baud as baud_mod
+from src.baud import BaudNegotiator, hello_frame
+from src.config import AppConfig
+from src.main import DeviceLink, _handle_incoming_line
+from src.protocol import encode_baud
+from src.transmit import Transmitter
+
+BOOT = 115200
+
+
+class FakeDevice:
+    """A port wired to a scripted firmware that answers as frames are written.
+
+    Nothing gets through while the two ends disagree on the rate or at a rate
+    listed in `broken`. The port going back to the boot rate stands in for
+    the device's own fallback (probation or bad frames).
+    """
+
+    def __init__(self, max_baud: int = 1000000, accept: bool = True, broken=()) -> None:
+        self._baudrate = BOOT
+        self.device_rate = BOOT
+        self.max_baud = max_baud
+        self.accept = accept
+        self.broken = set(broken)
+        self.writes: list[bytes] = []
+        self.link = DeviceLink()
+        self.negotiator: BaudNegotiator | None = None
+
+    @property
+    def baudrate(self) -> int:
+        return self._baudrate
+
+    @baudrate.setter
+    def baudrate(self, rate: int) -> None:
+        self._baudrate = rate
+        if rate == BOOT:
+            self.device_rate = BOOT
+
+    def say(self, line: str) -> None:
+        _handle_incoming_line(
+            line, self, AppConfig(), logging.getLogger("t"), link=self.link, baud=self.negotiator
+        )
+
+    def write(self, data: bytes) -> int:
+        self.writes.append(data)
+        if self._baudrate != self.device_rate or self.device_rate in self.broken:
+            return len(data)
+        if data[:2] == b"\x02B":
+            rate = int.from_bytes(data[4:8], "little")
+            ok = self.accept and rate <= self.max_baud
+            self.say(f"BAUD {rate if ok else self.device_rate}")
+            if ok:
+                self.device_rate = rate
+        elif b"hello=1" in data:
+            self.say(f"CAPS delta bin credits=2 baud={self.max_baud}")
+        return len(data)
+
+    def flush(self) -> None:
+        return None
+
+
+def _wait(pred: Callable[[], bool], timeout: float = 5.0) -> bool:
+    deadline = time.monotonic() + timeout
+    while not pred():
+        if time.monotonic() > deadline:
+            return False
+        time.sleep(0.01)
+    return True
+
+
+def _start(dev: FakeDevice, max_baud: int = 1000000) -> tuple[BaudNegotiator, Transmitter]:
+    tx = Transmitter(dev)
+    neg = BaudNegotiator(dev, tx, dev.link, BOOT, max_baud, hello_frame(1.0))
+    dev.negotiator = neg
+    tx.start()
+    return neg, tx
+
+
+def _fast(monkeypatch) -> None:
+    monkeypatch.setattr(baud_mod, "BAUD_CONFIRM_TIMEOUT", 0.2)
+    monkeypatch.setattr(baud_mod, "BAUD_SETTLE", 0.01)
+
+
+def test_switches_to_fastest_rate_both_sides_allow(monkeypatch) -> None:
+    _fast(monkeypatch)
+    dev = FakeDevice(max_baud=1000000)
+    neg, tx = _start(dev, max_baud=500000)
+    try:
+        dev.say("CAPS delta bin credits=2 baud=1000000")
+        assert _wait(lambda: neg.rate == 500000)
+        assert dev.baudrate == 500000 and dev.device_rate == 500000
+        assert encode_baud(1000000) not in dev.writes
+        assert dev.writes[0] == encode_baud(500000)
+        assert _wait(lambda: not neg.negotiating)
+        assert neg.ready()
+    finally:
+        neg.stop()
+        tx.stop()
+
+
+def test_unconfirmed_rate_falls_back_to_the_next(monkeypatch) -> None:
+    _fast(monkeypatch)
+    dev = FakeDevice(broken={1000000})
+    neg, tx = _start(dev)
+    try:
+        dev.say("CAPS delta bin credits=2 baud=1000000")
+        assert _wait(lambda: neg.rate == 500000)
+        assert dev.writes[0] == encode_baud(1000000)
+        assert encode_baud(500000) in dev.writes
+        assert dev.baudrate == 500000
+    finally:
+        neg.stop()
+        tx.stop()
+
+
+def test_refused_rates_keep_the_boot_rate(monkeypatch) -> None:
+    _fast(monkeypatch)
+    dev = FakeDevice(accept=False)
+    neg, tx = _start(dev)
+    try:
+        dev.say("CAPS delta bin credits=2 baud=1000000")
+        assert _wait(lambda: dev.writes.count(encode_baud(250000)) == 1)
+        assert _wait(lambda: not neg.negotiating)
+        assert neg.rate == BOOT and dev.baudrate == BOOT
+        assert neg.candidates() == [1000000, 500000, 250000]  # one strike each
+    finally:
+        neg.stop()
+        tx.stop()
+
+
+def test_link_errors_fall_back_and_strike_the_rate(monkeypatch) -> None:
+    _fast(monkeypatch)
+    dev = FakeDevice()
+    neg, tx = _start(dev)
+    try:
+        dev.say("CAPS delta bin credits=2 baud=1000000")
+        assert _wait(lambda: neg.rate == 1000000)
+        assert _wait(lambda: not neg.negotiating)
+        dev.say("BADFRAME 1")
+        dev.say("ACK 1")  # a good line clears the streak
+        for n in range(2, 5):
+            dev.say(f"BADFRAME {n}")
+        # Back at the boot rate, the hello brings CAPS and one more try at 1M.
+        assert _wait(lambda: dev.writes.count(encode_baud(1000000)) == 2)
+        assert _wait(lambda: neg.rate == 1000000)
+        assert _wait(lambda: not neg.negotiating)
+        for n in range(5, 8):
+            dev.say(f"BADFRAME {n}")
+        assert _wait(lambda: neg.rate == 500000)  # 1M is out of strikes
+        assert neg.candidates() == [500000, 250000]
+    finally:
+        neg.stop()
+        tx.stop()
+
+
+def test_slot_starvation_is_not_a_link_error(monkeypatch) -> None:
+    _fast(monkeypatch)
+    dev = FakeDevice()
+    neg, tx = _start(dev)
+    try:
+        dev.say("CAPS delta bin credits=2 baud=1000000")
+        assert _wait(lambda: neg.rate == 1000000)
+        assert _wait(lambda: not neg.negotiating)
+        dev.link.take_credit()
+        for _ in range(5):
+            dev.say("NOSLOT")
+        assert neg.rate == 1000000 and not neg.negotiating
+        assert dev.link.credits == 2
+    finally:
+        neg.stop()
+        tx.stop()
+
+
+def test_only_garbled_lines_are_link_errors(monkeypatch) -> None:
+    _fast(monkeypatch)
+    dev = FakeDevice()
+    neg, tx = _start(dev)
+    try:
+        dev.say("CAPS delta bin credits=2 baud=1000000")
+        assert _wait(lambda: neg.rate == 1000000)
+        assert _wait(lambda: not neg.negotiating)
+        for _ in range(3):
+            dev.say("Starting up")
+            dev.say("FLUSH cells=12 cmds=3")
+        assert neg.rate == 1000000
+        for _ in range(3):
+            dev.say(b"\xc3\xd4\xa0\x01".decode(errors="replace"))
+        assert _wait(lambda: neg.rate == BOOT or neg.negotiating)
+    finally:
+        neg.stop()
+        tx.stop()
+
+
+def test_device_without_baud_is_left_alone() -> None:
+    dev = FakeDevice()
+    neg, tx = _start(dev)
+    try:
+        dev.say("CAPS delta bin credits=2")
+        assert not neg.negotiating
+        assert neg.candidates() == []
+        for n in range(5):
+            dev.say(f"BADFRAME {n}")
+        assert dev.writes == [] and neg.rate == BOOT
+    finally:
+        neg.stop()
+        tx.stop()
@@ -0,0 +1,183 @@
+"""Rate negotiation against the firmware itself, via the simulator's pty mode.
+
+Needs the native build (`cd arduino && pio run -e native`, or point
+LCDMON_SIM at the binary); skipped without it.
+"""
+
+from __future__ import annotations
+
+import logging
+import os
+import select
+import subprocess
+import termios
+import threading
+import time
+import tty
+from contextlib import contextmanager
+from pathlib import Path
+from typing import Callable, Iterator
+
+import pytest
+
+from src.baud import BaudNegotiator, hello_frame
+from src.config import AppConfig
+from src.main import DeviceLink, _reader
+from src.transmit import Priority, Transmitter
+
+SIM = Path(
+    os.environ.get(
+        "LCDMON_SIM",
+        Path(__file__).resolve().parents[2] / "arduino/.pio/build/native/program",
+    )
+)
+SPEEDS = {115200: termios.B115200}
+for _rate in (500000, 1000000):
+    if hasattr(termios, f"B{_rate}"):
+        SPEEDS[_rate] = getattr(termios, f"B{_rate}")
+
+
+class PtyPort:
+    """The part of serial.Serial the daemon uses, on a raw terminal."""
+
+    def __init__(self, path: str) -> None:
+        self._fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+        tty.setraw(self._fd)
+        self._buf = b""
+        self.baudrate = 115200
+
+    @property
+    def baudrate(self) -> int:
+        return self._rate
+
+    @baudrate.setter
+    def baudrate(self, rate: int) -> None:
+        speed = SPEEDS.get(self._line_rate(rate))
+        if speed is None:
+            raise ValueError(f"unsupported rate {rate}")
+        attrs = termios.tcgetattr(self._fd)
+        attrs[4] = attrs[5] = speed
+        termios.tcsetattr(self._fd, termios.TCSANOW, attrs)
+        self._rate = rate
+
+    def _line_rate(self, rate: int) -> int:
+        return rate
+
+    def write(self, data: bytes) -> int:
+        return os.write(self._fd, data)
+
+    def flush(self) -> None:
+        return None
+
+    def readline(self) -> bytes:
+        deadline = time.monotonic() + 0.2
+        while b"\n" not in self._buf:
+            left = deadline - time.monotonic()
+            if left <= 0 or not select.select([self._fd], [], [], left)[0]:
+                line, self._buf = self._buf, b""
+                return line
+            self._buf += os.read(self._fd, 256)
+        line, _, self._buf = self._buf.partition(b"\n")
+        return line + b"\n"
+
+    def close(self) -> None:
+        os.close(self._fd)
+
+
+class StuckPort(PtyPort):
+    """An adapter that silently stays at 115200 when asked for 1 Mbaud."""
+
+    def _line_rate(self, rate: int) -> int:
+        return 115200 if rate == 1000000 else rate
+
+
+class Daemon:
+    """Link, transmit queue, reader and negotiator wired as main() does."""
+
+    def __init__(self, port: PtyPort) -> None:
+        self.link = DeviceLink()
+        self.tx = Transmitter(port, gate=self._gate)
+        self.baud = BaudNegotiator(port, self.tx, self.link, 115200, 1000000, hello_frame(1.0))
+        self.link.on_credit = self.tx.wake
+        self._stop = threading.Event()
+        self._reader = threading.Thread(
+            target=_reader,
+            args=(port, self.tx, self._stop, AppConfig(), logging.getLogger("t"), False, "shell"),
+            kwargs={"link": self.link, "baud": self.baud},
+            daemon=True,
+        )
+
+    def _gate(self) -> bool:
+        return self.baud.ready() and self.link.take_credit()
+
+    def start(self) -> None:
+        self.tx.start()
+        self._reader.start()
+        self.tx.submit(hello_frame(1.0), Priority.INTERACTIVE)
+
+    def stop(self) -> None:
+        self.baud.stop()
+        self.tx.stop()
+        self._stop.set()
+        self._reader.join(timeout=1.0)
+
+
+@contextmanager
+def _simulated(port_type: type[PtyPort]) -> Iterator[tuple[PtyPort, Daemon]]:
+    if not SIM.exists():
+        pytest.skip(f"simulator not built: {SIM}")
+    proc = subprocess.Popen([str(SIM), "--pty"], stdout=subprocess.PIPE, text=True)
+    try:
+        assert proc.stdout is not None
+        port = port_type(proc.stdout.readline().split()[1])
+        daemon = Daemon(port)
+        daemon.start()
+        try:
+            yield port, daemon
+        finally:
+            daemon.stop()
+            port.close()
+    finally:
+        proc.kill()
+        proc.wait()
+
+
+def _wait(pred: Callable[[], bool], timeout: float = 10.0) -> bool:
+    deadline = time.monotonic() + timeout
+    while not pred():
+        if time.monotonic() > deadline:
+            return False
+        time.sleep(0.02)
+    return True
+
+
+def _telemetry_is_acked(daemon: Daemon) -> bool:
+    """A telemetry frame spends a credit and the device's ACK returns it."""
+    sent = daemon.tx.stats().sent
+    daemon.tx.submit(
+        lambda: daemon.link.encode_telemetry(AppConfig(interval=1.0), ["CPU 12%", "RAM 40%"]),
+        Priority.TELEMETRY,
+    )
+    return _wait(lambda: daemon.tx.stats().sent > sent) and _wait(
+        lambda: daemon.link.credits == 2
+    )
+
+
+def test_switches_the_simulated_device_to_1mbaud() -> None:
+    if 1000000 not in SPEEDS:
+        pytest.skip("no B1000000 on this platform")
+    with _simulated(PtyPort) as (port, daemon):
+        assert _wait(lambda: daemon.baud.rate == 1000000)
+        assert port.baudrate == 1000000
+        assert _telemetry_is_acked(daemon)
+
+
+def test_falls_back_when_the_port_cannot_follow() -> None:
+    if 500000 not in SPEEDS:
+        pytest.skip("no B500000 on this platform")
+    with _simulated(StuckPort) as (port, daemon):
+        # 1M is never confirmed; the device drops back after its probation
+        # and the next rate works.
+        assert _wait(lambda: daemon.baud.rate == 500000)
+        assert port.baudrate == 500000
+        assert _telemetry_is_acked(daemon)
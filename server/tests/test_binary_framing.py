@@ -0,0 +1,110 @@
+from __future__ import annotations
+
+import logging
+
+import pytest
+
+from src.config import AppConfig, CommandConfig, SerialConfig, validate_config
+from src.main import DeviceLink, _encode_commands_frame, _handle_incoming_line
+from src.protocol import (
+    END,
+    FRAME_COMMANDS,
+    FRAME_DELTA,
+    FRAME_KEEPALIVE,
+    FRAME_TELEMETRY,
+    START,
+    DeltaEncoder,
+    crc16_ccitt,
+    encode_binary,
+)
+
+
+class FakeSerial:
+    def __init__(self) -> None:
+        self.writes: list[bytes] = []
+
+    def write(self, b: bytes) -> int:
+        self.writes.append(b)
+        return len(b)
+
+    def flush(self) -> None:
+        return None
+
+
+def _unwrap(frame: bytes) -> tuple[int, bytes]:
+    assert frame[:1] == START and frame[-1:] == END
+    kind = frame[1]
+    length = int.from_bytes(frame[2:4], "little")
+    payload = frame[4 : 4 + length]
+    assert len(frame) == 4 + length + 3
+    crc = int.from_bytes(frame[4 + length : 6 + length], "big")
+    assert crc == crc16_ccitt(frame[1 : 4 + length])
+    return kind, payload
+
+
+def test_crc_matches_ccitt_false_check_value() -> None:
+    assert crc16_ccitt(b"123456789") == 0x29B1
+
+
+def test_encode_binary_layout() -> None:
+    kind, payload = _unwrap(encode_binary(FRAME_TELEMETRY, b"\x01\x02"))
+    assert kind == FRAME_TELEMETRY
+    assert payload == b"\x01\x02"
+
+
+def test_binary_full_delta_and_keepalive() -> None:
+    enc = DeltaEncoder()
+    kind, payload = _unwrap(enc.diff(["ab", "cd"]).encode_binary(1.0))
+    assert kind == FRAME_TELEMETRY
+    assert payload == b"\xe8\x03" + b"\x02ab" + b"\x02cd"
+
+    kind, payload = _unwrap(enc.diff(["ab", "xy"]).encode_binary(1.0))
+    assert kind == FRAME_DELTA
+    assert payload == b"\xe8\x03" + b"\x02" + b"\x01\x02xy"
+
+    kind, payload = _unwrap(enc.diff(["ab", "xy"]).encode_binary(1.0))
+    assert kind == FRAME_KEEPALIVE
+    assert payload == b"\xe8\x03"
+
+
+def test_link_switches_to_binary_only_when_announced() -> None:
+    cfg = AppConfig(interval=1.0)
+    link = DeviceLink()
+    ser = FakeSerial()
+    log = logging.getLogger("t")
+    _handle_incoming_line("CAPS delta", ser, cfg, log, link=link)
+    assert not link.binary
+    assert link.encode_telemetry(cfg, ["a"]).startswith(b"META")
+
+    _handle_incoming_line("CAPS delta bin", ser, cfg, log, link=link)
+    assert link.binary
+    assert link.encode_telemetry(cfg, ["a"])[:1] == START
+
+    text_link = DeviceLink(framing="text")
+    _handle_incoming_line("CAPS delta bin", ser, cfg, log, link=text_link)
+    assert not text_link.binary
+
+
+def test_commands_frame_binary() -> None:
+    frame = _encode_commands_frame([CommandConfig(id="1", label="Shutdown")], binary=True)
+    kind, payload = _unwrap(frame)
+    assert kind == FRAME_COMMANDS
+    assert payload == b"\x0a1 Shutdown"
+
+
+def test_badframe_forces_full_frame() -> None:
+    cfg = AppConfig(interval=1.0)
+    link = DeviceLink()
+    ser = FakeSerial()
+    log = logging.getLogger("t")
+    _handle_incoming_line("CAPS delta bin", ser, cfg, log, link=link)
+    link.encode_telemetry(cfg, ["a"])
+    _handle_incoming_line("BADFRAME 1", ser, cfg, log, link=link)
+    kind, _ = _unwrap(link.encode_telemetry(cfg, ["a"]))
+    assert kind == FRAME_TELEMETRY
+
+
+def test_validate_rejects_unknown_framing() -> None:
+    cfg = AppConfig(serial=SerialConfig(port="/dev/null", framing="morse"))
+    with pytest.raises(ValueError):
+        validate_config(cfg)
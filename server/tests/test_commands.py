@@ -52,3 +52,13 @@ def test_handle_incoming_select_logs_label(caplog) -> None:
     msgs = "\n".join(r.message for r in caplog.records)
     assert "selected id=42 label=Reboot" in msgs
     assert "execution blocked" in msgs
+
+
+def test_handle_incoming_rx_overrun_warns(caplog) -> None:
+    cfg = AppConfig()
+    ser = FakeSerial()
+    caplog.set_level(logging.WARNING)
+    _handle_incoming_line("RXOVR 17", ser, cfg, logging.getLogger("test"))
+    msgs = "\n".join(r.message for r in caplog.records)
+    assert "lost bytes total=17" in msgs
+    assert not ser.writes
@@ -0,0 +1,164 @@
+from __future__ import annotations
+
+import logging
+
+from src.config import AppConfig
+from src.main import DeviceLink, _handle_incoming_line
+from src.protocol import DeltaEncoder
+
+META = "META interval=1.000"
+
+
+class FakeSerial:
+    def write(self, b: bytes) -> int:  # pragma: no cover - not used
+        return len(b)
+
+    def flush(self) -> None:  # pragma: no cover - not used
+        return None
+
+
+def _frame(payload: bytes) -> list[str]:
+    text = payload.decode()
+    assert text.endswith("\n\n")
+    return text[:-2].split("\n")
+
+
+def test_first_frame_is_full() -> None:
+    enc = DeltaEncoder()
+    assert _frame(enc.encode(META, ["CPU  1%", "GPU  2%"])) == [META, "CPU  1%", "GPU  2%"]
+
+
+def test_unchanged_lines_send_only_meta() -> None:
+    enc = DeltaEncoder()
+    enc.encode(META, ["CPU  1%", "GPU  2%"])
+    assert _frame(enc.encode(META, ["CPU  1%", "GPU  2%"])) == [META]
+
+
+def test_single_change_sends_index_and_text() -> None:
+    enc = DeltaEncoder()
+    enc.encode(META, ["CPU  1%", "GPU  2%", "T 40C"])
+    assert _frame(enc.encode(META, ["CPU  1%", "GPU  3%", "T 40C"])) == [
+        META,
+        "DELTA 3",
+        "1 GPU  3%",
+    ]
+
+
+def test_shrinking_frame_reports_new_total() -> None:
+    enc = DeltaEncoder()
+    enc.encode(META, ["a", "b", "c"])
+    assert _frame(enc.encode(META, ["a", "b"])) == [META, "DELTA 2"]
+
+
+def test_delta_lines_truncate_text_not_prefix() -> None:
+    enc = DeltaEncoder()
+    enc.encode(META, ["x"] * 11)
+    long = "0123456789abcdefghijKLMN"
+    out = _frame(enc.encode(META, ["x"] * 10 + [long]))
+    assert out[-1] == "10 0123456789abcdefghij"
+
+
+def test_reset_and_refresh_force_full_frame() -> None:
+    enc = DeltaEncoder(refresh_every=2)
+    enc.encode(META, ["a"])
+    enc.reset()
+    assert _frame(enc.encode(META, ["a"])) == [META, "a"]
+    enc.encode(META, ["a"])
+    enc.encode(META, ["a"])
+    assert _frame(enc.encode(META, ["a"])) == [META, "a"]
+
+
+def test_link_uses_delta_only_after_caps() -> None:
+    cfg = AppConfig(interval=1.0)
+    link = DeviceLink()
+    ser = FakeSerial()
+    first = _frame(link.encode_telemetry(cfg, ["a"]))
+    assert first[0] == "META interval=1.000 hello=1"
+    assert _frame(link.encode_telemetry(cfg, ["a"]))[1:] == ["a"]
+
+    log = logging.getLogger("t")
+    _handle_incoming_line("CAPS delta", ser, cfg, log, link=link)
+    assert link.has("delta")
+    assert _frame(link.encode_telemetry(cfg, ["a"])) == [META, "a"]
+    assert _frame(link.encode_telemetry(cfg, ["a"])) == [META]
+
+    _handle_incoming_line("REQ FULL", ser, cfg, log, link=link)
+    assert _frame(link.encode_telemetry(cfg, ["a"])) == [META, "a"]
+
+
+def _frames(payload: bytes) -> list[list[str]]:
+    text = payload.decode()
+    assert text.endswith("\n\n")
+    return [chunk.split("\n") for chunk in text[:-2].split("\n\n")]
+
+
+def test_resync_splits_into_full_head_and_deltas() -> None:
+    update = DeltaEncoder().diff(["a", "b", "c", "d", "e"])
+    parts = update.split(2)
+    assert [(p.full, p.total) for p in parts] == [(True, 2), (False, 5), (False, 5)]
+    assert _frames(b"".join(p.encode_text(META) for p in parts)) == [
+        [META, "a", "b"],
+        [META, "DELTA 5", "2 c", "3 d"],
+        [META, "DELTA 5", "4 e"],
+    ]
+
+
+def test_periodic_refresh_of_synced_screen_never_shrinks_it() -> None:
+    enc = DeltaEncoder(refresh_every=1)
+    enc.diff(["a", "b", "c"])
+    enc.diff(["a", "b", "c"])
+    parts = enc.diff(["a", "b", "c"]).split(2)
+    assert all(not p.full and p.total == 3 for p in parts)
+    assert [i for p in parts for i, _ in p.changes] == [0, 1, 2]
+
+
+def test_wide_lines_take_a_stage_slot_per_panel_width() -> None:
+    wide = "x" * 30
+    update = DeltaEncoder(width=40).diff([wide, wide, "a", wide])
+    parts = update.split(4, 20)
+    assert [[i for i, _ in p.changes] for p in parts] == [[0, 1], [2, 3]]
+    assert [(p.full, p.total) for p in parts] == [(True, 2), (False, 4)]
+
+
+def test_link_honours_caps_limits() -> None:
+    cfg = AppConfig(interval=1.0)
+    link = DeviceLink()
+    log = logging.getLogger("t")
+    _handle_incoming_line("CAPS delta lines=3 stage=2", FakeSerial(), cfg, log, link=link)
+    assert link.has("delta")
+    assert not link.has("lines=3")
+    assert link.limit("lines") == 3
+    assert _frames(link.encode_telemetry(cfg, ["a", "b", "c", "d"])) == [
+        [META, "a", "b"],
+        [META, "DELTA 3", "2 c"],
+    ]
+    assert _frames(link.encode_telemetry(cfg, ["A", "B", "C", "d"])) == [
+        [META, "DELTA 3", "0 A", "1 B"],
+        [META, "DELTA 3", "2 C"],
+    ]
+
+
+def test_link_cuts_lines_to_announced_cols() -> None:
+    cfg = AppConfig(interval=1.0)
+    link = DeviceLink()
+    log = logging.getLogger("t")
+    wide = "0123456789" * 5
+    assert link.width == 20
+    _handle_incoming_line("CAPS delta lines=16 stage=4 cols=40", FakeSerial(), cfg, log, link=link)
+    assert link.width == 40
+    assert _frame(link.encode_telemetry(cfg, [wide])) == [META, wide[:40]]
+    _handle_incoming_line("CAPS delta lines=32 stage=8 cols=16", FakeSerial(), cfg, log, link=link)
+    assert _frame(link.encode_telemetry(cfg, [wide])) == [META, wide[:16]]
+    assert _frame(link.encode_telemetry(cfg, ["x" + wide])) == [META, "DELTA 1", "0 x" + wide[:15]]
+
+
+def test_link_sends_wide_lines_up_to_announced_wide() -> None:
+    cfg = AppConfig(interval=1.0)
+    link = DeviceLink()
+    log = logging.getLogger("t")
+    wide = "0123456789" * 5
+    caps = "CAPS delta lines=16 stage=4 cols=20 wide=40"
+    _handle_incoming_line(caps, FakeSerial(), cfg, log, link=link)
+    assert link.width == 20 and link.line_width == 40
+    assert _frame(link.encode_telemetry(cfg, [wide])) == [META, wide[:40]]
+    assert _frame(link.encode_telemetry(cfg, ["x" + wide])) == [META, "DELTA 1", "0 x" + wide[:39]]
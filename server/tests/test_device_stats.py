@@ -0,0 +1,70 @@
+from __future__ import annotations
+
+import logging
+
+import pytest
+
+from src.config import AppConfig
+from src.device_stats import DeviceStats, parse_stats
+from src.main import DeviceLink, _handle_incoming_line
+
+REPLY = (
+    "STATS rx={rx} ok={ok} bad={bad} lost=0 ovr={ovr} trunc=0 draws=40 draw_us=850 "
+    "loop_us=1200 enc=12 free={free}"
+)
+
+
+class NullSerial:
+    def write(self, b: bytes) -> int:
+        return len(b)
+
+    def flush(self) -> None:
+        return None
+
+
+def _reply(rx: int = 10, ok: int = 9, bad: int = 0, ovr: int = 0, free: int = 412) -> str:
+    return REPLY.format(rx=rx, ok=ok, bad=bad, ovr=ovr, free=free)
+
+
+def test_parse_stats_reads_pairs() -> None:
+    values = parse_stats(_reply())
+    assert values is not None
+    assert values["rx"] == 10 and values["loop_us"] == 1200 and values["free"] == 412
+    assert parse_stats("CAPS delta") is None
+
+
+def test_counters_are_diffed_across_16bit_wrap() -> None:
+    stats = DeviceStats()
+    assert stats.update(parse_stats(_reply(rx=65530)) or {}) == {}
+    delta = stats.update(parse_stats(_reply(rx=4)) or {})
+    assert delta["rx"] == 10
+    assert delta["ok"] == 0
+    assert "draw_us=850" in stats.summary()
+    assert stats.trouble() == []
+
+
+def test_losses_and_low_sram_are_trouble() -> None:
+    stats = DeviceStats()
+    stats.update(parse_stats(_reply()) or {})
+    stats.update(parse_stats(_reply(bad=2, ovr=30, free=40)) or {})
+    assert stats.trouble() == ["bad+2", "ovr+30", "free=40"]
+
+
+def test_reply_is_logged_and_reset_by_caps(caplog: pytest.LogCaptureFixture) -> None:
+    link = DeviceLink()
+    log = logging.getLogger("t")
+
+    def handle(line: str) -> None:
+        _handle_incoming_line(line, NullSerial(), AppConfig(), log, link=link)
+
+    handle("CAPS delta bin stats credits=2")
+    assert link.has("stats")
+    caplog.set_level(logging.INFO)
+    handle(_reply())
+    handle(_reply(rx=20, ok=19, bad=1))
+    assert "device stats: rx=10" in caplog.text
+    assert "device struggling (bad+1)" in caplog.text
+    assert link.stats.latest["rx"] == 20
+
+    handle("CAPS delta bin stats credits=2")  # rebooted: counters start again
+    assert link.stats.latest == {}
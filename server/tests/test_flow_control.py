@@ -0,0 +1,137 @@
+from __future__ import annotations
+
+import logging
+import threading
+
+from src.config import AppConfig
+from src.main import CREDIT_TIMEOUT, DeviceLink, _handle_incoming_line
+from src.transmit import Priority, Transmitter
+
+
+class FakeClock:
+    def __init__(self) -> None:
+        self.now = 10.0
+
+    def __call__(self) -> float:
+        return self.now
+
+
+class RecordingSerial:
+    def __init__(self) -> None:
+        self.writes: list[bytes] = []
+        self.wrote = threading.Event()
+
+    def write(self, b: bytes) -> int:
+        self.writes.append(b)
+        self.wrote.set()
+        return len(b)
+
+    def flush(self) -> None:
+        return None
+
+
+def _handle(link: DeviceLink, line: str) -> None:
+    _handle_incoming_line(line, RecordingSerial(), AppConfig(), logging.getLogger("t"), link=link)
+
+
+def test_device_without_credits_is_not_gated() -> None:
+    link = DeviceLink()
+    assert link.credits is None
+    assert all(link.take_credit() for _ in range(10))
+    _handle(link, "CAPS delta bin")
+    assert link.take_credit()
+
+
+def test_credits_are_spent_and_returned_by_ack() -> None:
+    link = DeviceLink()
+    _handle(link, "CAPS delta bin credits=2")
+    assert link.take_credit()
+    assert link.take_credit()
+    assert not link.take_credit()
+    _handle(link, "ACK 1")
+    assert link.credits == 1
+    _handle(link, "ACK 5")
+    assert link.credits == 2  # never more than announced
+
+
+def test_dropped_frames_return_their_credit() -> None:
+    link = DeviceLink()
+    _handle(link, "CAPS delta bin credits=2")
+    link.take_credit()
+    link.take_credit()
+    _handle(link, "BADFRAME 1")
+    assert link.credits == 1
+    _handle(link, "RXOVR 40")
+    assert link.credits == 2
+
+
+def test_lost_ack_times_out() -> None:
+    clock = FakeClock()
+    link = DeviceLink(clock=clock)
+    _handle(link, "CAPS delta bin credits=1")
+    assert link.take_credit()
+    clock.now += CREDIT_TIMEOUT / 2
+    assert not link.take_credit()
+    clock.now += CREDIT_TIMEOUT
+    assert link.take_credit()
+    assert link.credits == 0
+
+
+def test_gated_telemetry_coalesces_until_ack() -> None:
+    link = DeviceLink()
+    _handle(link, "CAPS delta bin credits=1")
+    ser = RecordingSerial()
+    tx = Transmitter(ser, gate=link.take_credit)
+    link.on_credit = tx.wake
+    tx.start()
+    try:
+        tx.submit(b"T0", Priority.TELEMETRY, key="telemetry")
+        assert ser.wrote.wait(5.0)
+        tx.submit(b"T1", Priority.TELEMETRY, key="telemetry")
+        tx.submit(b"T2", Priority.TELEMETRY, key="telemetry")
+        tx.write(b"COMMANDS")  # replies are never held back
+        assert not tx.drain(0.2)
+        assert ser.writes == [b"T0", b"COMMANDS"]
+        _handle(link, "ACK 1")
+        assert tx.drain(5.0)
+    finally:
+        tx.stop()
+    assert ser.writes == [b"T0", b"COMMANDS", b"T2"]
+    stats = tx.stats()
+    assert stats.superseded == 1
+    assert stats.gated >= 1
+
+
+def test_each_frame_of_a_split_update_spends_a_credit() -> None:
+    link = DeviceLink()
+    _handle(link, "CAPS delta lines=8 stage=2 credits=2")
+    cfg = AppConfig(interval=1.0)
+    ser = RecordingSerial()
+    tx = Transmitter(ser, gate=link.take_credit)
+    link.on_credit = tx.wake
+    tx.start()
+    try:
+        # A resync of 5 lines: a full frame of 2, then deltas of 2 and 1.
+        lines = ["a", "b", "c", "d", "e"]
+        tx.submit(lambda: link.encode_telemetry_frames(cfg, lines), Priority.TELEMETRY, "telemetry")
+        assert not tx.drain(0.2)
+        assert len(ser.writes) == 2
+        assert link.credits == 0
+        # A newer update waits behind the rest of the split one.
+        tx.submit(
+            lambda: link.encode_telemetry_frames(cfg, ["A", "b", "c", "d", "e"]),
+            Priority.TELEMETRY,
+            "telemetry",
+        )
+        _handle(link, "ACK 1")
+        assert not tx.drain(0.2)
+        assert len(ser.writes) == 3
+        assert ser.writes[2].endswith(b"4 e\n\n")
+        _handle(link, "ACK 2")
+        assert tx.drain(5.0)
+    finally:
+        tx.stop()
+    assert len(ser.writes) == 4
+    assert ser.writes[3].endswith(b"0 A\n\n")
+    assert link.credits == 1
+    assert tx.stats().superseded == 0
@@ -12,7 +12,7 @@ def test_gpu_summary_uses_nvidia_smi_when_nvml_absent(monkeypatch) -> None:
     # Fake nvidia-smi output: gpu%, mem.used, mem.total, temp (no units)
     fake_out = "12, 512, 2048, 45\n"
 
-    def fake_run(cmd, capture_output, text, check):  # type: ignore[no-redef]
+    def fake_run(cmd, capture_output, text, check, timeout):  # type: ignore[no-redef]
         assert "nvidia-smi" in cmd[0]
         return SimpleNamespace(stdout=fake_out)
 
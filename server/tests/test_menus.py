@@ -0,0 +1,168 @@
+from __future__ import annotations
+
+import logging
+from pathlib import Path
+
+import pytest
+
+from src.config import AppConfig, CommandConfig, load_config, validate_config
+from src.menus import MenuTree, parse_page_request
+from src.main import DeviceLink, _handle_incoming_line
+from src.protocol import FRAME_PAGE, crc16_ccitt
+
+TREE = [
+    CommandConfig(id="rb", label="Reboot", exec="shutdown -r now"),
+    CommandConfig(
+        id="svc",
+        label="Services",
+        commands=[
+            CommandConfig(id=f"s{i}", label=f"Restart unit {i}", exec=f"systemctl restart u{i}")
+            for i in range(20)
+        ]
+        + [CommandConfig(id="net", label="Network", commands=[CommandConfig("dns", "DNS")])],
+    ),
+    CommandConfig(id="halt", label="Halt"),
+]
+
+
+class FakeSerial:
+    def __init__(self) -> None:
+        self.writes: list[bytes] = []
+
+    def write(self, b: bytes) -> int:
+        self.writes.append(b)
+        return len(b)
+
+    def flush(self) -> None:
+        return None
+
+
+def test_menus_are_numbered_depth_first() -> None:
+    tree = MenuTree(TREE)
+    assert [m.parent for m in tree.menus] == [0, 0, 1]
+    assert tree.submenu(TREE[1]) == 1
+    assert tree.submenu(TREE[0]) is None
+    assert [c.id for c in tree.leaves()][:3] == ["rb", "s0", "s1"]
+    found = tree.find("dns")
+    assert found is not None and found.label == "DNS"
+    assert tree.find("svc") is None  # submenus cannot be selected
+
+
+def test_text_page_carries_a_window_of_one_menu() -> None:
+    frame = MenuTree(TREE).encode_page(1, 16, 8, width=16).decode()
+    lines = frame.split("\n")
+    assert lines[0] == "PAGE 1 0 16 21"
+    assert lines[1:5] == [f"s{i} Restart unit" for i in range(16, 20)]
+    assert lines[5] == "@2 Network"
+    assert frame.endswith("@2 Network\n\n")
+
+    top = MenuTree(TREE).encode_page(0, 0, 8).decode()
+    assert top == "PAGE 0 0 0 3\nrb Reboot\n@1 Services\nhalt Halt\n\n"
+
+
+def test_binary_page_header_and_unknown_menu() -> None:
+    frame = MenuTree(TREE).encode_page(2, 0, 8, binary=True)
+    assert frame[1] == FRAME_PAGE
+    payload = frame[4:-3]
+    assert payload[:6] == bytes([2, 1, 0, 0, 1, 0])
+    assert payload[6:] == bytes([7]) + b"dns DNS"
+    assert int.from_bytes(frame[-3:-1], "big") == crc16_ccitt(frame[1:-3])
+
+    empty = MenuTree(TREE).encode_page(9, 0, 8).decode()
+    assert empty == "PAGE 9 0 0 0\n\n"
+
+
+def test_page_requests_are_parsed() -> None:
+    assert parse_page_request("REQ COMMANDS 1 16 8") == (1, 16, 8, None)
+    assert parse_page_request("REQ COMMANDS 0 0 8 have=4660") == (0, 0, 8, 4660)
+    assert parse_page_request("REQ COMMANDS") is None
+    assert parse_page_request("REQ COMMANDS 1 x 8") is None
+    assert parse_page_request("REQ COMMANDS 0 0 8 have=x") is None
+
+
+def test_page_with_current_digest_leaves_the_entries_out() -> None:
+    tree = MenuTree(TREE)
+    digest = tree.digest()
+    top = tree.encode_page(0, 0, 8, hashed=True).decode()
+    assert top == f"PAGE 0 0 0 3 {digest}\nrb Reboot\n@1 Services\nhalt Halt\n\n"
+    assert tree.encode_page(0, 0, 8, have=digest, hashed=True).decode() == (
+        f"PAGE 0 0 0 3 {digest}\n\n"
+    )
+    # A stale copy gets the page again; without menuhash there is no digest.
+    assert tree.encode_page(0, 0, 8, have=digest ^ 1, hashed=True).decode() == top
+    assert tree.encode_page(0, 0, 8, have=digest).decode().startswith("PAGE 0 0 0 3\nrb")
+
+    frame = tree.encode_page(2, 0, 8, binary=True, hashed=True)
+    assert frame[4:-3][6:8] == digest.to_bytes(2, "little")
+    assert frame[4:-3][8:] == bytes([7]) + b"dns DNS"
+
+    renamed = [CommandConfig(id="rb", label="Restart"), *TREE[1:]]
+    assert MenuTree(renamed).digest() != digest
+    # No room for the digest in a narrow header: the device caches nothing.
+    assert tree.encode_page(1, 16, 8, width=16, hashed=True).decode().startswith("PAGE 1 0 16 21\n")
+
+
+def test_handler_answers_pages_and_selects_nested_commands(
+    caplog: pytest.LogCaptureFixture,
+) -> None:
+    cfg = AppConfig(commands=TREE)
+    ser = FakeSerial()
+    log = logging.getLogger("t")
+    _handle_incoming_line("REQ COMMANDS 1 8 8", ser, cfg, log)
+    assert ser.writes[-1].startswith(b"PAGE 1 0 8 21\ns8 Restart unit 8\n")
+    _handle_incoming_line("REQ COMMANDS 0 0 8 have=1", ser, cfg, log)  # no menuhash: ignored
+    assert ser.writes[-1].startswith(b"PAGE 0 0 0 3\nrb Reboot\n")
+
+    _handle_incoming_line("REQ COMMANDS", ser, cfg, log)  # older firmware: one flat list
+    flat = ser.writes[-1].decode().split("\n")
+    assert flat[0] == "COMMANDS v1"
+    assert "dns DNS" in flat and "@1 Services" not in flat
+
+    caplog.set_level(logging.INFO)
+    _handle_incoming_line("SELECT dns", ser, cfg, log)
+    assert "selected id=dns label=DNS" in caplog.text
+
+
+def test_handler_confirms_a_current_menu_with_the_header_alone() -> None:
+    cfg = AppConfig(commands=TREE)
+    ser = FakeSerial()
+    log = logging.getLogger("t")
+    link = DeviceLink()
+    _handle_incoming_line("CAPS delta menuhash", ser, cfg, log, link=link)
+    digest = MenuTree(TREE).digest()
+    _handle_incoming_line(f"REQ COMMANDS 0 0 8 have={digest}", ser, cfg, log, link=link)
+    assert ser.writes[-1] == f"PAGE 0 0 0 3 {digest}\n\n".encode()
+
+
+def test_validation_walks_submenus() -> None:
+    validate_config(AppConfig(commands=TREE))
+    dup = [CommandConfig(id="m", label="M", commands=[CommandConfig(id="m", label="Again")])]
+    with pytest.raises(ValueError, match=r"commands\[0\]\.commands\[0\]: duplicate id 'm'"):
+        validate_config(AppConfig(commands=dup))
+    with pytest.raises(ValueError, match="must not start with '@'"):
+        validate_config(AppConfig(commands=[CommandConfig(id="@1", label="Fake")]))
+    both = [CommandConfig(id="m", label="M", exec="true", commands=[CommandConfig("x", "X")])]
+    with pytest.raises(ValueError, match="a submenu cannot have exec"):
+        validate_config(AppConfig(commands=both))
+
+
+def test_submenus_load_from_yaml(tmp_path: Path) -> None:
+    cfg_path = tmp_path / "cfg.yaml"
+    cfg_path.write_text(
+        """
+commands:
+  - id: "1"
+    label: Shutdown
+    exec: "true"
+  - id: svc
+    label: Services
+    commands:
+      - id: "2"
+        label: Restart web
+        exec: "true"
+"""
+    )
+    cfg = load_config(cfg_path)
+    validate_config(cfg)
+    assert cfg.commands[1].exec is None
+    assert [c.id for c in cfg.commands[1].commands] == ["2"]
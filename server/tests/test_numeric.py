@@ -0,0 +1,124 @@
+from __future__ import annotations
+
+import logging
+
+from src.config import AppConfig
+from src.main import DeviceLink, _handle_incoming_line
+from src.protocol import (
+    END,
+    FRAME_DELTA,
+    FRAME_LAYOUT,
+    FRAME_TELEMETRY,
+    FRAME_VALUES,
+    START,
+    Field,
+    NumericEncoder,
+    render_line,
+)
+
+
+class FakeSerial:
+    def write(self, b: bytes) -> int:  # pragma: no cover - not used
+        return len(b)
+
+    def flush(self) -> None:  # pragma: no cover - not used
+        return None
+
+
+def _split(data: bytes) -> list[tuple[int, bytes]]:
+    frames = []
+    while data:
+        assert data[:1] == START
+        length = int.from_bytes(data[2:4], "little")
+        frames.append((data[1], data[4 : 4 + length]))
+        assert data[4 + length + 2 : 4 + length + 3] == END
+        data = data[4 + length + 3 :]
+    return frames
+
+
+def _cpu(load: int, temp: int) -> list[str | Field]:
+    return ["CPU ", Field(load), "% ", Field(temp * 10, width=5, decimals=1), "C"]
+
+
+def test_field_render_matches_firmware_format() -> None:
+    assert Field(7).render() == "  7"
+    assert Field(-4).render() == " -4"
+    assert Field(123, width=4, decimals=1).render() == "12.3"
+    assert Field(5, width=4, decimals=1).render() == " 0.5"
+    assert Field(-5, width=5, decimals=2).render() == "-0.05"
+    assert Field(1000).render() == "###"
+    assert Field(7, history=True).render() == "  7"
+    assert Field(7, history=True).fmt == 0x43
+    assert render_line(_cpu(5, 40)) == "CPU   5%  40.0C"
+
+
+def test_layout_then_changed_values_only() -> None:
+    enc = NumericEncoder(max_fields=4)
+    [(kind, payload)] = _split(enc.encode(1.0, [_cpu(5, 40), ["up"]]) or b"")
+    assert kind == FRAME_LAYOUT
+    assert payload[:4] == b"\xe8\x03\x01\x02"  # interval, layout id 1, two fields
+    assert payload[4:10] == bytes([0, 4, 0x03, 0, 9, 0x15])
+    assert payload[10:] == b"\x0fCPU   5%  40.0C" + b"\x02up"
+
+    [(kind, payload)] = _split(enc.encode(1.0, [_cpu(42, 40), ["up"]]) or b"")
+    assert kind == FRAME_VALUES
+    assert payload == b"\xe8\x03\x01" + bytes([0, 42, 0])
+    # Nothing changed: an empty values frame still names the layout.
+    assert _split(enc.encode(1.0, [_cpu(42, 40), ["up"]]) or b"") == [
+        (FRAME_VALUES, b"\xe8\x03\x01")
+    ]
+
+
+def test_new_text_or_reset_sends_layout() -> None:
+    enc = NumericEncoder(max_fields=4)
+    enc.encode(1.0, [_cpu(5, 40)])
+    [(kind, payload)] = _split(enc.encode(1.0, [["GPU ", Field(5), "%"]]) or b"")
+    assert kind == FRAME_LAYOUT and payload[2] == 2
+    enc.reset()
+    [(kind, payload)] = _split(enc.encode(1.0, [["GPU ", Field(6), "%"]]) or b"")
+    assert kind == FRAME_LAYOUT and payload[2] == 3
+
+
+def test_fields_past_width_become_text_and_limit_falls_back() -> None:
+    enc = NumericEncoder(width=8, max_fields=1)
+    [(kind, payload)] = _split(enc.encode(1.0, [["CPU ", Field(5), Field(6)]]) or b"")
+    assert kind == FRAME_LAYOUT
+    assert payload[3] == 1  # the second field does not fit and is plain text
+    assert enc.encode(1.0, [[Field(1), Field(2)]]) is None
+
+
+def test_fields_stay_on_the_panel_of_a_wide_line() -> None:
+    enc = NumericEncoder(width=40, cols=20, max_fields=4)
+    line = ["fans ", Field(1200, width=4), "rpm pump ", Field(2400, width=4), "rpm"]
+    [(kind, payload)] = _split(enc.encode(1.0, [line]) or b"")
+    assert kind == FRAME_LAYOUT
+    assert payload[3] == 1  # the pump field would start on the scrolled part
+    assert payload[7:] == b"\x19fans 1200rpm pump 2400rpm"
+
+
+def test_layout_beyond_stage_continues_as_deltas() -> None:
+    enc = NumericEncoder(max_fields=4)
+    lines = [["L", Field(i)] for i in range(3)]
+    frames = _split(enc.encode(1.0, lines, stage=2) or b"")
+    assert [k for k, _ in frames] == [FRAME_LAYOUT, FRAME_DELTA]
+    assert frames[0][1][3] == 3  # every field, including the deferred line's
+    assert frames[1][1] == b"\x00\x00\x03" + b"\x02\x04L  2"
+
+
+def test_link_uses_numeric_channel_when_announced() -> None:
+    cfg = AppConfig(interval=1.0)
+    log = logging.getLogger("t")
+    link = DeviceLink()
+    _handle_incoming_line("CAPS delta bin lines=32 stage=8", FakeSerial(), cfg, log, link=link)
+    [(kind, _)] = _split(link.encode_telemetry(cfg, [_cpu(5, 40)]))
+    assert kind == FRAME_TELEMETRY
+
+    caps = "CAPS delta bin num lines=32 stage=8 cols=20 fields=12"
+    _handle_incoming_line(caps, FakeSerial(), cfg, log, link=link)
+    [(kind, _)] = _split(link.encode_telemetry(cfg, [_cpu(5, 40)]))
+    assert kind == FRAME_LAYOUT
+    [(kind, _)] = _split(link.encode_telemetry(cfg, [_cpu(6, 40)]))
+    assert kind == FRAME_VALUES
+    _handle_incoming_line("REQ FULL", FakeSerial(), cfg, log, link=link)
+    [(kind, _)] = _split(link.encode_telemetry(cfg, [_cpu(6, 40)]))
+    assert kind == FRAME_LAYOUT
@@ -0,0 +1,133 @@
+from __future__ import annotations
+
+import threading
+import time
+from pathlib import Path
+
+import pytest
+
+from src.config import AppConfig, SensorConfig, load_config, validate_config
+from src.main import _collect_fields
+from src.protocol import Field, Line, render_line
+from src.sampler import Sampler, leaf_sensors
+
+
+class FakeClock:
+    def __init__(self) -> None:
+        self.now = 100.0
+
+    def __call__(self) -> float:
+        return self.now
+
+
+def _cfg() -> AppConfig:
+    return AppConfig(
+        interval=2.0,
+        sensors=[
+            SensorConfig(name="CPU", provider="cpu"),
+            SensorConfig(name="GPU", provider="gpu", interval=10.0),
+            SensorConfig(
+                name="T",
+                provider="join",
+                join=[
+                    SensorConfig(name="A", provider="temp"),
+                    SensorConfig(name="B", provider="temp", enabled=False),
+                ],
+            ),
+            SensorConfig(name="Off", provider="cpu", enabled=False),
+        ],
+    )
+
+
+def _reader(values: dict[str, Line]):
+    return lambda s: values.get(s.name)
+
+
+def test_leaf_sensors_flatten_joins_and_skip_disabled() -> None:
+    assert [s.name for s in leaf_sensors(_cfg())] == ["CPU", "GPU", "A"]
+
+
+def test_frames_read_cached_values() -> None:
+    cfg = _cfg()
+    clock = FakeClock()
+    sampler = Sampler(cfg, _reader({"CPU": [Field(7)], "A": [Field(40), "C"]}), clock)
+    assert _collect_fields(cfg, sampler.get) == []  # nothing sampled yet
+    for s in leaf_sensors(cfg):
+        sampler.sample(s)
+    lines = [render_line(line) for line in _collect_fields(cfg, sampler.get)]
+    assert lines == ["CPU   7", "T A  40C"]
+
+
+def test_stale_value_is_dropped_per_sensor_interval() -> None:
+    cfg = _cfg()
+    clock = FakeClock()
+    sampler = Sampler(cfg, _reader({"CPU": ["c"], "GPU": ["g"]}), clock)
+    cpu, gpu = leaf_sensors(cfg)[:2]
+    sampler.sample(cpu)
+    sampler.sample(gpu)
+    clock.now += 7.0  # past 3 x 2 s, within 3 x 10 s
+    assert sampler.get(cpu) is None
+    assert sampler.get(gpu) == ["g"]
+
+
+def test_failing_sensor_caches_nothing_shown() -> None:
+    cfg = _cfg()
+
+    def boom(s: SensorConfig) -> Line | None:
+        raise OSError("hwmon gone")
+
+    sampler = Sampler(cfg, boom, FakeClock())
+    sampler.sample(leaf_sensors(cfg)[0])
+    assert sampler.get(leaf_sensors(cfg)[0]) is None
+
+
+def test_slow_sensor_does_not_stall_frames() -> None:
+    cfg = AppConfig(
+        interval=0.05,
+        sensors=[
+            SensorConfig(name="GPU", provider="gpu"),
+            SensorConfig(name="CPU", provider="cpu"),
+        ],
+    )
+    release = threading.Event()
+
+    def read(s: SensorConfig) -> Line | None:
+        if s.name == "GPU":
+            release.wait(5.0)  # a hung nvidia-smi
+        return [s.name]
+
+    sampler = Sampler(cfg, read)
+    sampler.start()
+    try:
+        assert not sampler.wait_ready(0.2)
+        start = time.monotonic()
+        lines = _collect_fields(cfg, sampler.get)
+        assert time.monotonic() - start < 0.05
+        assert [render_line(line) for line in lines] == ["CPU CPU"]
+    finally:
+        release.set()
+        sampler.stop()
+
+
+def test_sensor_interval_config(tmp_path: Path) -> None:
+    cfg_path = tmp_path / "cfg.yaml"
+    cfg_path.write_text(
+        """
+sensors:
+  - name: GPU
+    provider: gpu
+    interval: 10
+  - name: T
+    join:
+      - name: A
+        provider: temp
+        interval: 0.5
+"""
+    )
+    cfg = load_config(cfg_path)
+    assert cfg.sensors[0].interval == 10.0
+    assert cfg.sensors[1].join[0].interval == 0.5
+    validate_config(cfg)
+    cfg.sensors[1].join[0].interval = 0
+    with pytest.raises(ValueError):
+        validate_config(cfg)
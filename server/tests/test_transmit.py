@@ -0,0 +1,87 @@
+from __future__ import annotations
+
+import threading
+
+from src.transmit import Priority, Transmitter
+
+
+class GatedSerial:
+    """Records writes; each write blocks until the test opens the gate."""
+
+    def __init__(self) -> None:
+        self.writes: list[bytes] = []
+        self.gate = threading.Event()
+        self.entered = threading.Event()
+
+    def write(self, data: bytes) -> int:
+        self.entered.set()
+        self.gate.wait(5.0)
+        self.writes.append(data)
+        return len(data)
+
+    def flush(self) -> None:
+        return None
+
+
+class FailingSerial:
+    def write(self, data: bytes) -> int:
+        raise OSError("port gone")
+
+    def flush(self) -> None:
+        return None
+
+
+def test_interactive_overtakes_and_telemetry_is_superseded() -> None:
+    ser = GatedSerial()
+    tx = Transmitter(ser)
+    tx.start()
+    try:
+        tx.submit(b"T0", Priority.TELEMETRY, key="telemetry")
+        assert ser.entered.wait(5.0)  # T0 is being written
+        tx.submit(b"T1", Priority.TELEMETRY, key="telemetry")
+        tx.submit(lambda: b"T2", Priority.TELEMETRY, key="telemetry")
+        tx.write(b"COMMANDS")
+        assert tx.stats().depth == 2
+        ser.gate.set()
+        assert tx.drain(5.0)
+    finally:
+        tx.stop()
+    assert ser.writes == [b"T0", b"COMMANDS", b"T2"]
+    stats = tx.stats()
+    assert stats.sent == 3
+    assert stats.superseded == 1
+    assert stats.max_depth == 2
+    assert stats.depth == 0
+    assert stats.max_wait >= 0.0
+
+
+def test_callable_payload_is_encoded_at_send_time() -> None:
+    ser = GatedSerial()
+    ser.gate.set()
+    encoded: list[str] = []
+    tx = Transmitter(ser)
+    tx.submit(lambda: encoded.append("x") or b"frame", Priority.TELEMETRY, key="telemetry")
+    tx.submit(lambda: encoded.append("y") or b"newer", Priority.TELEMETRY, key="telemetry")
+    assert encoded == []  # nothing runs before the writer picks it up
+    tx.start()
+    try:
+        assert tx.drain(5.0)
+    finally:
+        tx.stop()
+    assert encoded == ["y"]
+    assert ser.writes == [b"newer"]
+
+
+def test_write_error_surfaces_to_the_caller() -> None:
+    tx = Transmitter(FailingSerial())
+    tx.start()
+    tx.submit(b"x", Priority.TELEMETRY)
+    assert not tx.drain(5.0)
+    try:
+        tx.raise_if_failed()
+    except OSError as e:
+        assert "port gone" in str(e)
+    else:
+        raise AssertionError("expected the write error")
+    finally:
+        tx.stop()